@@ -31,11 +31,6 @@ function(install_sfml)
 
 endfunction()
 
-# Hack: compile depends directly
-set(SRC_SYSTEM_DEPENDS
-    ${LMBD_ROOT_DIR}/src/depends/arduinoFFT/src/arduinoFFT.cpp
-    )
-
 # Create simulator as library
 set(SRC_SYSTEM_UTILS
     ${LMBD_ROOT_DIR}/src/system/utils/colorspace.cpp
@@ -121,7 +116,6 @@ function(create_simulator_target SIM_NAME)
     target_compile_definitions(${TARGET_NAME} PUBLIC LMBD_LAMP_TYPE__${UPPER_SIM_NAME})
 
     add_library(simulator_${SIM_NAME} OBJECT
-        ${SRC_SYSTEM_DEPENDS}
         ${SRC_SYSTEM_UTILS}
         ${SRC_SYSTEM_BSP}
         ${SRC_SYSTEM_COMPONENT}
@@ -3,8 +3,10 @@
 */
 
 #include <cstdint>
+#include <cstdlib>
 #include <deque>
 #include <memory>
+#include <mutex>
 
 #include "src/system/hal/pdm_handle.h"
 #include "src/system/hal/time.h"
@@ -16,6 +18,9 @@
 
 #include <SFML/Audio/SoundRecorder.hpp>
 
+#include "simulator/include/hardware_influencer.h"
+#include "simulator/include/wav_source.h"
+
 #define PDM_HANDLE_CPP
 
 namespace simulator {
@@ -27,6 +32,9 @@ class LevelRecorder : public sf::SoundRecorder
 
   virtual bool onProcessSamples(const std::int16_t* samples, std::size_t sampleCount)
   {
+    // called from the recording thread
+    const std::lock_guard<std::mutex> lock(buffersMutex);
+
     // safety to prevent data accumulation
     if (buffers.size() > 32)
       buffers.clear();
@@ -53,6 +61,7 @@ class LevelRecorder : public sf::SoundRecorder
         newData.data[i] = samples[index];
       }
       newData.sampleRead = i;
+      newData.sequenceNumber = ++sequenceNumber;
 
       buffers.emplace_back(newData);
     }
@@ -64,12 +73,92 @@ class LevelRecorder : public sf::SoundRecorder
 public:
   // sound goes out slowly
   std::deque<::lampda::hal::microphone::PdmData> buffers;
+  /// protect the buffers, filled by the recording thread
+  std::mutex buffersMutex;
   uint64_t sampleTime_us;
+  /// sequence number of the latest capture
+  uint32_t sequenceNumber = 0;
 
   ~LevelRecorder() { stop(); }
 };
 std::unique_ptr<LevelRecorder> recorder;
 
+/// Stream a WAV file instead of the computer microphone, at the pace of the simulation time
+class WavPlayer
+{
+public:
+  static constexpr uint16_t blockSize = ::lampda::hal::microphone::PdmData::SAMPLE_SIZE;
+  static constexpr uint64_t blockDuration_us = blockSize * 1000000ull / ::lampda::utils::fft::SAMPLE_RATE;
+  /// captures kept for a late system, like the microphone recorder
+  static constexpr uint32_t maxLateBlocks = 32;
+
+  WavSource source;
+  bool shouldLoop = true;
+  bool isStreaming = false;
+  /// time of the start of the first block
+  uint64_t startTime_us = 0;
+  /// number of blocks returned to the system, and sequence number of the last one
+  uint32_t returnedBlocks = 0;
+
+  /// number of complete blocks at this time
+  uint32_t get_available_blocks() const
+  {
+    const uint64_t blocks = (::lampda::hal::time_us() - startTime_us) / blockDuration_us;
+    if (shouldLoop)
+      return blocks;
+    return std::min<uint64_t>(blocks, source.block_count(blockSize));
+  }
+
+  /// return the blocks in order, so that a replay gives the same analysis
+  ::lampda::hal::microphone::PdmData get()
+  {
+    const uint32_t availableBlocks = get_available_blocks();
+    if (returnedBlocks >= availableBlocks)
+      return {};
+    // safety, drop the captures of a late system
+    if (availableBlocks - returnedBlocks > maxLateBlocks)
+      returnedBlocks = availableBlocks - maxLateBlocks;
+
+    ::lampda::hal::microphone::PdmData newData;
+    source.read_block(returnedBlocks, newData.data.data(), blockSize);
+    newData.sampleTime_us = startTime_us + returnedBlocks * blockDuration_us;
+    newData.sampleDuration_us = blockDuration_us;
+    newData.sampleRead = blockSize;
+    newData.sequenceNumber = ++returnedBlocks;
+    return newData;
+  }
+};
+std::unique_ptr<WavPlayer> wavPlayer;
+/// protect the WAV player, used by the audio task
+std::mutex wavPlayerMutex;
+
+namespace mock_microphone {
+
+bool set_wav_file(const char* path, const bool shouldLoop)
+{
+  const std::lock_guard<std::mutex> lock(wavPlayerMutex);
+  if (path == nullptr or path[0] == '\0')
+  {
+    wavPlayer = nullptr;
+    return true;
+  }
+
+  auto player = std::make_unique<WavPlayer>();
+  if (not player->source.load(path, ::lampda::utils::fft::SAMPLE_RATE))
+    return false;
+  player->shouldLoop = shouldLoop;
+  // keep streaming if the microphone is started
+  if (wavPlayer)
+  {
+    player->isStreaming = wavPlayer->isStreaming;
+    player->startTime_us = ::lampda::hal::time_us();
+  }
+  wavPlayer = std::move(player);
+  return true;
+}
+
+} // namespace mock_microphone
+
 } // namespace simulator
 
 namespace lampda {
@@ -79,11 +168,21 @@ namespace _private {
 
 hal::microphone::PdmData get()
 {
+  {
+    const std::lock_guard<std::mutex> lock(simulator::wavPlayerMutex);
+    if (simulator::wavPlayer and simulator::wavPlayer->isStreaming)
+      return simulator::wavPlayer->get();
+  }
+
+  if (!simulator::recorder)
+    return {};
+  const std::lock_guard<std::mutex> lock(simulator::recorder->buffersMutex);
+
   // safety
   if (simulator::recorder->buffers.size() > 32)
     simulator::recorder->buffers.pop_back();
 
-  if (simulator::recorder && simulator::recorder->buffers.size() > 0)
+  if (simulator::recorder->buffers.size() > 0)
   {
     const auto buff = simulator::recorder->buffers.front();
     simulator::recorder->buffers.pop_front();
@@ -100,6 +199,27 @@ bool start()
   fprintf(stderr, "mic started\n");
   fflush(stderr);
 
+  // a file set in the environment replaces the computer microphone
+  static bool isEnvironmentRead = false;
+  if (not isEnvironmentRead)
+  {
+    isEnvironmentRead = true;
+    const char* wavPath = std::getenv(simulator::mock_microphone::wavFileVariable);
+    if (wavPath != nullptr and not simulator::mock_microphone::set_wav_file(wavPath))
+      fprintf(stderr, "%s: can not stream %s\n", simulator::mock_microphone::wavFileVariable, wavPath);
+  }
+
+  {
+    const std::lock_guard<std::mutex> lock(simulator::wavPlayerMutex);
+    if (simulator::wavPlayer)
+    {
+      simulator::wavPlayer->isStreaming = true;
+      simulator::wavPlayer->startTime_us = hal::time_us();
+      simulator::wavPlayer->returnedBlocks = 0;
+      return true;
+    }
+  }
+
   if (!simulator::recorder)
     simulator::recorder = std::make_unique<simulator::LevelRecorder>();
 
@@ -108,6 +228,12 @@ bool start()
 
 void stop()
 {
+  {
+    const std::lock_guard<std::mutex> lock(simulator::wavPlayerMutex);
+    if (simulator::wavPlayer)
+      simulator::wavPlayer->isStreaming = false;
+  }
+
   if (simulator::recorder)
   {
     simulator::recorder->stop();
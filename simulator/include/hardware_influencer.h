@@ -54,6 +54,20 @@ extern float inputVbusVoltage;
 extern float chargeOtgOutput;
 } // namespace mock_electrical
 
+/// Encapsulate the mock microphone signals
+namespace mock_microphone {
+/// environment variable of a WAV file to stream, read when the microphone starts
+static constexpr const char* wavFileVariable = "LMBD_SIMU_MICROPHONE_WAV";
+/**
+ * \brief Stream a WAV file instead of the computer microphone, at the pace of the simulation time.
+ * The file is resampled to the microphone sample rate, and streamed from its start when the microphone starts.
+ * \param[in] path WAV file, nullptr or empty to use the computer microphone
+ * \param[in] shouldLoop Restart the file at its end, else the microphone stops sending data
+ * \return false if the file can not be read
+ */
+bool set_wav_file(const char* path, bool shouldLoop = true);
+} // namespace mock_microphone
+
 /// Encapsulate the mock battery signals
 namespace mock_battery {
 extern float voltage;
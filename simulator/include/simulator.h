@@ -329,9 +329,11 @@ template<typename T> struct simulator
       {
 #ifdef LMBD_LAMP_TYPE__INDEXABLE
         // brightness on the indexale lamp
-        using curve_t = ::lampda::utils::curves::LinearCurve<::lampda::brightness_t, uint8_t>;
-        static curve_t brightnessCurve({curve_t::point_t {0, ::lampda::minimumAllowedBrightness_8},
-                                        curve_t::point_t {::lampda::brightness::absoluteMaximumBrightness, 255}});
+        using point_t = ::lampda::utils::curves::Point<::lampda::brightness_t, uint8_t>;
+        static constexpr auto brightnessCurve =
+                ::lampda::utils::curves::make_linear_curve<::lampda::brightness_t, uint8_t>(
+                        point_t {0, ::lampda::minimumAllowedBrightness_8},
+                        point_t {::lampda::brightness::absoluteMaximumBrightness, 255});
         state.brightness = brightnessCurve.sample(::lampda::logic::brightness::get_brightness());
 
         const bool isVoltageHighEnough = mock_electrical::outputVoltage > 11.5;
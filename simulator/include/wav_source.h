@@ -0,0 +1,250 @@
+/*! \file wav_source.h
+    \brief Read WAV files as a microphone source, for reproducible audio simulations
+*/
+
+#ifndef WAV_SOURCE_H
+#define WAV_SOURCE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace simulator {
+
+/**
+ * \brief Mono audio from a WAV file, resampled to the firmware sample rate.
+ *
+ * Supports integer PCM (8, 16, 24 and 32 bits) and 32 bits float files, with any number of channels: the channels are
+ * averaged. The resampling uses a windowed sinc filter, cut at the lowest Nyquist frequency.
+ * The whole file is converted when loaded: reading blocks is deterministic and costs nothing.
+ */
+class WavSource
+{
+public:
+  /**
+   * \brief Load a file, and resample it
+   * \param[in] path Path of the WAV file
+   * \param[in] targetRate Sample rate of the samples, in Hertz
+   * \return false if the file could not be read
+   */
+  bool load(const std::string& path, const uint32_t targetRate)
+  {
+    _samples.clear();
+
+    std::ifstream file(path, std::ios::binary);
+    if (not file.is_open())
+    {
+      std::cerr << "WAV file " << path << " not found" << std::endl;
+      return false;
+    }
+    const std::vector<uint8_t> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    uint32_t sourceRate = 0;
+    std::vector<float> mono;
+    if (not decode(content, sourceRate, mono))
+    {
+      std::cerr << "WAV file " << path << " is not a supported WAV file" << std::endl;
+      return false;
+    }
+
+    resample(mono, sourceRate, targetRate);
+    return not _samples.empty();
+  }
+
+  /// Samples at the target rate
+  const std::vector<int16_t>& samples() const { return _samples; }
+
+  /// Number of complete blocks in the file
+  size_t block_count(const uint16_t blockSize) const { return _samples.size() / blockSize; }
+
+  /**
+   * \brief Copy a block of samples
+   * \param[in] index Index of the block, wraps at the end of the file
+   * \param[out] block Samples of the block
+   * \param[in] blockSize Size of the block
+   */
+  void read_block(const size_t index, int16_t* block, const uint16_t blockSize) const
+  {
+    const size_t blocks = block_count(blockSize);
+    if (blocks == 0)
+    {
+      memset(block, 0, blockSize * sizeof(int16_t));
+      return;
+    }
+    memcpy(block, _samples.data() + (index % blocks) * blockSize, blockSize * sizeof(int16_t));
+  }
+
+private:
+  static uint32_t read_u32(const uint8_t* data)
+  {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+  }
+  static uint16_t read_u16(const uint8_t* data) { return data[0] | (data[1] << 8); }
+
+  /// decode the file content to mono samples in [-1, 1]
+  static bool decode(const std::vector<uint8_t>& content, uint32_t& sampleRate, std::vector<float>& mono)
+  {
+    static constexpr uint16_t formatPcm = 1;
+    static constexpr uint16_t formatFloat = 3;
+    static constexpr uint16_t formatExtensible = 0xFFFE;
+
+    if (content.size() < 12 or memcmp(content.data(), "RIFF", 4) != 0 or memcmp(content.data() + 8, "WAVE", 4) != 0)
+      return false;
+
+    uint16_t format = 0;
+    uint16_t channels = 0;
+    uint16_t bitsPerSample = 0;
+    const uint8_t* data = nullptr;
+    size_t dataSize = 0;
+
+    size_t offset = 12;
+    while (offset + 8 <= content.size())
+    {
+      const uint8_t* chunk = content.data() + offset;
+      const size_t chunkSize = std::min<size_t>(read_u32(chunk + 4), content.size() - offset - 8);
+      if (memcmp(chunk, "fmt ", 4) == 0 and chunkSize >= 16)
+      {
+        format = read_u16(chunk + 8);
+        channels = read_u16(chunk + 10);
+        sampleRate = read_u32(chunk + 12);
+        bitsPerSample = read_u16(chunk + 22);
+        // the actual format is the start of the sub format identifier
+        if (format == formatExtensible and chunkSize >= 26)
+          format = read_u16(chunk + 32);
+      }
+      else if (memcmp(chunk, "data", 4) == 0)
+      {
+        data = chunk + 8;
+        dataSize = chunkSize;
+      }
+      // chunks are aligned on two bytes
+      offset += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    const bool isPcm = format == formatPcm and
+                       (bitsPerSample == 8 or bitsPerSample == 16 or bitsPerSample == 24 or bitsPerSample == 32);
+    const bool isFloat = format == formatFloat and bitsPerSample == 32;
+    if (data == nullptr or channels == 0 or sampleRate == 0 or not(isPcm or isFloat))
+      return false;
+
+    const size_t bytesPerSample = bitsPerSample / 8;
+    const size_t frames = dataSize / (bytesPerSample * channels);
+    mono.resize(frames);
+    for (size_t frame = 0; frame < frames; ++frame)
+    {
+      float sum = 0.0f;
+      for (uint16_t channel = 0; channel < channels; ++channel)
+      {
+        const uint8_t* sample = data + (frame * channels + channel) * bytesPerSample;
+        if (isFloat)
+        {
+          float value;
+          memcpy(&value, sample, sizeof(float));
+          sum += value;
+        }
+        else if (bitsPerSample == 8)
+        {
+          // 8 bits samples are unsigned
+          sum += (sample[0] - 128) / 128.0f;
+        }
+        else
+        {
+          // sign extend the little endian sample, from its most significant byte
+          int32_t value = static_cast<int8_t>(sample[bytesPerSample - 1]);
+          for (size_t byte = bytesPerSample - 1; byte > 0; --byte)
+            value = (value << 8) | sample[byte - 1];
+          sum += value / static_cast<float>(1u << (bitsPerSample - 1));
+        }
+      }
+      mono[frame] = sum / channels;
+    }
+    return true;
+  }
+
+  /// windowed sinc resampling to int16 samples
+  void resample(const std::vector<float>& mono, const uint32_t sourceRate, const uint32_t targetRate)
+  {
+    // zero crossings of the sinc on each side
+    static constexpr int halfWidth = 16;
+
+    const double step = sourceRate / static_cast<double>(targetRate);
+    // cut at the lowest Nyquist frequency
+    const double cutoff = std::min(1.0, 1.0 / step);
+    const int taps = static_cast<int>(ceil(halfWidth / cutoff));
+
+    const size_t count = static_cast<size_t>(mono.size() / step);
+    _samples.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const double position = i * step;
+      const int center = static_cast<int>(floor(position));
+
+      double value = 0.0;
+      for (int j = center - taps + 1; j <= center + taps; ++j)
+      {
+        if (j < 0 or j >= static_cast<int>(mono.size()))
+          continue;
+        const double distance = (position - j) * cutoff;
+        if (fabs(distance) >= halfWidth)
+          continue;
+        const double sinc = distance == 0.0 ? 1.0 : sin(M_PI * distance) / (M_PI * distance);
+        const double window = 0.5 + 0.5 * cos(M_PI * distance / halfWidth);
+        value += mono[j] * sinc * window * cutoff;
+      }
+      _samples[i] = static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, round(value * 32768.0))));
+    }
+  }
+
+  std::vector<int16_t> _samples;
+};
+
+/**
+ * \brief Write mono 16 bits samples as a WAV file
+ * \return false if the file could not be written
+ */
+inline bool write_wav(const std::string& path, const std::vector<int16_t>& samples, const uint32_t sampleRate)
+{
+  std::ofstream file(path, std::ios::binary);
+  if (not file.is_open())
+    return false;
+
+  const auto write_u32 = [&file](const uint32_t value) {
+    const uint8_t bytes[4] = {static_cast<uint8_t>(value),
+                              static_cast<uint8_t>(value >> 8),
+                              static_cast<uint8_t>(value >> 16),
+                              static_cast<uint8_t>(value >> 24)};
+    file.write(reinterpret_cast<const char*>(bytes), 4);
+  };
+  const auto write_u16 = [&file](const uint16_t value) {
+    const uint8_t bytes[2] = {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8)};
+    file.write(reinterpret_cast<const char*>(bytes), 2);
+  };
+
+  const uint32_t dataSize = samples.size() * sizeof(int16_t);
+  file.write("RIFF", 4);
+  write_u32(36 + dataSize);
+  file.write("WAVE", 4);
+  file.write("fmt ", 4);
+  write_u32(16);
+  write_u16(1); // PCM
+  write_u16(1); // mono
+  write_u32(sampleRate);
+  write_u32(sampleRate * sizeof(int16_t));
+  write_u16(sizeof(int16_t));
+  write_u16(16);
+  file.write("data", 4);
+  write_u32(dataSize);
+  for (const int16_t sample: samples)
+    write_u16(static_cast<uint16_t>(sample));
+  return file.good();
+}
+
+} // namespace simulator
+
+#endif
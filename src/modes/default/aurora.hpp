@@ -4,9 +4,8 @@
 /// @file aurora.hpp
 
 #include "src/system/ext/math8.h"
-#include "src/system/ext/noise.h"
-
 #include "src/modes/include/colors/palettes.hpp"
+#include "src/modes/include/noise/backends.hpp"
 
 /// Basic "default" modes included with the hardware
 namespace lampda::modes::default_modes {
@@ -19,6 +18,9 @@ namespace lampda::modes::default_modes {
  */
 struct AuroraMode : public BasicMode
 {
+  /// noise implementation used by this mode
+  using NoiseTy = modes::noise::PerlinNoise;
+
   struct StateTy
   {
     /// sclae of the aurora
@@ -60,7 +62,7 @@ struct AuroraMode : public BasicMode
       for (int y = 0; y <= ctx.lamp.maxHeight; ++y, ++step)
       {
         const auto& color = colors::from_palette(
-                qsub8(noise8::inoise((step % 2) + scaledX, y * 16 + step % 16, step * _speedDivider),
+                qsub8(NoiseTy::inoise8((step % 2) + scaledX, y * 16 + step % 16, step * _speedDivider),
                       fabsf(halfHeight - (float)y) * adjustHeight),
                 palette);
         ctx.lamp.setPixelColorXY(x, y, color);
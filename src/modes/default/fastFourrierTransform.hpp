@@ -23,8 +23,9 @@ struct FastFourrierTransformMode : public BasicMode
     auto& state = ctx.state;
     state.soundEvent.update(ctx);
 
-    const auto& fft_log = state.soundEvent.fft_log;
-    const float maxFftVal = state.soundEvent.maxAmplitude;
+    const auto& fft_log = state.soundEvent.fft_log();
+    // the log bins are weighted like the human ear: scale them by the loudest one
+    const float maxFftVal = std::max<float>(1.0f, *std::max_element(fft_log.begin(), fft_log.end()));
 
     // adjust for volume
     const float maxLevel = lmpd_map<float>(state.soundEvent.level,
@@ -4,11 +4,11 @@
 /// @file fireplace.hpp
 
 #include "src/system/ext/math8.h"
-#include "src/system/ext/noise.h"
 
 #include "src/modes/include/audio/utils.hpp"
 
 #include "src/modes/include/colors/palettes.hpp"
+#include "src/modes/include/noise/backends.hpp"
 
 #include <cstdint>
 
@@ -25,48 +25,29 @@ struct FireMode : public BasicMode
   /// Fire custom ramp sets how sensitive it is to ambiant sound
   static constexpr bool hasCustomRamp = true;
 
+  /// noise implementation used by this mode
+  using NoiseTy = modes::noise::PerlinNoise;
+
   static constexpr uint16_t xScale = 60; ///< Noise scaling (X direction)
   static constexpr uint16_t yScale = 60; ///< Noise scaling (Y direction)
 
   /// Palette used for fire colors
   static constexpr auto palette = colors::PaletteHeatColors;
 
-  // this is too heavy to run at full, speed, display every other pixels instead of refreshing all
-  static constexpr uint32_t everyNIndex = 2;
-
   struct StateTy
   {
     /// handle sound event
     audio::SoundEventTy<> soundEvent;
-
-    // flag that we have just been reseted
-    bool isResetted = false;
   };
 
   static void on_enter_mode(auto& ctx)
   {
-    ctx.state.isResetted = true;
     ctx.state.soundEvent.reset(ctx);
 
     ctx.template set_config_bool<ConfigKeys::rampSaturates>(true);
   }
 
-  static void loop(auto& ctx)
-  {
-    if (ctx.state.isResetted)
-    {
-      ctx.state.isResetted = false;
-
-      // load animation
-      for (uint32_t i = 0; i < everyNIndex; ++i)
-      {
-        fire_display(ctx, i);
-      }
-      return;
-    }
-
-    fire_display(ctx, ctx.lamp.tick);
-  }
+  static void loop(auto& ctx) { fire_display(ctx, ctx.lamp.tick); }
 
   static void fire_display(auto& ctx, const uint32_t tick)
   {
@@ -90,17 +71,19 @@ struct FireMode : public BasicMode
     // precompute "fire intensity" line per line
     intensity *= ctx.lamp.maxHeight;
 
-    const size_t firstIndex = tick % everyNIndex;
-
     // for each line, generate noise & set pixels
-    for (uint16_t j = firstIndex; j <= ctx.lamp.maxHeight; j += everyNIndex)
+    static constexpr uint16_t lineWidth = ctx.lamp.maxWidth + 1;
+    uint8_t flames[lineWidth];
+    for (uint16_t j = 0; j <= ctx.lamp.maxHeight; ++j)
     {
       const float here = std::max<float>(intensity - j * 255.0f, 0.0f);
       const uint8_t decay = std::min<uint8_t>(here / ctx.lamp.maxHeight, 255.0f);
 
-      for (uint16_t i = 0; i <= ctx.lamp.maxWidth; ++i)
+      // the whole line at once
+      NoiseTy::inoise8_grid(0, xScale, lineWidth, j * yScale + ySpeed, 0, 1, zSpeed, flames);
+      for (uint16_t i = 0; i < lineWidth; ++i)
       {
-        const auto flame = noise8::inoise(i * xScale, j * yScale + ySpeed, zSpeed);
+        const auto flame = flames[i];
         const auto pixel = std::min<uint8_t>(223, qsub8(flame, decay));
         const auto color = modes::colors::from_palette<false, uint8_t>(pixel, palette);
 
@@ -4,16 +4,18 @@
 /// @file gravity_mode.hpp
 
 #include "src/modes/include/imu/utils.hpp"
+#include "src/modes/include/particle_system/particle_interactions.hpp"
 
 #include "src/modes/include/colors/palettes.hpp"
+#include "src/system/hal/print.h"
 #include <cstddef>
 #include <cstdint>
-#include <functional>
 
 namespace lampda::modes::default_modes {
 
 /**
- * \brief Sand particle simulation, synched with the board IMU
+ * \brief Sand particle simulation, synched with the board IMU.
+ * The particles push and pull their neighbors, and flow together when the lamp tilts.
  */
 struct GravityMode : public BasicMode
 {
@@ -26,9 +28,10 @@ struct GravityMode : public BasicMode
   {
     auto& state = ctx.state;
 
-    state.imuEvent.reset(ctx);
-    // set particle count
-    state.imuEvent.particuleSystem.set_max_particle_count(particleCount);
+    // lease the particles, and the arrays of their interactions (the pool holds both)
+    state.imuEvent.reset(ctx, particleCount);
+    if (not state.interactions.lease(particleCount))
+      hal::lampda_print("gravity mode: particle pool exhausted, no interactions");
     state.imuEvent.particuleSystem.init_particules(generate_random_particule_position);
 
     state.persistance = 210;
@@ -37,6 +40,13 @@ struct GravityMode : public BasicMode
     custom_ramp_update(ctx, ctx.get_active_custom_ramp());
   }
 
+  /// Return the particles to the pool
+  static void on_exit_mode(auto& ctx)
+  {
+    ctx.state.interactions.release();
+    ctx.state.imuEvent.release(ctx);
+  }
+
   /// User ramp changes the color palette
   static void custom_ramp_update(auto& ctx, uint8_t rampValue)
   {
@@ -60,7 +70,16 @@ struct GravityMode : public BasicMode
 
     auto& particleSystem = state.imuEvent.particuleSystem;
 
-    particleSystem.iterate_with_collisions(state.imuEvent.lastReading.accel, ctx.lamp.frameDurationMs / 1000.0f);
+    // the interactions update the speeds before each step
+    static constexpr bool withCollisions = true;
+    static constexpr bool shouldKeepInLampBounds = true;
+    particleSystem.simulate(state.imuEvent.lastReading.accel,
+                            ctx.lamp.frameDurationMs / 1000.0f,
+                            withCollisions,
+                            shouldKeepInLampBounds,
+                            [&](const float stepDuration_s) {
+                              state.interactions.apply(particleSystem, stepDuration_s);
+                            });
 
     ctx.lamp.fadeToBlackBy(255 - ctx.state.persistance);
 
@@ -78,6 +97,8 @@ struct GravityMode : public BasicMode
     uint8_t persistance;
     /// handle IMU events
     imu::ImuEventTy<> imuEvent;
+    /// forces between the particles, with arrays leased in on_enter_mode()
+    ParticleInteractionsTy<> interactions;
 
     /// Usable palettes count
     static constexpr uint8_t maxPalettesCount = 3;
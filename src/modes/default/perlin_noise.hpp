@@ -8,6 +8,7 @@
 #include "src/system/ext/random8.h"
 
 #include "src/modes/include/colors/palettes.hpp"
+#include "src/modes/include/noise/noise_field.hpp"
 #include <cstdint>
 #include <cstdlib>
 
@@ -25,8 +26,12 @@ struct PerlinNoiseMode : public BasicMode
   /// index of the buffer used in this mode
   static constexpr uint8_t bufferIndexToUse = 0;
 
-  // this is too heavy to run at full, speed, display every other pixels instead of refreshing amm
-  static constexpr uint32_t everyNIndex = 2;
+  /// noise field configuration of this mode
+  struct NoiseConfigTy : public modes::noise::NoiseFieldConfig
+  {
+    /// noise implementation used by this mode
+    using NoiseTy = modes::noise::PerlinNoise;
+  };
 
   struct StateTy
   {
@@ -57,14 +62,12 @@ struct PerlinNoiseMode : public BasicMode
     /// store selected palette
     colors::PaletteTy const* selectedPalette;
 
-    // flag that we have just been reseted
-    bool isResetted = false;
+    /// low resolution noise, upsampled on the leds
+    modes::noise::NoiseField<NoiseConfigTy> noiseField;
   };
 
   static void on_enter_mode(auto& ctx)
   {
-    ctx.state.isResetted = true;
-
     ctx.state.positionX = UINT32_MAX / 2 + random16() / 2;
     ctx.state.positionY = UINT32_MAX / 2 + random16() / 2;
     ctx.state.positionZ = UINT32_MAX / 2 + random16() / 2;
@@ -73,6 +76,7 @@ struct PerlinNoiseMode : public BasicMode
     ctx.state.speedY = random8();
     ctx.state.speedZ = random8();
     ctx.state.scale = 600;
+    ctx.state.noiseField.reset();
 
     ctx.state.ihue = 0;
 
@@ -146,24 +150,9 @@ struct PerlinNoiseMode : public BasicMode
     return speed;
   }
 
-  static void loop(auto& ctx)
-  {
-    if (ctx.state.isResetted)
-    {
-      ctx.state.isResetted = false;
+  static void loop(auto& ctx) { perlin_display(ctx); }
 
-      // load animation
-      for (uint32_t i = 0; i <= everyNIndex; ++i)
-      {
-        perlin_display(ctx, i);
-      }
-      return;
-    }
-
-    perlin_display(ctx, ctx.lamp.tick);
-  }
-
-  static void perlin_display(auto& ctx, const uint32_t tick)
+  static void perlin_display(auto& ctx)
   {
     auto& state = ctx.state;
     auto& lamp = ctx.lamp;
@@ -176,22 +165,12 @@ struct PerlinNoiseMode : public BasicMode
     // copy to prevent a ramp update mid animation
     const colors::PaletteTy palette = *(state.selectedPalette);
 
-    const auto x = state.positionX;
-    const auto y = state.positionY;
-    const auto z = state.positionZ;
-    const auto scale = state.scale;
-
-    const size_t firstIndex = tick % everyNIndex;
-
-    // update noise values
-    for (size_t i = firstIndex; i < lamp.ledCount; i += everyNIndex)
-    {
-      const auto res = modes::strip_to_helix_unconstraint(i);
-      uint16_t data = noise16::inoise(x + scale * res.x, y + scale * res.y, z + scale * res.z);
-
-      // smooth over time to prevent suddent jumps
-      noiseBuffer[i] = data;
-    }
+    // update noise values, on a coarse lattice upsampled on the leds
+    auto& field = state.noiseField;
+    field.set_origin(state.positionX, state.positionY, state.scale);
+    field.update(state.positionZ);
+    for (size_t i = 0; i < lamp.ledCount; ++i)
+      noiseBuffer[i] = field.sample(i);
 
     // apply slow drift to X and Y, just for visual variation.
     state.positionX += state.speedX;
@@ -203,7 +182,7 @@ struct PerlinNoiseMode : public BasicMode
     state.speedY = get_next_speed(ctx, state.positionY, state.speedY);
     state.speedZ = get_next_speed(ctx, state.positionZ, state.speedZ);
 
-    for (size_t i = firstIndex; i < lamp.ledCount; i += everyNIndex)
+    for (size_t i = 0; i < lamp.ledCount; ++i)
     {
       uint16_t index = noiseBuffer[i];
       uint8_t bri = noiseBuffer[lamp.ledCount - 1 - i] >> 8;
@@ -25,14 +25,15 @@ struct RainMode : public BasicMode
   static constexpr float lightRainDropsPerSecond = 1;
   /// average drops per seconds for heavy rain
   static constexpr float heavyRainDropsPerSecond = 700;
+  /// maximum drops falling at the same time
+  static constexpr uint16_t maxDropCount = 512;
 
   static void on_enter_mode(auto& ctx)
   {
     auto& state = ctx.state;
 
-    state.imuEvent.reset(ctx);
-    // set particle count
-    state.imuEvent.particuleSystem.set_max_particle_count(512);
+    // lease the particles
+    state.imuEvent.reset(ctx, maxDropCount);
 
     // ramp saturates
     ctx.template set_config_bool<ConfigKeys::rampSaturates>(true);
@@ -44,6 +45,9 @@ struct RainMode : public BasicMode
     custom_ramp_update(ctx, ctx.get_active_custom_ramp());
   }
 
+  /// Return the particles to the pool
+  static void on_exit_mode(auto& ctx) { ctx.state.imuEvent.release(ctx); }
+
   /// Custom ramp controls the rain density
   static void custom_ramp_update(auto& ctx, uint8_t rampValue)
   {
@@ -81,9 +85,12 @@ struct RainMode : public BasicMode
     }
 
     // no collisions between particles, and with no lamp limits
+    static constexpr bool withCollisions = false;
     static constexpr bool shouldKeepInLampBounds = false;
-    particleSystem.iterate_no_collisions(
-            state.imuEvent.lastReading.accel, ctx.lamp.frameDurationMs / 1000.0, shouldKeepInLampBounds);
+    particleSystem.simulate(state.imuEvent.lastReading.accel,
+                            ctx.lamp.frameDurationMs / 1000.0,
+                            withCollisions,
+                            shouldKeepInLampBounds);
     // depop particules that fell too far
     const uint16_t activeParticles = particleSystem.depop_particules(recycle_particules_if_too_far);
 
@@ -5,6 +5,7 @@
 
 #include "src/system/ext/math8.h"
 #include "src/system/ext/noise.h"
+#include "src/system/utils/fast_trig.h"
 
 #include "src/modes/include/colors/palettes.hpp"
 
@@ -53,8 +54,8 @@ struct SpiralMode : public BasicMode
     for (float i = 1; i < maxDim; i += 0.25f)
     {
       float angle = to_radians(t * (maxDim - i));
-      uint16_t myX = colsCenter + (sin_t(angle) * i);
-      uint16_t myY = rowsCenter + (cos_t(angle) * i);
+      uint16_t myX = colsCenter + (trig::sin(angle) * i);
+      uint16_t myY = rowsCenter + (trig::cos(angle) * i);
 
       ctx.lamp.setPixelColorXY(myX, myY, colors::from_palette((uint8_t)((i * 20) + t_20), ctx.state.palette));
     }
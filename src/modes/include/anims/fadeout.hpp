@@ -24,7 +24,7 @@ template<uint8_t MaskBuffId, uint8_t minMaskValue = 0> struct GravityDissolve
     ctx.lamp.template fillTempBuffer<MaskBuffId>(UINT8_MAX);
     // reset particles
     particuleSystem.reset();
-    particuleSystem.set_max_particle_count(20);
+    particuleSystem.set_max_particle_count(maxParticleCount);
 
     latestProgress = -1;
   }
@@ -53,9 +53,12 @@ template<uint8_t MaskBuffId, uint8_t minMaskValue = 0> struct GravityDissolve
     if (particuleSystem.get_number_of_active() > 0)
     {
       // depop particles out of bounds
+      static constexpr bool withCollisions = false;
       static constexpr bool shouldKeepInLampBounds = false;
-      particuleSystem.iterate_no_collisions(
-              utils::vec3d(0.0, 0.0, -9.81 / 4.0), ctx.lamp.frameDurationMs / 1000.0, shouldKeepInLampBounds);
+      particuleSystem.simulate(utils::vec3d(0.0, 0.0, -9.81 / 4.0),
+                               ctx.lamp.frameDurationMs / 1000.0,
+                               withCollisions,
+                               shouldKeepInLampBounds);
       particuleSystem.depop_particules(recycle_particules_if_too_far);
       particuleSystem.show(
               [&](int16_t n, const Particle& particle) {
@@ -184,7 +187,10 @@ private:
   float particlesToDepopPerIteration = 0.0; /// numbers of particles that will fall per loop call
   float depopRate = 0.0;                    /// accumulator rate
   size_t particlesDropped = 0;              /// keep track of the particles that already fell or are falling
-  modes::ParticleSystem particuleSystem = modes::ParticleSystem();
+
+  /// particles falling at the same time
+  static constexpr uint16_t maxParticleCount = 20;
+  modes::ParticleSystemTy<maxParticleCount> particuleSystem;
 };
 
 } // namespace fadeout
@@ -0,0 +1,138 @@
+/*! \file beat_tracker.hpp
+    \brief Per band beat detection, from running statistics of the spectrum history.
+*/
+
+#ifndef MODES_INCLUDE_AUDIO_BEAT_TRACKER_HPP
+#define MODES_INCLUDE_AUDIO_BEAT_TRACKER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/// User modes audio utilities
+namespace lampda::modes::audio {
+
+/**
+ * \brief Detect beats on each band of a spectrum: a band beats when it is above the mean of its recent history plus
+ * 1.5 times its standard deviation.
+ *
+ * The history of spectrums is a ring buffer, and the mean and variance of each band are updated when a spectrum
+ * enters and leaves it: an update costs O(bands), not O(bands * history).
+ * The statistics are computed relatively to a per band reference (the mean of the history), and recomputed from the
+ * history once per history length so float errors cannot accumulate.
+ *
+ * \param[in] bands Number of bands in a spectrum
+ * \param[in] historySize Number of spectrums in the history
+ */
+template<size_t bands, size_t historySize> class BeatTracker
+{
+public:
+  using SpectrumTy = std::array<float, bands>;
+  using BeatsTy = std::array<bool, bands>;
+
+  /// beat if above the mean + this factor times the standard deviation
+  // N=1 : greater than 68.0% of values
+  // N=2 : greater than 95.4% of values
+  // N=3 : greater than 99.6% of values
+  static constexpr float beatDeviations = 1.5f;
+
+  void reset()
+  {
+    historyIndex = 0;
+    historyCount = 0;
+    sums.fill(0.0f);
+    squaredSums.fill(0.0f);
+    references.fill(0.0f);
+    beats.fill(false);
+  }
+
+  /**
+   * \brief Detect the beats of a new spectrum, then add it to the history.
+   * Beats are only detected once the history is full.
+   * \param[in] shouldEnterHistory Set to false to only detect the beats, for a history decimated by the caller
+   * \return the beat flag of each band
+   */
+  const BeatsTy& update(const SpectrumTy& spectrum, const bool shouldEnterHistory = true)
+  {
+    const bool isHistoryFull = historyCount >= historySize;
+    if (isHistoryFull)
+    {
+      static constexpr float oneOverHistory = 1.0f / historySize;
+      for (size_t i = 0; i < bands; i++)
+      {
+        const float shiftedMean = sums[i] * oneOverHistory;
+        const float variance = std::max(0.0f, squaredSums[i] * oneOverHistory - shiftedMean * shiftedMean);
+        beats[i] = spectrum[i] > (references[i] + shiftedMean + beatDeviations * sqrtf(variance));
+      }
+    }
+    if (not shouldEnterHistory)
+      return beats;
+    if (not isHistoryFull)
+      historyCount++;
+
+    // replace the oldest spectrum
+    SpectrumTy& slot = history[historyIndex];
+    for (size_t i = 0; i < bands; i++)
+    {
+      if (isHistoryFull)
+      {
+        const float removed = slot[i] - references[i];
+        sums[i] -= removed;
+        squaredSums[i] -= removed * removed;
+      }
+      const float added = spectrum[i] - references[i];
+      sums[i] += added;
+      squaredSums[i] += added * added;
+    }
+    slot = spectrum;
+
+    historyIndex++;
+    if (historyIndex >= historySize)
+    {
+      historyIndex = 0;
+      recompute_statistics();
+    }
+    return beats;
+  }
+
+  /// Beat flags of the last update
+  const BeatsTy& get_beats() const { return beats; }
+
+private:
+  /// exact statistics of the history, around its mean
+  void recompute_statistics()
+  {
+    static constexpr float oneOverHistory = 1.0f / historySize;
+    for (size_t i = 0; i < bands; i++)
+    {
+      float mean = 0.0f;
+      for (const auto& spectrum: history)
+        mean += spectrum[i] * oneOverHistory;
+
+      references[i] = mean;
+      sums[i] = 0.0f;
+      squaredSums[i] = 0.0f;
+      for (const auto& spectrum: history)
+      {
+        const float value = spectrum[i] - mean;
+        sums[i] += value;
+        squaredSums[i] += value * value;
+      }
+    }
+  }
+
+  std::array<SpectrumTy, historySize> history; ///< last spectrums, ring buffer
+  size_t historyIndex = 0;                     ///< next spectrum to replace
+  size_t historyCount = 0;                     ///< spectrums in the history
+
+  SpectrumTy references;  ///< per band reference of the statistics
+  SpectrumTy sums;        ///< per band sum of the history, minus the reference
+  SpectrumTy squaredSums; ///< per band sum of the squared history, minus the reference
+  BeatsTy beats;          ///< last beat flags
+};
+
+} // namespace lampda::modes::audio
+
+#endif
@@ -8,6 +8,9 @@
 /// @file utils.hpp
 
 #include "src/system/ext/math8.h"
+
+#include "src/modes/include/audio/beat_tracker.hpp"
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <deque>
@@ -22,7 +25,7 @@ namespace lampda::modes::audio {
 struct MicrophoneConfig
 {
   /// Set to true to activate the beat tracking algorithm
-  static constexpr bool useBeatTracking = false;
+  static constexpr bool useBeatTracking = true;
 };
 
 /**
@@ -80,6 +83,9 @@ struct MicrophoneConfig
  * ``windowShort`` is used for ``avgDelta`` (shorter to be more reactive).
  *
  * Note that the algorithm implemented is simple and produces false positives.
+ *
+ * The tempo of the sound is also available: ``bpm``, and ``beatPhase`` (0 on
+ * the beat) to lock animations on it, when ``tempoConfidence`` is high enough.
  */
 
 template<typename ConfigTy = MicrophoneConfig,
@@ -111,12 +117,15 @@ struct SoundEventTy
 
   /// Frequency resolution of the raw fft result
   static constexpr float fftResolutionHz = component::microphone::SoundStruct::get_fft_resolution_Hz();
-  /// Size of the fourrier transform history
+  /// Period of the spectrums entering the history, in captures: one per analysis window (~32ms)
+  static constexpr uint32_t _FFThistoryPeriod =
+          component::microphone::SoundStruct::SAMPLE_SIZE / component::microphone::SoundStruct::HOP_SIZE;
+  /// Size of the fourrier transform history, about a second of spectrums
   static constexpr size_t _FFThistory_MaxSize = round(fftResolutionHz);
 
   using FFTContainer = std::array<float, _dataLenght / 2>; ///<  Container for the fast fourrier linear results
   using FFTLogContainer = std::array<float, _fftChannels>; ///< Container for the fast fourrier logarithmic results
-  using FFTHistoryContainer = std::array<FFTLogContainer, _FFThistory_MaxSize>; ///< history of the FFT
+  using BeatTrackerTy = BeatTracker<_fftChannels, _FFThistory_MaxSize>; ///< beat detection on the FFT history
 
   /// Call this once inside the mode on_enter_mode callback
   void reset(auto& ctx)
@@ -131,29 +140,35 @@ struct SoundEventTy
     _eventCount = 0;
     _eventScale = 0;
 
-    historyIndex = 0;
-    historySize = 0;
+    bpm = 0.0f;
+    beatPhase = 0.0f;
+    tempoConfidence = 0.0f;
 
-    data.fill(0);
-    dataAutoGained.fill(0);
-    fft_log.fill(0);
-    fft_raw.fill(0);
+    beatTracker.reset();
+    lastSequenceNumber = 0;
+    nextHistorySequenceNumber = 0;
+    hasNewData = false;
+
+    frame = {};
+    fft_log_end_frequencies.fill(0);
     beatDetected.fill(false);
   }
 
   /// Call this once every tick inside the mode loop callback
   void update(auto& ctx)
   {
-    const component::microphone::SoundStruct& soundObject = ctx.lamp.get_sound_struct();
+    // view of the microphone data, no copy
+    frame = ctx.lamp.get_sound_frame();
+    const component::microphone::SoundStruct& soundObject = frame.get();
+    hasNewData = soundObject.sequenceNumber != lastSequenceNumber;
+    lastSequenceNumber = soundObject.sequenceNumber;
 
-    // copy microphone data
-    data = soundObject.data;
-    dataAutoGained = soundObject.rectifiedData;
-    fft_log = soundObject.fft_log;
-    fft_raw = soundObject.fft_raw;
     fft_log_end_frequencies = soundObject.fft_log_end_frequencies;
     maxAmplitude = soundObject.maxAmplitude;
     maxAmplitudeFrequency = soundObject.maxAmplitudeFrequency;
+    bpm = soundObject.bpm;
+    beatPhase = soundObject.beatPhase;
+    tempoConfidence = soundObject.tempoConfidence;
 
     // average input sound over a second-long window (approx)
     const auto soundLevel = soundObject.sound_level_Db;
@@ -199,20 +214,24 @@ struct SoundEventTy
       hasEvent = true;
     }
 
-    // beat tracking is heavy on performances
+    // a capture must enter the history only once
     if constexpr (ConfigTy::useBeatTracking)
     {
-      // update history size
-      if (historySize < _FFThistory_MaxSize)
-        historySize++;
-      else
-        beatDetected = track_beat_events(_FFTHistory_beatDetector, fft_log);
-
-      // add sample to history
-      _FFTHistory_beatDetector[historyIndex] = fft_log;
-      historyIndex++;
-      if (historyIndex >= _FFThistory_MaxSize)
-        historyIndex = 0;
+      if (not hasNewData)
+        return;
+
+      // the beats of every capture are detected, but the history only takes one capture per period: a second of
+      // history in a small ring. The period is kept on average, whatever the frame rate
+      const int32_t delay = static_cast<int32_t>(soundObject.sequenceNumber - nextHistorySequenceNumber);
+      const bool shouldEnterHistory = delay >= 0 or delay < -static_cast<int32_t>(_FFThistoryPeriod);
+      if (shouldEnterHistory)
+      {
+        // late by more than a period (dropped captures, restart): start over from this capture
+        if (delay >= static_cast<int32_t>(_FFThistoryPeriod) or delay < 0)
+          nextHistorySequenceNumber = soundObject.sequenceNumber;
+        nextHistorySequenceNumber += _FFThistoryPeriod;
+      }
+      beatDetected = beatTracker.update(soundObject.fft_log, shouldEnterHistory);
     }
   }
 
@@ -258,74 +277,38 @@ struct SoundEventTy
   uint8_t eventScale;          ///< Event scale (0-255)
   float maxAmplitude;          ///< max detected frequency amplitude
   float maxAmplitudeFrequency; ///< max amplitude frequency, in Hertz
+  bool hasNewData;             ///< Did the last update receive a new microphone capture?
+  float bpm;                   ///< Estimated tempo, in beats per minute (0 if unknown)
+  float beatPhase;             ///< Position in the current beat, in [0, 1[ (0 is on the beat)
+  float tempoConfidence;       ///< Periodicity of the sound at this tempo, in [0, 1] (unreliable under ~0.3)
+
+  /// set to true when the corresponding frequency range registers a beat
+  std::array<bool, _fftChannels> beatDetected;
+
+  // The microphone data are read in place, from the frame of the last update.
+  // They are only readable during the tick of the update: later, they read as zeros.
 
   /// raw microphone data
-  std::array<int16_t, _dataLenght> data;
+  const std::array<int16_t, _dataLenght>& data() const { return frame->data; }
   /// dynamically sound adjusted data
-  std::array<int16_t, _dataLenght> dataAutoGained;
+  const std::array<int16_t, _dataLenght>& dataAutoGained() const { return frame->rectifiedData; }
   /// fast fourrier transform as a log scale (closer to human perception)
-  FFTLogContainer fft_log;
-  /// set to true when the corresponding frequency range registers a beat
-  std::array<bool, _fftChannels> beatDetected;
+  const FFTLogContainer& fft_log() const { return frame->fft_log; }
   /// fast fourrier transform raw results
-  std::array<float, _dataLenght / 2> fft_raw;
+  const FFTContainer& fft_raw() const { return frame->fft_raw; }
 
 private:
+  component::microphone::SoundFrame frame; ///< microphone data of the last update
+
   uint8_t _eventCount = 0; ///< count the beat events
   uint8_t _eventScale = 0; ///< indicates the scale event
 
-  ///< store the history of the fft, on a few successiv samples
-  FFTHistoryContainer _FFTHistory_beatDetector;
-  size_t historyIndex; ///< Actual history index
-  size_t historySize;  ///< Actual history size
+  BeatTrackerTy beatTracker; ///< beat detection, on the history of the fft
 
-  std::array<float, _fftChannels> fft_log_end_frequencies;
-
-  /// track the beat events using the FFT
-  template<size_t T> static inline std::array<bool, T> track_beat_events(const FFTHistoryContainer& dataHistory,
-                                                                         const std::array<float, T>& data)
-  {
-    std::array<bool, T> beats;
-    beats.fill(false);
+  uint32_t lastSequenceNumber = 0;        ///< sequence number of the last microphone capture
+  uint32_t nextHistorySequenceNumber = 0; ///< sequence number of the next capture to enter the beat history
 
-    // beat detection starts after a bit
-    const size_t dataHistoryCnt = dataHistory.size();
-    const float oneOverdataHistory = 1.0f / dataHistoryCnt;
-
-    std::array<float, T> averageFft;
-    averageFft.fill(0.0f);
-    for (const auto& fft: dataHistory)
-    {
-      for (size_t i = 0; i < T; i++)
-        averageFft[i] += fft[i] * oneOverdataHistory;
-    }
-
-    std::array<float, T> varianceFft;
-    varianceFft.fill(0.0f);
-    for (const auto& fft: dataHistory)
-    {
-      for (size_t i = 0; i < T; i++)
-      {
-        const float val = fft[i] - averageFft[i];
-        varianceFft[i] += val * val;
-      }
-    }
-
-    for (size_t i = 0; i < T; i++)
-    {
-      varianceFft[i] *= oneOverdataHistory;
-      const float stdDev = sqrtf(varianceFft[i]);
-      static constexpr float N = 1.5f;
-      // beat if > med + N * variance
-      // N=1 : greater than 68.0% of values
-      // N=2 : greater than 95.4% of values
-      // N=3 : greater than 99.6% of values
-      // N=4 : greater than 99.8% of values
-      beats[i] = data[i] > (averageFft[i] + N * stdDev);
-    }
-
-    return beats;
-  }
+  std::array<float, _fftChannels> fft_log_end_frequencies;
 };
 
 } // namespace lampda::modes::audio
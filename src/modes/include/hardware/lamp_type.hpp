@@ -26,6 +26,7 @@
 #include "src/system/utils/print.h"
 #include "src/system/utils/curves.h"
 #include "src/system/utils/constants.h"
+#include "src/system/utils/fast_trig.h"
 #include "src/system/utils/utils.h"
 
 #include "src/system/ext/math8.h"
@@ -592,9 +593,9 @@ public:
 #else
       static constexpr uint8_t minimumAllowedBrightness = ::lampda::minimumAllowedBrightness_8;
 #endif
-      using curve_t = utils::curves::LinearCurve<brightness_t, uint8_t>;
-      static curve_t brightnessCurve({curve_t::point_t {0, minimumAllowedBrightness},
-                                      curve_t::point_t {::lampda::brightness::absoluteMaximumBrightness, 255}});
+      using point_t = utils::curves::Point<brightness_t, uint8_t>;
+      static constexpr auto brightnessCurve = utils::curves::make_linear_curve<brightness_t, uint8_t>(
+              point_t {0, minimumAllowedBrightness}, point_t {::lampda::brightness::absoluteMaximumBrightness, 255});
 
       /// @warning: this is actually heavy to run
       strip.setBrightness(brightnessCurve.sample(trueNewBrightness));
@@ -614,11 +615,11 @@ public:
         component::outputPower::blip(50); // blip
       }
 
-      using curve_t = utils::curves::ExponentialCurve<brightness_t, uint16_t>;
-      static curve_t brightnessCurve(
-              curve_t::point_t {0, stripInputMinVoltage_mV},
-              curve_t::point_t {::lampda::brightness::absoluteMaximumBrightness, stripInputMaxVoltage_mV},
-              1.0);
+      // exponent 1 exponential is a straight line
+      using point_t = utils::curves::Point<brightness_t, float>;
+      static constexpr auto brightnessCurve = utils::curves::make_linear_curve<brightness_t, float>(
+              point_t {0, stripInputMinVoltage_mV},
+              point_t {::lampda::brightness::absoluteMaximumBrightness, stripInputMaxVoltage_mV});
 
       component::outputPower::write_voltage(round(brightnessCurve.sample(trueNewBrightness)));
     }
@@ -1056,13 +1057,26 @@ public:
   }
 
   /**
-   * \brief Return the an object containing sound analysis data
+   * \brief Return the an object containing sound analysis data, only valid during this frame
    */
-  component::microphone::SoundStruct& LMBD_INLINE get_sound_struct()
+  const component::microphone::SoundStruct& LMBD_INLINE get_sound_struct()
   {
     return component::microphone::get_sound_characteristics();
   }
 
+  /**
+   * \brief Return a view of the sound analysis data, without copy. The view is readable during this frame only.
+   */
+  component::microphone::SoundFrame LMBD_INLINE get_sound_frame() { return component::microphone::get_sound_frame(); }
+
+  /**
+   * \brief Return the compact sound analysis results (levels, bands, beats), only valid during this frame
+   */
+  const component::microphone::SoundFeatures& LMBD_INLINE get_sound_features()
+  {
+    return component::microphone::get_sound_features();
+  }
+
   /// Define a localy consistant saved brightness. Should be similar
   volatile brightness_t saved_brightness;
   /// Define a localy consistant temporary brightness
@@ -1178,8 +1192,8 @@ static constexpr float to_helix_z(const int16_t n)
  */
 static constexpr HelixXYZTy strip_to_helix_unconstraint(const int16_t n)
 {
-  return HelixXYZTy {hardware::LampTy::maxWidthFloat * cos_t(n / hardware::LampTy::ledPerTurns * c_TWO_PI),
-                     hardware::LampTy::maxWidthFloat * sin_t(n / hardware::LampTy::ledPerTurns * c_TWO_PI),
+  return HelixXYZTy {hardware::LampTy::maxWidthFloat * trig::cos(n / hardware::LampTy::ledPerTurns * c_TWO_PI),
+                     hardware::LampTy::maxWidthFloat * trig::sin(n / hardware::LampTy::ledPerTurns * c_TWO_PI),
                      to_helix_z(n)};
 }
 
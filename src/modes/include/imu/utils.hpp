@@ -7,6 +7,8 @@
 
 #include "src/system/component/imu.h"
 
+#include "src/system/hal/print.h"
+
 #include "src/system/utils/vector_math.h"
 
 #include "src/modes/include/particle_system/particle_system.hpp"
@@ -20,29 +22,63 @@ template<int temp = 0> struct ImuEventTy
 {
   /// last reading of the IMU
   bsp::imu::Reading lastReading;
+  /// time of the last reading, in microseconds (from the IMU interrupt when enabled)
+  uint32_t lastReadingTime_us = 0;
+
+  /// time of the latest tap, in microseconds (from the IMU interrupt), 0 if none since reset
+  uint32_t lastTapTime_us = 0;
+  /// time of the latest free fall, in microseconds (from the IMU interrupt), 0 if none since reset
+  uint32_t lastFreeFallTime_us = 0;
 
   /// Reset the IMU events.
-  /// Should be called before any use
-  void reset(auto& ctx)
+  /// Should be called before any use, in the mode on_enter_mode()
+  /// \param[in] particleCount Number of particles to lease for the particle system, from the shared pool
+  /// \return false if the particles could not be leased, the particle system then holds no particle
+  bool reset(auto& ctx, const uint16_t particleCount = 0)
   {
     // reset filter
     component::imu::get_filtered_reading(true);
 
-    // reset particles
-    particuleSystem.reset();
-    particuleSystem.set_max_particle_count(512);
+    // drop the events of the previous modes
+    component::imu::Event event;
+    while (component::imu::pop_event(event))
+    {
+    }
+    lastTapTime_us = 0;
+    lastFreeFallTime_us = 0;
+
+    // lease particles
+    if (not particuleSystem.lease(particleCount))
+    {
+      hal::lampda_print("imu events: particle pool exhausted, no particles");
+      return false;
+    }
+    return true;
   }
 
+  /// Return the particles to the shared pool.
+  /// Should be called in the mode on_exit_mode()
+  void release(auto& ctx) { particuleSystem.release(); }
+
   /// Call this once every tick inside the mode loop callback
   void update(auto& ctx)
   {
     //
     lastReading = component::imu::get_filtered_reading(false);
+    lastReadingTime_us = component::imu::get_reading_time_us();
+
+    component::imu::Event event;
+    while (component::imu::pop_event(event))
+    {
+      if (event.type == component::imu::EventType::Tap)
+        lastTapTime_us = event.time_us;
+      else if (event.type == component::imu::EventType::FreeFall)
+        lastFreeFallTime_us = event.time_us;
+    }
   }
 
-  /// ALL IMU ANIMATIONS SHARE THIS PARTICLE SYSTEM.
-  /// Spawn another if multiple systems should run in parralel
-  modes::ParticleSystem particuleSystem;
+  /// Particles of the IMU animations, leased from modes::particlePool in reset()
+  modes::PooledParticleSystem particuleSystem;
 
 private:
 };
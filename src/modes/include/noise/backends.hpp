@@ -0,0 +1,101 @@
+/*! \file backends.hpp
+    \brief Noise implementations, to select one per mode.
+*/
+
+#ifndef MODES_INCLUDE_NOISE_BACKENDS_HPP
+#define MODES_INCLUDE_NOISE_BACKENDS_HPP
+
+#include <cstdint>
+
+#include "src/system/ext/noise.h"
+
+/// User modes noise utilities
+namespace lampda::modes::noise {
+
+/**
+ * \brief 3D perlin noise backend (8 lattice corners per sample).
+ *
+ * Backends all have the same interface, a mode selects one with a type alias:
+ *
+ * @code{.cpp}
+ *
+ *    using NoiseTy = modes::noise::SimplexNoise;
+ *
+ *    uint8_t value = NoiseTy::inoise8(x, y, z);
+ *
+ * @endcode
+ */
+struct PerlinNoise
+{
+  /// 8 bits 2D noise, from 8.8 fixed point coordinates
+  static uint8_t inoise8(uint16_t x, uint16_t y) { return noise8::inoise(x, y); }
+
+  /// 8 bits 3D noise, from 8.8 fixed point coordinates
+  static uint8_t inoise8(uint16_t x, uint16_t y, uint16_t z) { return noise8::inoise(x, y, z); }
+
+  /// 8 bits 3D noise on a regular XY grid at a constant z, see noise8::inoise_grid
+  static void inoise8_grid(uint16_t x,
+                           uint16_t xStep,
+                           uint16_t width,
+                           uint16_t y,
+                           uint16_t yStep,
+                           uint16_t height,
+                           uint16_t z,
+                           uint8_t* out)
+  {
+    noise8::inoise_grid(x, xStep, width, y, yStep, height, z, out);
+  }
+
+  /// 16 bits 2D noise, from 16.16 fixed point coordinates
+  static uint16_t inoise16(uint32_t x, uint32_t y) { return noise16::inoise(x, y); }
+
+  /// 16 bits 3D noise, from 16.16 fixed point coordinates
+  static uint16_t inoise16(uint32_t x, uint32_t y, uint32_t z) { return noise16::inoise(x, y, z); }
+
+  /// 16 bits 3D noise on a batch of points, see noise16::inoise
+  static void inoise16(const uint32_t* x, const uint32_t* y, const uint32_t* z, uint16_t* out, uint16_t count)
+  {
+    noise16::inoise(x, y, z, out, count);
+  }
+};
+
+/**
+ * \brief 3D simplex noise backend (4 lattice corners per sample), cheaper than \ref PerlinNoise
+ */
+struct SimplexNoise
+{
+  /// \copydoc PerlinNoise::inoise8(uint16_t, uint16_t)
+  static uint8_t inoise8(uint16_t x, uint16_t y) { return simplex8::inoise(x, y); }
+
+  /// \copydoc PerlinNoise::inoise8(uint16_t, uint16_t, uint16_t)
+  static uint8_t inoise8(uint16_t x, uint16_t y, uint16_t z) { return simplex8::inoise(x, y, z); }
+
+  /// 8 bits 3D noise on a regular XY grid at a constant z, see simplex8::inoise_grid
+  static void inoise8_grid(uint16_t x,
+                           uint16_t xStep,
+                           uint16_t width,
+                           uint16_t y,
+                           uint16_t yStep,
+                           uint16_t height,
+                           uint16_t z,
+                           uint8_t* out)
+  {
+    simplex8::inoise_grid(x, xStep, width, y, yStep, height, z, out);
+  }
+
+  /// \copydoc PerlinNoise::inoise16(uint32_t, uint32_t)
+  static uint16_t inoise16(uint32_t x, uint32_t y) { return simplex16::inoise(x, y); }
+
+  /// \copydoc PerlinNoise::inoise16(uint32_t, uint32_t, uint32_t)
+  static uint16_t inoise16(uint32_t x, uint32_t y, uint32_t z) { return simplex16::inoise(x, y, z); }
+
+  /// 16 bits 3D noise on a batch of points, see simplex16::inoise
+  static void inoise16(const uint32_t* x, const uint32_t* y, const uint32_t* z, uint16_t* out, uint16_t count)
+  {
+    simplex16::inoise(x, y, z, out, count);
+  }
+};
+
+} // namespace lampda::modes::noise
+
+#endif
@@ -0,0 +1,272 @@
+/*! \file noise_field.hpp
+    \brief Low resolution 3D noise field, upsampled on the lamp leds.
+*/
+
+#ifndef MODES_INCLUDE_NOISE_NOISE_FIELD_HPP
+#define MODES_INCLUDE_NOISE_NOISE_FIELD_HPP
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "src/system/ext/math8.h"
+
+#include "src/modes/include/hardware/lamp_type.hpp"
+#include "src/modes/include/noise/backends.hpp"
+
+/// User modes noise utilities
+namespace lampda::modes::noise {
+
+/**
+ * \brief Configuration of a \ref NoiseField
+ */
+struct NoiseFieldConfig
+{
+  /// Noise implementation, see \ref PerlinNoise
+  using NoiseTy = PerlinNoise;
+  /// Distance between two lattice nodes, in leds (around the lamp) and in strip turns (along the lamp)
+  static constexpr uint8_t stride = 3;
+  /// Distance between two cached lattices on the z axis, in noise units. Must be a power of two
+  static constexpr uint32_t timeStep = 2048;
+};
+
+/**
+ * \brief 3D noise evaluated on a coarse lattice wrapped around the lamp body, and bilinearly upsampled on the leds.
+ *
+ * The noise is the same as sampling ``NoiseTy::inoise16(x + scale * X, y + scale * Y, z + scale * Z)`` for every led,
+ * with (X, Y, Z) the led position on the helix, but is only evaluated once every \p stride leds in both directions.
+ *
+ * For example:
+ *
+ * @code{.cpp}
+ *
+ *    struct StateTy
+ *    {
+ *      modes::noise::NoiseField<> field;
+ *    };
+ *
+ *    static void loop(auto& ctx) {
+ *      auto& field = ctx.state.field;
+ *
+ *      field.set_origin(x, y, scale);
+ *      field.update(z);
+ *      for (uint16_t i = 0; i < ctx.lamp.ledCount; ++i)
+ *        ctx.lamp.setPixelColor(i, colors::from_palette(field.sample(i), palette));
+ *    }
+ *
+ * @endcode
+ *
+ * When only z moves between two frames, the lattices at the two surrounding multiples of \p timeStep are cached
+ * and linearly blended: the noise is then evaluated once every \p timeStep z units instead of every frame.
+ * Moving the origin (x, y or scale) evaluates the lattice directly at z, on the next update.
+ *
+ * The upsampling error can be measured with \ref compute_upsampling_error, to tune \p stride.
+ */
+template<typename ConfigTy = NoiseFieldConfig> class NoiseField
+{
+public:
+  using LampTy = hardware::LampTy;
+  using NoiseTy = typename ConfigTy::NoiseTy; ///< \private
+
+  static constexpr uint8_t stride = ConfigTy::stride;     ///< \private
+  static constexpr uint32_t timeStep = ConfigTy::timeStep; ///< \private
+  static_assert(stride > 0, "stride must be positive");
+  static_assert(timeStep > 0 && (timeStep & (timeStep - 1)) == 0, "timeStep must be a power of two");
+
+  /// Lattice nodes around the lamp body (wrapping)
+  static constexpr uint16_t columns = ceil(LampTy::ledPerTurns / stride);
+  /// Lattice nodes along the lamp height
+  static constexpr uint16_t rows = static_cast<uint16_t>(LampTy::ledCount / LampTy::ledPerTurns / stride) + 2;
+  /// Lattice node count
+  static constexpr uint16_t nodeCount = columns * rows;
+  /// Strip turns per led, in Q16
+  static constexpr uint32_t turnsPerLed_q16 = 65536.0f / LampTy::ledPerTurns + 0.5f;
+
+  /// Reset the field, call this in the mode on_enter_mode callback
+  void reset()
+  {
+    isLatticeDirect = true;
+    areKeyframesValid = false;
+    set_origin(0, 0, 0);
+    lattice.fill(0);
+  }
+
+  /**
+   * \brief Set the origin and scale of the noise
+   * \param[in] x Noise offset along the X axis
+   * \param[in] y Noise offset along the Y axis
+   * \param[in] scale Noise scale, in noise units per led width
+   */
+  void set_origin(const uint32_t x, const uint32_t y, const uint16_t scale)
+  {
+    if (x == originX and y == originY and scale == originScale and not isLatticeDirect)
+      return;
+
+    originX = x;
+    originY = y;
+    if (scale != originScale)
+    {
+      originScale = scale;
+      // helix position of the lattice columns, only recomputed when the scale changes
+      for (uint16_t c = 0; c < columns; ++c)
+      {
+        const float angle = c * c_TWO_PI / columns;
+        columnOffsetX[c] = lroundf(scale * LampTy::maxWidthFloat * cosf(angle));
+        columnOffsetY[c] = lroundf(scale * LampTy::maxWidthFloat * sinf(angle));
+      }
+    }
+    // cached lattices are now out of date
+    areKeyframesValid = false;
+    isLatticeDirect = true;
+  }
+
+  /**
+   * \brief Update the lattice to a new z position. Call once per frame, before sampling.
+   * \param[in] z Noise offset along the Z axis
+   */
+  void update(const uint32_t z)
+  {
+    // origin moved: the cache is useless, evaluate directly
+    if (isLatticeDirect)
+    {
+      evaluate(lattice, z);
+      isLatticeDirect = false;
+      lastZ = z;
+      return;
+    }
+    if (z == lastZ)
+      return;
+    lastZ = z;
+
+    // refresh the keyframes surrounding z
+    const uint32_t baseZ = z & ~(timeStep - 1);
+    if (not areKeyframesValid or baseZ != keyframeZ)
+    {
+      if (areKeyframesValid and baseZ == keyframeZ + timeStep)
+      {
+        // moving forward, by a single step: reuse the upper keyframe
+        firstKeyframe ^= 1;
+        evaluate(keyframes[firstKeyframe ^ 1], baseZ + timeStep);
+      }
+      else
+      {
+        evaluate(keyframes[firstKeyframe], baseZ);
+        evaluate(keyframes[firstKeyframe ^ 1], baseZ + timeStep);
+      }
+      keyframeZ = baseZ;
+      areKeyframesValid = true;
+    }
+
+    // blend the keyframes
+    const uint32_t t = ((z - baseZ) << 8) / timeStep;
+    const auto& k0 = keyframes[firstKeyframe];
+    const auto& k1 = keyframes[firstKeyframe ^ 1];
+    for (uint16_t i = 0; i < nodeCount; ++i)
+    {
+      lattice[i] = (k0[i] * (256 - t) + k1[i] * t) >> 8;
+    }
+  }
+
+  /**
+   * \brief Sample the field at a led position, with a fixed point bilinear interpolation.
+   * \param[in] ledIndex Index of the led in the strip
+   * \return the 16 bits noise value at this led
+   */
+  uint16_t sample(const uint16_t ledIndex) const
+  {
+    const uint32_t turns_q16 = ledIndex * turnsPerLed_q16;
+    // position around the lamp, in lattice columns
+    const uint32_t column_q16 = (turns_q16 & 0xFFFF) * columns;
+    // position along the lamp, in lattice rows
+    const uint32_t row_q16 = turns_q16 / stride;
+
+    const uint16_t c0 = column_q16 >> 16;
+    const uint16_t c1 = (c0 + 1 >= columns) ? 0 : c0 + 1;
+    const uint16_t r0 = min<uint16_t>(row_q16 >> 16, rows - 2);
+    const uint32_t fx = (column_q16 >> 8) & 0xFF;
+    const uint32_t fy = (row_q16 >> 8) & 0xFF;
+
+    const uint16_t* row0 = &lattice[r0 * columns];
+    const uint16_t* row1 = row0 + columns;
+    const uint32_t top = (row0[c0] * (256 - fx) + row0[c1] * fx) >> 8;
+    const uint32_t bottom = (row1[c0] * (256 - fx) + row1[c1] * fx) >> 8;
+    return (top * (256 - fy) + bottom * fy) >> 8;
+  }
+
+  /**
+   * \brief Sample the noise directly at a led position, without the lattice.
+   * This is the reference of the field, and is much slower than \ref sample
+   * \param[in] ledIndex Index of the led in the strip
+   * \param[in] z Noise offset along the Z axis
+   */
+  uint16_t sample_direct(const uint16_t ledIndex, const uint32_t z) const
+  {
+    const float turns = ledIndex * turnsPerLed_q16 / 65536.0f;
+    const float angle = (turns - floorf(turns)) * c_TWO_PI;
+    return NoiseTy::inoise16(originX + lroundf(originScale * LampTy::maxWidthFloat * cosf(angle)),
+                            originY + lroundf(originScale * LampTy::maxWidthFloat * sinf(angle)),
+                            z + lroundf(-originScale * LampTy::ledStripWidth_mm * turns));
+  }
+
+  /**
+   * \brief Quality metric of the upsampling: compare the field to the direct noise on all leds.
+   * Heavy, use this to tune the configuration, not in a mode loop.
+   * \param[in] z Noise offset along the Z axis, the field must have been updated to it
+   * \return the root mean square error, in percent of the noise range
+   */
+  float compute_upsampling_error(const uint32_t z) const
+  {
+    float squaredErrorSum = 0.0f;
+    for (uint16_t i = 0; i < LampTy::ledCount; ++i)
+    {
+      const float error = (static_cast<float>(sample(i)) - sample_direct(i, z)) / UINT16_MAX;
+      squaredErrorSum += error * error;
+    }
+    return 100.0f * sqrtf(squaredErrorSum / LampTy::ledCount);
+  }
+
+private:
+  using LatticeTy = std::array<uint16_t, nodeCount>;
+
+  /// Evaluate the noise on all lattice nodes, at the given z
+  void evaluate(LatticeTy& target, const uint32_t z) const
+  {
+    uint32_t nodeX[columns];
+    uint32_t nodeY[columns];
+    uint32_t nodeZ[columns];
+    for (uint16_t c = 0; c < columns; ++c)
+    {
+      nodeX[c] = originX + columnOffsetX[c];
+      nodeY[c] = originY + columnOffsetY[c];
+    }
+
+    // one row at a time: nodes in a row are neighbors, and share the noise lattice cells
+    for (uint16_t r = 0; r < rows; ++r)
+    {
+      const uint32_t rowZ = z + lroundf(-originScale * LampTy::ledStripWidth_mm * r * stride);
+      for (uint16_t c = 0; c < columns; ++c)
+        nodeZ[c] = rowZ;
+      NoiseTy::inoise16(nodeX, nodeY, nodeZ, &target[r * columns], columns);
+    }
+  }
+
+  uint32_t originX = 0;     ///< noise origin on X
+  uint32_t originY = 0;     ///< noise origin on Y
+  uint16_t originScale = 0; ///< noise scale
+
+  std::array<int32_t, columns> columnOffsetX {}; ///< X offset of the lattice columns
+  std::array<int32_t, columns> columnOffsetY {}; ///< Y offset of the lattice columns
+
+  LatticeTy lattice {};      ///< lattice sampled by the leds
+  LatticeTy keyframes[2];    ///< cached lattices, at keyframeZ and keyframeZ + timeStep
+  uint8_t firstKeyframe = 0; ///< index of the keyframe at keyframeZ
+  uint32_t keyframeZ = 0;    ///< z of the first keyframe
+  uint32_t lastZ = 0;        ///< z of the last update
+
+  bool areKeyframesValid = false; ///< the keyframes match the origin
+  bool isLatticeDirect = true;    ///< the lattice must be evaluated directly, without the keyframes
+};
+
+} // namespace lampda::modes::noise
+
+#endif
@@ -9,9 +9,12 @@
 
 #include "src/system/utils/vector_math.h"
 #include "src/system/utils/constants.h"
+#include "src/system/utils/fast_trig.h"
 #include "src/system/utils/utils.h"
 
 #include "src/system/ext/math8.h"
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 
 namespace lampda::modes {
@@ -25,11 +28,50 @@ static constexpr float cylinderRadius_m = LampTy::lampBodyRadius_mm / 1000.0; //
 static constexpr float angularSpeedGain = 50000; ///< this gain compensate the angular acceleration for better display
 static constexpr float linearSpeedGain = 1.0;    ///< gain for the linear speeds
 static constexpr float reboundCoeff = 0.1;       ///< low rebound [0 - 1] on walls
-static constexpr float speedDampening = 0.92;    ///< low speed dampening [0-0.99] at every steps (viscosity)
+static constexpr float speedDampening = 0.92;    ///< low speed dampening [0-0.99] every dampening period (viscosity)
+static constexpr float speedDampeningPeriod_s = 0.012; ///< period of the speed dampening, in seconds
 
 static constexpr float maxAngularSpeed_radS = 4 * c_TWO_PI; ///< max angular speed in radians/s
 static constexpr float maxVerticalSpeed_mmS = 50;           ///< max vertical speed in mm/S
 
+static constexpr float angularUnit = LampTy::maxWidthFloat / c_TWO_PI; ///< max angle increment in a frame, radians
+static constexpr float verticalUnit = LampTy::ledStripWidth_mm * 1.5f; ///< max height increment in a frame, meters
+
+/**
+ * \brief Acceleration of an update, decomposed once for all the particles.
+ * On the cylinder surface, the angular speed increment of a particle at the angle theta is
+ * (-ax * sin(theta) + ay * cos(theta)) * R^2 * gain * dt, and the vertical speed increment is the same for all the
+ * particles.
+ */
+struct ParticleStep
+{
+  /**
+   * \param[in] accelerationCartesian_m Acceleration applied at this update
+   * \param[in] deltaTime_s Time since the latest update
+   */
+  ParticleStep(const utils::vec3d& accelerationCartesian_m, const float _deltaTime_s) :
+    deltaTime_s(_deltaTime_s),
+    dampening(powf(speedDampening, _deltaTime_s / speedDampeningPeriod_s)),
+    sinSpeedIncrement(-angularSpeedGain * cylinderRadius_m * cylinderRadius_m * accelerationCartesian_m.x *
+                      _deltaTime_s),
+    cosSpeedIncrement(angularSpeedGain * cylinderRadius_m * cylinderRadius_m * accelerationCartesian_m.y *
+                      _deltaTime_s),
+    zSpeedIncrement(linearSpeedGain * accelerationCartesian_m.z * _deltaTime_s),
+    maxAngularIncrement(angularUnit * _deltaTime_s / loopDeltaTime),
+    maxVerticalIncrement(verticalUnit * _deltaTime_s / loopDeltaTime)
+  {
+  }
+
+  float deltaTime_s;       ///< time since the latest update
+  float dampening;         ///< speed dampening of this update, the same per second whatever the update duration
+  float sinSpeedIncrement; ///< angular speed increment, per sinus of the particle angle
+  float cosSpeedIncrement; ///< angular speed increment, per cosinus of the particle angle
+  float zSpeedIncrement;   ///< vertical speed increment
+  // the position increments are limited per frame, whatever the number of steps in a frame
+  float maxAngularIncrement;  ///< max angle increment of this update, in radians
+  float maxVerticalIncrement; ///< max height increment of this update, in meters
+};
+
 /**
  * \brief Define a particle in 3D space. it has a position and speed
  */
@@ -42,7 +84,7 @@ struct Particle
   Particle(const utils::vec3d& positionCartesian) :
     thetaSpeed_radS(0.0),
     zSpeed_mS(0.0),
-    theta_rad(atan2(positionCartesian.y, positionCartesian.x)),
+    theta_rad(trig::atan2(positionCartesian.y, positionCartesian.x)),
     z_mm(positionCartesian.z)
   {
     _savedLampIndex = to_lamp_index_no_bounds();
@@ -69,20 +111,9 @@ struct Particle
    */
   utils::vec2d compute_speed_increment(const utils::vec3d& accelerationCartesian_m, const float deltaTime_s) const
   {
-    // speed vector on radial (derivative of cartesian to cylinder coordinates for theta)
-    const utils::vec3d e_theta(-sin_t(theta_rad) * cylinderRadius_m, cos_t(theta_rad) * cylinderRadius_m, 0);
-    // speed vector on z (derivative of cartesian to cylinder coordinates for z)
-    const utils::vec3d e_z(0, 0, 1);
-    // ignore the radius derivative, as we want to stay on the cylinder surface
-
-    // compute the speed vector on cylinder surface
-    const utils::vec3d& tangantialVector = e_theta.multiply(accelerationCartesian_m.dot(e_theta));
-    const utils::vec3d& directVector = e_z.multiply(accelerationCartesian_m.dot(e_z));
-    const utils::vec3d& accelerationVector = tangantialVector.add(directVector);
-
-    return utils::vec2d(angularSpeedGain * accelerationVector.dot(e_theta) / static_cast<float>(cylinderRadius_m) *
-                                deltaTime_s,
-                        linearSpeedGain * accelerationVector.dot(e_z) * deltaTime_s);
+    const ParticleStep step(accelerationCartesian_m, deltaTime_s);
+    return utils::vec2d(step.sinSpeedIncrement * trig::sin(theta_rad) + step.cosSpeedIncrement * trig::cos(theta_rad),
+                        step.zSpeedIncrement);
   }
 
   /**
@@ -95,36 +126,13 @@ struct Particle
                           const float deltaTime_s,
                           const bool shouldContrain = true)
   {
-    const auto& speedIncrement = compute_speed_increment(accelerationCartesian_m, deltaTime_s);
-    // start by dampening the speed
-    dampen_speed(speedDampening);
-
-    // update speed
-    thetaSpeed_radS =
-            lmpd_constrain<float>(thetaSpeed_radS + speedIncrement.x, -maxAngularSpeed_radS, maxAngularSpeed_radS);
-    zSpeed_mS = lmpd_constrain<float>(zSpeed_mS + speedIncrement.y, -maxVerticalSpeed_mmS, maxVerticalSpeed_mmS);
-
-    static constexpr float angularUnit = LampTy::maxWidthFloat / c_TWO_PI;
-    static constexpr float verticalUnit = LampTy::ledStripWidth_mm * 1.5f;
-
-    // update position (limit speed to pixel unit per dt)
-    const float angularPositionIncrement =
-            lmpd_constrain<float>(thetaSpeed_radS * deltaTime_s, -angularUnit, angularUnit);
-    const float verticalPositionIncrement =
-            lmpd_constrain<float>(zSpeed_mS * deltaTime_s, -verticalUnit, verticalUnit) * 1000.0;
-
-    // update particle position
-    z_mm += verticalPositionIncrement;
-    theta_rad += angularPositionIncrement;
-
-    // limit the derivation of the angle
-    theta_rad = wrap_angle(theta_rad);
-
-    // constrain to the lamp body
-    if (shouldContrain)
-      constraint_into_lamp_body();
-    else
-      _savedLampIndex = to_lamp_index_no_bounds();
+    integrate(ParticleStep(accelerationCartesian_m, deltaTime_s),
+              theta_rad,
+              z_mm,
+              thetaSpeed_radS,
+              zSpeed_mS,
+              _savedLampIndex,
+              shouldContrain);
   }
 
   /**
@@ -145,27 +153,156 @@ struct Particle
   /**
    * \brief Contrain the particle movement to the cylinder, limiting the movement at the extremities.
    */
-  void constraint_into_lamp_body()
+  void constraint_into_lamp_body() { constraint_into_lamp_body(theta_rad, z_mm, zSpeed_mS, _savedLampIndex); }
+
+  /**
+   * \brief Movement of a particle during an update, on its separate coordinates.
+   * The particle systems store the particles as separate arrays, and call this for all the particles in a loop.
+   * \param[in] step Acceleration of this update
+   * \param[in, out] theta_rad Angle of the particle
+   * \param[in, out] z_mm Height of the particle
+   * \param[in, out] thetaSpeed_radS Angular speed of the particle
+   * \param[in, out] zSpeed_mS Vertical speed of the particle
+   * \param[out] lampIndex Led index of the particle, after the update
+   * \param[in] shouldContrain If true, will constrain the movement into the lamp body.
+   */
+  static inline void integrate(const ParticleStep& step,
+                               float& theta_rad,
+                               float& z_mm,
+                               float& thetaSpeed_radS,
+                               float& zSpeed_mS,
+                               int16_t& lampIndex,
+                               const bool shouldContrain)
   {
-    _savedLampIndex = to_lamp_index_no_bounds();
+    const uint32_t angle_q24 = trig::to_turn_q24(theta_rad);
+    const float sinTheta = trig::sin_turn_q24(angle_q24) * (1.0f / 65535.0f);
+    const float cosTheta = trig::sin_turn_q24(angle_q24 + (1 << 22)) * (1.0f / 65535.0f);
+
+    // dampen the speed, then update it
+    thetaSpeed_radS = lmpd_constrain<float>(thetaSpeed_radS * step.dampening + step.sinSpeedIncrement * sinTheta +
+                                                    step.cosSpeedIncrement * cosTheta,
+                                            -maxAngularSpeed_radS,
+                                            maxAngularSpeed_radS);
+    zSpeed_mS = lmpd_constrain<float>(
+            zSpeed_mS * step.dampening + step.zSpeedIncrement, -maxVerticalSpeed_mmS, maxVerticalSpeed_mmS);
+
+    // update position (limit speed to pixel unit per frame)
+    const float angularPositionIncrement = lmpd_constrain<float>(
+            thetaSpeed_radS * step.deltaTime_s, -step.maxAngularIncrement, step.maxAngularIncrement);
+    const float verticalPositionIncrement =
+            lmpd_constrain<float>(
+                    zSpeed_mS * step.deltaTime_s, -step.maxVerticalIncrement, step.maxVerticalIncrement) *
+            1000.0f;
+
+    // update particle position
+    z_mm += verticalPositionIncrement;
+    // limit the derivation of the angle
+    theta_rad = wrap_angle(theta_rad + angularPositionIncrement);
+
+    // constrain to the lamp body
+    if (shouldContrain)
+      constraint_into_lamp_body(theta_rad, z_mm, zSpeed_mS, lampIndex);
+    else
+      lampIndex = to_led_index_no_bounds(theta_rad, z_mm);
+  }
+
+  /**
+   * \brief Follow the movement of a particle up to the first occupied led.
+   * A particle moving by more than a led in an update would jump over the leds in between: the segment of the movement
+   * is sampled every half led, and the movement stops on the last free sample before an occupied led.
+   * \param[in] fromTheta_rad Angle of the particle before the movement
+   * \param[in] fromZ_mm Height of the particle before the movement
+   * \param[in] fromIndex Led index of the particle before the movement
+   * \param[in, out] toTheta_rad Angle of the particle after the movement, moved back on collision
+   * \param[in, out] toZ_mm Height of the particle after the movement, moved back on collision
+   * \param[in, out] toIndex Led index of the particle after the movement, moved back on collision
+   * \param[in] isPositionTaken Occupancy of the leds: bool(int16_t)
+   * \return true if the movement stopped on an occupied led
+   */
+  static inline bool sweep(const float fromTheta_rad,
+                           const float fromZ_mm,
+                           const int16_t fromIndex,
+                           float& toTheta_rad,
+                           float& toZ_mm,
+                           int16_t& toIndex,
+                           const auto& isPositionTaken)
+  {
+    // shortest way around the lamp
+    float angle_rad = toTheta_rad - fromTheta_rad;
+    if (angle_rad > c_PI)
+      angle_rad -= c_TWO_PI;
+    else if (angle_rad < -c_PI)
+      angle_rad += c_TWO_PI;
+    const float height_mm = toZ_mm - fromZ_mm;
+
+    const uint16_t sampleCount =
+            ceilf(2.0f * std::max(fabsf(angle_rad) * LampTy::lampBodyRadius_mm / LampTy::ledSize_mm,
+                                  fabsf(height_mm) / LampTy::ledStripWidth_mm));
+    // at most one led away: only the destination
+    if (sampleCount <= 1)
+    {
+      if (toIndex == fromIndex or not isPositionTaken(toIndex))
+        return false;
+
+      toTheta_rad = fromTheta_rad;
+      toZ_mm = fromZ_mm;
+      toIndex = fromIndex;
+      return true;
+    }
+
+    float freeTheta_rad = fromTheta_rad;
+    float freeZ_mm = fromZ_mm;
+    int16_t freeIndex = fromIndex;
+    for (uint16_t sample = 1; sample < sampleCount; ++sample)
+    {
+      const float progress = sample / static_cast<float>(sampleCount);
+      const float theta_rad = wrap_angle(fromTheta_rad + angle_rad * progress);
+      const float z_mm = fromZ_mm + height_mm * progress;
+      const int16_t index = to_led_index_no_bounds(theta_rad, z_mm);
+      if (index != fromIndex and isPositionTaken(index))
+      {
+        toTheta_rad = freeTheta_rad;
+        toZ_mm = freeZ_mm;
+        toIndex = freeIndex;
+        return true;
+      }
 
+      freeTheta_rad = theta_rad;
+      freeZ_mm = z_mm;
+      freeIndex = index;
+    }
+
+    // the destination, exactly
+    if (toIndex == fromIndex or not isPositionTaken(toIndex))
+      return false;
+
+    toTheta_rad = freeTheta_rad;
+    toZ_mm = freeZ_mm;
+    toIndex = freeIndex;
+    return true;
+  }
+
+  /**
+   * \brief Contrain a particle movement to the cylinder, limiting the movement at the extremities.
+   */
+  static void constraint_into_lamp_body(const float theta_rad, float& z_mm, float& zSpeed_mS, int16_t& lampIndex)
+  {
     // coordinates go from 0 to -max
     if (z_mm > 0)
     {
       z_mm = 0;
       zSpeed_mS = -zSpeed_mS * reboundCoeff;
-      _savedLampIndex = to_lamp_index_no_bounds();
     }
 
     if (z_mm < -LampTy::lampHeight_mm)
     {
       z_mm = -LampTy::lampHeight_mm;
       zSpeed_mS = -zSpeed_mS * reboundCoeff;
-      _savedLampIndex = to_lamp_index_no_bounds();
     }
+    lampIndex = to_led_index_no_bounds(theta_rad, z_mm);
 
     // handle the real limits (led strip do not start and end at zero depth)
-    if (not is_led_index_valid(_savedLampIndex))
+    if (not is_led_index_valid(lampIndex))
     {
       // we are too high above the first led
       if (z_mm >= 0)
@@ -181,7 +318,7 @@ struct Particle
         zSpeed_mS = -zSpeed_mS * reboundCoeff;
       }
       // udpate index
-      _savedLampIndex = to_lamp_index_no_bounds();
+      lampIndex = to_led_index_no_bounds(theta_rad, z_mm);
     }
   }
 
@@ -0,0 +1,339 @@
+/*! \file particle_interactions.hpp
+    \brief Forces between the particles of a particle system, for fluid like effects.
+*/
+
+#ifndef PARTICLE_INTERACTIONS_H
+#define PARTICLE_INTERACTIONS_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "src/modes/include/hardware/lamp_type.hpp"
+
+#include "particle_pool.hpp"
+#include "particle_system.hpp"
+
+namespace lampda::modes {
+
+/**
+ * \brief Configuration of \ref ParticleInteractionsTy
+ */
+struct ParticleInteractionConfig
+{
+  /// Distance under which two particles interact, in millimeters on the lamp surface
+  static constexpr float radius_mm = 2.0f * LampTy::ledStripWidth_mm;
+  /// Density of a particle at rest: above, the particles push each other, below, they attract each other
+  static constexpr float restDensity = 1.0f;
+  /// Acceleration per unit of density above the rest density, in mm/s^2
+  static constexpr float stiffness = 2000.0f;
+  /// Acceleration per unit of near density, in mm/s^2: short range repulsion, keeps the particles apart
+  static constexpr float nearStiffness = 4000.0f;
+  /// Smoothing of the speed differences between neighbors, in 1/s
+  static constexpr float viscosity = 10.0f;
+};
+
+/**
+ * \brief Interactions between the particles of a particle system, like a small SPH (smoothed particle hydrodynamics)
+ * solver on the cylinder surface.
+ *
+ * The particles closer than the interaction radius are neighbors, with a weight q = 1 - distance / radius. The density
+ * of a particle is the sum of q^2 over its neighbors, and its near density the sum of q^3. The neighbors then push or
+ * pull each other along their axis, with the pressures of the two particles:
+ * - pressure = stiffness * (density - restDensity): repulsion in the crowded areas, cohesion in the sparse ones,
+ * - near pressure = nearStiffness * nearDensity: strong repulsion at short distances, so that the particles do not
+ *   clump together,
+ * and the viscosity smooths the speeds of the neighbors.
+ *
+ * The neighbors are found with a spatial hash on a grid of the lamp surface, with cells the size of the radius
+ * (2x2 leds by default): a particle only looks at the 3x3 cells around it, wrapping around the lamp. The cost is linear
+ * in the particle count, as long as the particles are spread (with the collisions of the particle system, there is at
+ * most one particle per led).
+ *
+ * Particles out of the lamp body have no interactions.
+ *
+ * The per particle arrays of the solver are leased from the \ref particlePool, like the particles: they have the types
+ * of the particle arrays, and the interactions hold no memory when their mode is not active.
+ *
+ * @code{.cpp}
+ *
+ *    struct StateTy
+ *    {
+ *      modes::ParticleInteractionsTy<> interactions;
+ *    };
+ *
+ *    static void on_enter_mode(auto& ctx) { ctx.state.interactions.lease(particleCount); }
+ *    static void on_exit_mode(auto& ctx) { ctx.state.interactions.release(); }
+ *
+ *    static void loop(auto& ctx) {
+ *      auto& particleSystem = ctx.state.imuEvent.particuleSystem;
+ *      particleSystem.simulate(acceleration, frameDuration_s, true, true, [&](const float stepDuration_s) {
+ *        ctx.state.interactions.apply(particleSystem, stepDuration_s);
+ *      });
+ *    }
+ *
+ * @endcode
+ *
+ */
+template<typename ConfigTy = ParticleInteractionConfig> class ParticleInteractionsTy
+{
+public:
+  static constexpr float radius_mm = ConfigTy::radius_mm; ///< \private
+  static constexpr float circumference_mm = LampTy::lampBodyCircumpherence_mm; ///< \private
+
+  /// Grid cells around the lamp body (wrapping), at least as wide as the radius
+  static constexpr uint16_t columns = circumference_mm / radius_mm;
+  /// Width of a grid cell, in millimeters
+  static constexpr float columnWidth_mm = circumference_mm / columns;
+  /// Grid cells along the lamp height, as high as the radius
+  static constexpr uint16_t rows = static_cast<uint16_t>(LampTy::lampHeight_mm / radius_mm) + 1;
+  /// Grid cell count
+  static constexpr uint16_t cellCount = columns * rows;
+
+  static_assert(columns >= 3, "the interaction radius must be smaller than a third of the lamp circumference");
+
+  ParticleInteractionsTy() = default;
+  ~ParticleInteractionsTy() { release(); }
+
+  ParticleInteractionsTy(const ParticleInteractionsTy&) = delete;
+  ParticleInteractionsTy& operator=(const ParticleInteractionsTy&) = delete;
+
+  /**
+   * \brief Lease the arrays of the solver from the pool, releasing the previous ones
+   * \param[in] maxParticleCount Capacity of the particle systems this works on
+   * \return true if the arrays were leased. If not, there is no interaction
+   */
+  bool lease(const uint16_t maxParticleCount)
+  {
+    release();
+    set_scratch(particlePool.lease(maxParticleCount));
+    return scratch.capacity == maxParticleCount;
+  }
+
+  /// Return the arrays of the solver to the pool
+  void release()
+  {
+    particlePool.release(scratch);
+    set_scratch({});
+  }
+
+  /**
+   * \brief Apply the interaction forces to the speeds of the particles
+   * \param[in, out] system The particle system
+   * \param[in] deltaTime_s Time since last update, in seconds
+   */
+  void apply(ParticleSystemBase& system, const float deltaTime_s)
+  {
+    update_densities(system);
+
+    // pressures, from the densities
+    for (uint16_t sorted = 0; sorted < sortedCount; ++sorted)
+    {
+      pressure[sorted] = ConfigTy::stiffness * (pressure[sorted] - ConfigTy::restDensity);
+      nearPressure[sorted] = ConfigTy::nearStiffness * nearPressure[sorted];
+    }
+
+    const ParticleStorage particles = system.get_storage();
+    for (uint16_t sorted = 0; sorted < sortedCount; ++sorted)
+    {
+      const uint16_t i = cellSlots[sorted];
+      const float speedU_mmS = particles.thetaSpeed_radS[i] * LampTy::lampBodyRadius_mm;
+      const float speedV_mmS = particles.zSpeed_mS[i] * 1000.0f;
+
+      float accelerationU = 0.0f;
+      float accelerationV = 0.0f;
+      for_each_neighbor(sorted, [&](const uint16_t neighbor, const float du, const float dv, const float q) {
+        const uint16_t j = cellSlots[neighbor];
+        const float distance = radius_mm * (1.0f - q);
+
+        // positive pushes the particles apart, negative pulls them together
+        const float pairPressure = pressure[sorted] + pressure[neighbor];
+        const float pairNearPressure = nearPressure[sorted] + nearPressure[neighbor];
+        const float push = 0.5f * q * (pairPressure + pairNearPressure * q);
+        if (distance > 0.001f)
+        {
+          accelerationU -= push * du / distance;
+          accelerationV -= push * dv / distance;
+        }
+
+        const float viscosity = ConfigTy::viscosity * q;
+        accelerationU += viscosity * (particles.thetaSpeed_radS[j] * LampTy::lampBodyRadius_mm - speedU_mmS);
+        accelerationV += viscosity * (particles.zSpeed_mS[j] * 1000.0f - speedV_mmS);
+      });
+
+      particles.thetaSpeed_radS[i] += accelerationU * deltaTime_s / LampTy::lampBodyRadius_mm;
+      particles.zSpeed_mS[i] += accelerationV * deltaTime_s / 1000.0f;
+    }
+  }
+
+  /**
+   * \brief Sort the particles in the grid, and compute their densities
+   * \param[in] system The particle system
+   */
+  void update_densities(const ParticleSystemBase& system)
+  {
+    const ParticleStorage particles = system.get_storage();
+    // not leased, or too small for this system: no interaction
+    if (particles.capacity > scratch.capacity)
+    {
+      sortedCount = 0;
+      return;
+    }
+    build_grid(particles, system.get_number_of_active());
+
+    for (uint16_t sorted = 0; sorted < sortedCount; ++sorted)
+    {
+      float density = 0.0f;
+      float nearDensity = 0.0f;
+      for_each_neighbor(sorted, [&](const uint16_t, const float, const float, const float q) {
+        const float q2 = q * q;
+        density += q2;
+        nearDensity += q2 * q;
+      });
+      pressure[sorted] = density;
+      nearPressure[sorted] = nearDensity;
+    }
+  }
+
+  /// Return the density of a particle in the lamp body, from its slot index, after update_densities()
+  float get_density(const uint16_t slot) const { return pressure[sortedIndex[slot]]; }
+  /// Return the near density of a particle in the lamp body, from its slot index, after update_densities()
+  float get_near_density(const uint16_t slot) const { return nearPressure[sortedIndex[slot]]; }
+  /// Return the number of particles in the lamp body, after an update
+  uint16_t get_interacting_count() const { return sortedCount; }
+
+  /// Return the grid cell of a position, noCell if out of the lamp body
+  static int16_t cell_of(const float theta_rad, const float z_mm)
+  {
+    if (z_mm > 0.0f or z_mm < -LampTy::lampHeight_mm)
+      return noCell;
+
+    const uint16_t row = lmpd_constrain<int16_t>(-z_mm / radius_mm, 0, rows - 1);
+    const uint16_t column = lmpd_constrain<int16_t>(to_surface(theta_rad) / columnWidth_mm, 0, columns - 1);
+    return row * columns + column;
+  }
+
+private:
+  /// marks the particles out of the lamp body
+  static constexpr int16_t noCell = -1;
+
+  /// Position around the lamp, in millimeters in [0, circumference[
+  static float to_surface(const float theta_rad)
+  {
+    const float u = wrap_angle(theta_rad) * LampTy::lampBodyRadius_mm;
+    return u < 0.0f ? u + circumference_mm : u;
+  }
+
+  /// Sort the particles by grid cell (counting sort), with their positions on the lamp surface
+  void build_grid(const ParticleStorage& particles, const uint16_t aliveCount)
+  {
+    for (uint16_t cell = 0; cell <= cellCount; ++cell)
+      cellStart[cell] = 0;
+
+    for (uint16_t alive = 0; alive < aliveCount; ++alive)
+    {
+      const uint16_t i = particles.aliveSlots[alive];
+      particleCell[i] = cell_of(particles.theta_rad[i], particles.z_mm[i]);
+      if (particleCell[i] != noCell)
+        cellStart[particleCell[i] + 1] += 1;
+    }
+
+    // cellStart[cell] is the first sorted particle of the cell
+    for (uint16_t cell = 0; cell < cellCount; ++cell)
+      cellStart[cell + 1] += cellStart[cell];
+    sortedCount = cellStart[cellCount];
+
+    for (uint16_t alive = 0; alive < aliveCount; ++alive)
+    {
+      const uint16_t i = particles.aliveSlots[alive];
+      if (particleCell[i] == noCell)
+        continue;
+
+      const uint16_t sorted = cellStart[particleCell[i]]++;
+      cellSlots[sorted] = i;
+      sortedIndex[i] = sorted;
+      sortedU[sorted] = to_surface(particles.theta_rad[i]);
+      sortedZ[sorted] = particles.z_mm[i];
+    }
+
+    // the placement moved every start to the next cell
+    for (uint16_t cell = cellCount; cell > 0; --cell)
+      cellStart[cell] = cellStart[cell - 1];
+    cellStart[0] = 0;
+  }
+
+  /**
+   * \brief Call a function for all the neighbors of a particle
+   * \param[in] sorted Sorted index of the particle
+   * \param[in] callback Function of the neighbor sorted index, its position relative to the particle (around and along
+   * the lamp, in millimeters), and its weight in ]0, 1]: void(uint16_t, float, float, float)
+   */
+  void for_each_neighbor(const uint16_t sorted, const auto& callback) const
+  {
+    const float u = sortedU[sorted];
+    const float z = sortedZ[sorted];
+    const int16_t cell = particleCell[cellSlots[sorted]];
+    const int16_t row = cell / columns;
+    const int16_t column = cell % columns;
+
+    for (int16_t neighborRow = row - 1; neighborRow <= row + 1; ++neighborRow)
+    {
+      if (neighborRow < 0 or neighborRow >= rows)
+        continue;
+
+      for (int16_t columnOffset = -1; columnOffset <= 1; ++columnOffset)
+      {
+        const uint16_t neighborColumn = (column + columnOffset + columns) % columns;
+        const uint16_t neighborCell = neighborRow * columns + neighborColumn;
+        for (uint16_t neighbor = cellStart[neighborCell]; neighbor < cellStart[neighborCell + 1]; ++neighbor)
+        {
+          if (neighbor == sorted)
+            continue;
+
+          // shortest way around the lamp
+          float du = sortedU[neighbor] - u;
+          if (du > circumference_mm * 0.5f)
+            du -= circumference_mm;
+          else if (du < -circumference_mm * 0.5f)
+            du += circumference_mm;
+          const float dv = sortedZ[neighbor] - z;
+
+          const float squaredDistance = du * du + dv * dv;
+          if (squaredDistance >= radius_mm * radius_mm)
+            continue;
+          callback(neighbor, du, dv, 1.0f - sqrtf(squaredDistance) / radius_mm);
+        }
+      }
+    }
+  }
+
+  /// Use leased particle arrays for the arrays of the solver
+  void set_scratch(const ParticleStorage& storage)
+  {
+    scratch = storage;
+    particleCell = storage.lampIndex;
+    sortedIndex = storage.slotLink;
+    cellSlots = storage.aliveSlots;
+    sortedU = storage.theta_rad;
+    sortedZ = storage.z_mm;
+    pressure = storage.thetaSpeed_radS;
+    nearPressure = storage.zSpeed_mS;
+    sortedCount = 0;
+  }
+
+  uint16_t cellStart[cellCount + 1]; ///< first sorted particle of each cell
+  ParticleStorage scratch;           ///< leased arrays, of the particles capacity
+  int16_t* particleCell = nullptr;   ///< cell of each slot
+  uint16_t* sortedIndex = nullptr;   ///< sorted index of each slot
+
+  // the particles sorted by cell: the neighbors of a particle are contiguous
+  uint16_t* cellSlots = nullptr; ///< slots of the sorted particles
+  float* sortedU = nullptr;      ///< position around the lamp, in millimeters
+  float* sortedZ = nullptr;      ///< height, in millimeters
+  float* pressure = nullptr;     ///< density, then pressure
+  float* nearPressure = nullptr; ///< near density, then near pressure
+  uint16_t sortedCount = 0;      ///< particles in the grid
+};
+
+} // namespace lampda::modes
+
+#endif
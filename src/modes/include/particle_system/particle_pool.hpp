@@ -0,0 +1,162 @@
+/*! \file particle_pool.hpp
+    \brief Storage of the particles, and the particle pool shared by the modes.
+*/
+
+#ifndef PARTICLE_POOL_H
+#define PARTICLE_POOL_H
+
+#include <cstdint>
+
+namespace lampda::modes {
+
+/// Number of particles in the pool shared by the modes
+static constexpr uint16_t particlePoolCapacity = 512;
+
+/**
+ * \brief View on the arrays of a particle system: positions, speeds and slot bookkeeping
+ * A storage with no capacity holds no particle.
+ */
+struct ParticleStorage
+{
+  float* theta_rad = nullptr;       ///< angle of the particles, in radians
+  float* z_mm = nullptr;            ///< height of the particles, in millimeters
+  float* thetaSpeed_radS = nullptr; ///< angular speed of the particles, in radian/seconds
+  float* zSpeed_mS = nullptr;       ///< vertical speed of the particles, in meter/seconds
+  int16_t* lampIndex = nullptr;     ///< led index of the particles
+  uint16_t* slotLink = nullptr;     ///< free list and live particle positions
+  uint16_t* aliveSlots = nullptr;   ///< slots of the live particles, packed
+  uint16_t capacity = 0;            ///< number of particles in the arrays
+
+  /// Return the storage of the particles [start, start + count[
+  ParticleStorage slice(const uint16_t start, const uint16_t count) const
+  {
+    return {theta_rad + start,
+            z_mm + start,
+            thetaSpeed_radS + start,
+            zSpeed_mS + start,
+            lampIndex + start,
+            slotLink + start,
+            aliveSlots + start,
+            count};
+  }
+};
+
+/**
+ * \brief Arrays of particles, sized at compile time
+ * \param[in] capacity Number of particles
+ */
+template<uint16_t capacity> struct ParticleArrays
+{
+  float theta_rad[capacity];
+  float z_mm[capacity];
+  float thetaSpeed_radS[capacity];
+  float zSpeed_mS[capacity];
+  int16_t lampIndex[capacity];
+  uint16_t slotLink[capacity];
+  uint16_t aliveSlots[capacity];
+
+  /// Return a view on all the arrays
+  ParticleStorage storage()
+  {
+    return {theta_rad, z_mm, thetaSpeed_radS, zSpeed_mS, lampIndex, slotLink, aliveSlots, capacity};
+  }
+};
+
+/**
+ * \brief Pool of particles, leased to the particle systems
+ *
+ * The mode states are all resident in memory: a particle system per mode state would keep its particles even when the
+ * mode is not active. The modes lease their particles from this pool when they are entered, and return them when they
+ * exit.
+ *
+ * A lease is a contiguous range of the pool, allocated with a first fit in the gaps between the current leases.
+ *
+ * \param[in] capacity Number of particles of the pool
+ */
+template<uint16_t capacity> class ParticlePoolTy
+{
+public:
+  /// Maximum number of simultaneous leases
+  static constexpr uint8_t maxLeaseCount = 4;
+
+  /**
+   * \brief Lease particles from the pool
+   * \param[in] count Number of particles to lease
+   * \return The storage of the particles, with no capacity if the pool has no range of this size left
+   */
+  ParticleStorage lease(const uint16_t count)
+  {
+    if (count == 0 or leaseCount >= maxLeaseCount)
+      return {};
+
+    // first gap large enough, leases are sorted by start
+    uint16_t start = 0;
+    uint8_t position = 0;
+    for (; position < leaseCount; ++position)
+    {
+      if (leases[position].start - start >= count)
+        break;
+      start = leases[position].start + leases[position].count;
+    }
+    if (capacity - start < count)
+      return {};
+
+    for (uint8_t i = leaseCount; i > position; --i)
+      leases[i] = leases[i - 1];
+    leases[position] = {start, count};
+    leaseCount += 1;
+    return arrays.storage().slice(start, count);
+  }
+
+  /**
+   * \brief Return leased particles to the pool
+   * \param[in] storage A storage returned by lease(). Storages with no capacity are ignored
+   */
+  void release(const ParticleStorage& storage)
+  {
+    if (storage.capacity == 0)
+      return;
+
+    const uint16_t start = storage.theta_rad - arrays.theta_rad;
+    for (uint8_t position = 0; position < leaseCount; ++position)
+    {
+      if (leases[position].start != start)
+        continue;
+
+      leaseCount -= 1;
+      for (uint8_t i = position; i < leaseCount; ++i)
+        leases[i] = leases[i + 1];
+      return;
+    }
+  }
+
+  /// Return the number of particles not leased
+  uint16_t get_free_count() const
+  {
+    uint16_t freeCount = capacity;
+    for (uint8_t position = 0; position < leaseCount; ++position)
+      freeCount -= leases[position].count;
+    return freeCount;
+  }
+
+private:
+  struct Lease
+  {
+    uint16_t start;
+    uint16_t count;
+  };
+
+  ParticleArrays<capacity> arrays;
+  Lease leases[maxLeaseCount];
+  uint8_t leaseCount = 0;
+};
+
+/// Pool with the default capacity
+using ParticlePool = ParticlePoolTy<particlePoolCapacity>;
+
+/// Particles shared by the modes
+inline ParticlePool particlePool;
+
+} // namespace lampda::modes
+
+#endif
@@ -5,15 +5,18 @@
 #ifndef PARTICLE_SYSTEM_H
 #define PARTICLE_SYSTEM_H
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdint>
-#include <functional>
-#include <set>
 
 #include "src/system/ext/random8.h"
+#include "src/system/hal/time.h"
 
 #include "src/modes/include/hardware/lamp_type.hpp"
 
 #include "particle.hpp"
+#include "particle_pool.hpp"
 
 namespace lampda::modes {
 
@@ -22,21 +25,51 @@ using LampTy = hardware::LampTy;
 /**
  * \brief Define a particle system
  * ALL PARTICLE SYSTEM SHARE THE SAME PÄRTICLE SUBSET
+ *
+ * The particles are stored as separate arrays of positions and speeds: an update runs the movement equations of all
+ * the particles in a single loop, with the acceleration decomposed once (see \ref ParticleStep).
+ *
+ * The free slots are chained in a free list, and the indexes of the live particles are kept packed in an array: a
+ * spawn or a depop is O(1), and the updates only visit the live particles.
+ *
+ * The callbacks (position generators, depop conditions, color samplers) are template parameters: they are called
+ * for each particle, and a lambda inlines into the particle loop, where a std::function is an indirect call.
+ *
+ * The modes advance the simulation with simulate(), in steps of a fixed duration: the movements do not depend on the
+ * frame rate, and a particle moving by more than a led in a step is stopped by the occupied leds on its way.
+ *
+ * The arrays of particles are not part of this class: see \ref ParticleSystemTy for a system with its own particles,
+ * and \ref PooledParticleSystem for a system leasing its particles from the \ref particlePool.
  */
-class ParticleSystem
+class ParticleSystemBase
 {
+  /// the interactions work on all the particles at once
+  template<typename ConfigTy> friend class ParticleInteractionsTy;
+
 public:
-  ParticleSystem() : particuleCount(0) { reset(); }
+  /// Duration of a simulation step, in microseconds
+  static constexpr uint32_t simulationStep_us = 6000;
+  /// Duration of a simulation step, in seconds
+  static constexpr float simulationStep_s = simulationStep_us / 1e6f;
+  /// Maximum number of simulation steps in a frame
+  static constexpr uint8_t maxStepsPerFrame = 8;
+
+  ParticleSystemBase() : particuleCount(0) { reset(); }
 
   /**
    * \brief  reset system to zero count
    */
   void reset()
   {
-    occupiedSpacesSet.clear();
-    for (size_t i = 0; i < ParticleSystem::maxParticuleCount; ++i)
+    occupiedSpaces.fill(0);
+    aliveCount = 0;
+    timeAccumulator_us = 0;
+
+    // chain all the usable slots, in order
+    firstFreeSlot = particuleCount > 0 ? 0 : noSlot;
+    for (uint16_t i = 0; i < particuleCount; ++i)
     {
-      isAllocated[i] = false;
+      slotLink[i] = (i + 1 < particuleCount) ? i + 1 : noSlot;
     }
   }
 
@@ -46,44 +79,119 @@ public:
    */
   void set_max_particle_count(const uint16_t _particleCount)
   {
-    particuleCount = std::min<uint16_t>(ParticleSystem::maxParticuleCount, _particleCount);
+    particuleCount = std::min<uint16_t>(capacity, _particleCount);
     reset();
   }
 
+  /// Return the number of particles of the storage
+  uint16_t get_capacity() const { return capacity; }
+
   /**
    * \brief Init the particles from a initialization function
-   * \param[in] positionGeneratorFunction Function that takes an index and return a ledstrip index
+   * \param[in] positionGeneratorFunction Function that takes an index and return a ledstrip index:
+   * int16_t(size_t)
    */
-  void init_particules(const std::function<int16_t(size_t)>& positionGeneratorFunction)
+  void init_particules(const auto& positionGeneratorFunction)
   {
-    occupiedSpacesSet.clear();
-    for (size_t i = 0; i < particuleCount; ++i)
+    // the free list gives the slots in order
+    reset();
+    while (firstFreeSlot != noSlot)
     {
-      isAllocated[i] = false;
-      spawn_particule(i, positionGeneratorFunction);
+      spawn_particule(positionGeneratorFunction);
     }
   }
 
   /**
    * \brief Init the particles from a initialization function, in a timed defered way.
    * \param[in] maxParticlesToPop Maximum particles to spawn at this call
-   * \param[in] positionGeneratorFunction Function that takes an index and return a led strip index
+   * \param[in] positionGeneratorFunction Function that takes an index and return a led strip index:
+   * int16_t(size_t)
    */
-  void init_deferred_particules(uint8_t maxParticlesToPop,
-                                const std::function<int16_t(size_t)>& positionGeneratorFunction)
+  void init_deferred_particules(uint8_t maxParticlesToPop, const auto& positionGeneratorFunction)
   {
-    for (size_t i = 0; i < particuleCount and maxParticlesToPop > 0; ++i)
+    while (firstFreeSlot != noSlot and maxParticlesToPop > 0)
     {
-      if (isAllocated[i])
-      {
-        // already allocated, do not reuse
-        continue;
-      }
-      spawn_particule(i, positionGeneratorFunction);
+      spawn_particule(positionGeneratorFunction);
       maxParticlesToPop--;
     }
   }
 
+  /**
+   * \brief Advance the particle simulation by the duration of a frame, in fixed steps
+   * The frame durations are accumulated, and the simulation runs as many steps of simulationStep_us as they hold: the
+   * particles move the same whatever the frame rate of the lamp, and the fast particles move by less than a led per
+   * step. The steps are timed, and a frame runs no more steps than the simulation budget allows (see
+   * set_simulation_budget): the time that could not be simulated is dropped, the simulation slows down instead of
+   * delaying the next frames.
+   * \param[in] accelerationCartesian 3d acceleration vector to apply to particles
+   * \param[in] frameDuration_s Time since last frame, in seconds
+   * \param[in] withCollisions If true, use iterate_with_collisions, else iterate_no_collisions
+   * \param[in] shouldContrain If true, will constrain the particles to the lamp body.
+   * \param[in] beforeStepFunction Called before each step with the step duration in seconds, to apply other forces
+   * to the particles: void(float)
+   * \return The number of steps simulated
+   */
+  uint8_t simulate(const utils::vec3d& accelerationCartesian,
+                   const float frameDuration_s,
+                   const bool withCollisions,
+                   const bool shouldContrain,
+                   const auto& beforeStepFunction)
+  {
+    timeAccumulator_us += lroundf(frameDuration_s * 1e6f);
+
+    uint8_t stepCount = std::min<uint32_t>(timeAccumulator_us / simulationStep_us, maxStepsPerFrame);
+    if (stepDuration_us > 0)
+    {
+      // at least a step per frame, the particles never freeze
+      stepCount = std::min<uint32_t>(stepCount, std::max<uint32_t>(1, simulationBudget_us / stepDuration_us));
+    }
+    timeAccumulator_us -= stepCount * simulationStep_us;
+    // drop the steps over budget
+    timeAccumulator_us %= simulationStep_us;
+    if (stepCount == 0)
+      return 0;
+
+    const uint64_t start_us = hal::time_us();
+    for (uint8_t step = 0; step < stepCount; ++step)
+    {
+      beforeStepFunction(simulationStep_s);
+      if (withCollisions)
+        iterate_with_collisions(accelerationCartesian, simulationStep_s, shouldContrain);
+      else
+        iterate_no_collisions(accelerationCartesian, simulationStep_s, shouldContrain);
+    }
+
+    // running average of the step duration
+    const uint32_t measuredStepDuration_us = std::max<uint32_t>(1, (hal::time_us() - start_us) / stepCount);
+    if (stepDuration_us == 0)
+      stepDuration_us = measuredStepDuration_us;
+    else
+      stepDuration_us = std::max<uint32_t>(1, (3 * stepDuration_us + measuredStepDuration_us) / 4);
+    return stepCount;
+  }
+
+  /**
+   * \brief Advance the particle simulation by the duration of a frame, in fixed steps
+   * \see simulate
+   */
+  uint8_t simulate(const utils::vec3d& accelerationCartesian,
+                   const float frameDuration_s,
+                   const bool withCollisions,
+                   const bool shouldContrain = true)
+  {
+    return simulate(accelerationCartesian, frameDuration_s, withCollisions, shouldContrain, [](const float) {
+    });
+  }
+
+  /**
+   * \brief Set the time the simulation can take in a frame
+   * \param[in] budget_us Maximum duration of the steps of a frame, in microseconds
+   */
+  void set_simulation_budget(const uint32_t budget_us) { simulationBudget_us = budget_us; }
+
+  /// Return the average duration of a simulation step, in microseconds, 0 before the first step
+  uint32_t get_step_duration_us() const { return stepDuration_us; }
+
   /**
    * \brief Advance the particle simulation, ignoring collisions
    * \param[in] accelerationCartesian 3d acceleration vector to apply to particles
@@ -94,20 +202,20 @@ public:
                              const float deltaTime_s,
                              const bool shouldContrain = true)
   {
-    for (size_t i = 0; i < particuleCount; ++i)
+    const ParticleStep step(accelerationCartesian, deltaTime_s);
+    for (uint16_t alive = 0; alive < aliveCount; ++alive)
     {
-      // do not iterate non allocated particles
-      if (not isAllocated[i])
-        continue;
+      const uint16_t i = aliveSlots[alive];
 
-      Particle& p = particules[i];
       // apply force and constrain
-      p.apply_acceleration(accelerationCartesian, deltaTime_s, shouldContrain);
+      Particle::integrate(
+              step, theta_rad[i], z_mm[i], thetaSpeed_radS[i], zSpeed_mS[i], lampIndex[i], shouldContrain);
     }
   }
 
   /**
    * \brief Advance the particle simulation, taking collisions in account.
+   * A particle stops before the first occupied led on its way (see Particle::sweep).
    * \param[in] accelerationCartesian 3d acceleration vector to apply to particles
    * \param[in] deltaTime_s Time since last update, in seconds
    * \param[in] shouldContrain If true, will constrain the particles to the lamp body.
@@ -116,89 +224,97 @@ public:
                                const float deltaTime_s,
                                const bool shouldContrain = true)
   {
-    for (size_t i = 0; i < particuleCount; ++i)
+    const ParticleStep step(accelerationCartesian, deltaTime_s);
+    for (uint16_t alive = 0; alive < aliveCount; ++alive)
     {
-      // do not iterate non allocated particles
-      if (not isAllocated[i])
-        continue;
-
-      Particle& p = particules[i];
-      const int16_t ledIndex = p._savedLampIndex;
+      const uint16_t i = aliveSlots[alive];
 
       // simulate instead of updating directly
-      const Particle& newP = p.simulate_after_acceleration(accelerationCartesian, deltaTime_s, shouldContrain);
+      float newTheta_rad = theta_rad[i];
+      float newZ_mm = z_mm[i];
+      float newThetaSpeed_radS = thetaSpeed_radS[i];
+      float newZSpeed_mS = zSpeed_mS[i];
+      int16_t newLampIndex = lampIndex[i];
+      Particle::integrate(
+              step, newTheta_rad, newZ_mm, newThetaSpeed_radS, newZSpeed_mS, newLampIndex, shouldContrain);
 
       // update particle position in occupation set
-      const int16_t newLedIndex = newP._savedLampIndex;
-      if (newLedIndex != ledIndex)
+      if (newLampIndex != lampIndex[i])
       {
-        // check collision : no collision
-        if (not is_position_taken(newLedIndex))
+        // check collisions along the movement, a fast particle could jump over an occupied led
+        const bool hasCollided = Particle::sweep(
+                theta_rad[i], z_mm[i], lampIndex[i], newTheta_rad, newZ_mm, newLampIndex, [this](const int16_t pos) {
+                  return is_position_taken(pos);
+                });
+        if (newLampIndex != lampIndex[i])
         {
-          occupiedSpacesSet.erase(ledIndex);
-          occupiedSpacesSet.insert(newLedIndex);
+          release_position(lampIndex[i]);
+          take_position(newLampIndex);
         }
+
         // check collision : collision !!
-        else
+        if (hasCollided)
         {
-          // refuse movement, rebound speed
-          p.thetaSpeed_radS = -p.thetaSpeed_radS * 0.75;
-          p.zSpeed_mS = -p.zSpeed_mS * 0.75;
+          // stop before the occupied led, rebound speed
+          theta_rad[i] = newTheta_rad;
+          z_mm[i] = newZ_mm;
+          lampIndex[i] = newLampIndex;
+          thetaSpeed_radS[i] = -thetaSpeed_radS[i] * 0.75f;
+          zSpeed_mS[i] = -zSpeed_mS[i] * 0.75f;
           continue;
         }
       }
 
       // update particle
-      p = newP;
+      theta_rad[i] = newTheta_rad;
+      z_mm[i] = newZ_mm;
+      thetaSpeed_radS[i] = newThetaSpeed_radS;
+      zSpeed_mS[i] = newZSpeed_mS;
+      lampIndex[i] = newLampIndex;
     }
   }
 
   /**
    * \brief Filter particles depending on condition
    * \param[in] shouldDepopFunction A function, that given a particle, will return true if it needs to be removed from
-   * the simulation.
+   * the simulation: bool(const Particle&)
    * \return The number of particles left in the simulation.
    */
-  uint16_t depop_particules(const std::function<bool(const Particle&)>& shouldDepopFunction)
+  uint16_t depop_particules(const auto& shouldDepopFunction)
   {
-    uint16_t particleCount = 0;
-    for (size_t i = 0; i < particuleCount; ++i)
+    uint16_t alive = 0;
+    while (alive < aliveCount)
     {
-      // do not depop non allocated particles
-      if (not isAllocated[i])
-        continue;
-
-      auto& parti = particules[i];
-      if (shouldDepopFunction(parti))
+      const uint16_t i = aliveSlots[alive];
+      if (shouldDepopFunction(get_particle(i)))
       {
-        isAllocated[i] = false;
-        occupiedSpacesSet.erase(parti._savedLampIndex);
+        // the last live particle takes this place, check it next
+        release_position(lampIndex[i]);
+        free_slot(alive);
       }
       else
       {
-        particleCount += 1;
+        alive += 1;
       }
     }
-    return particleCount;
+    return aliveCount;
   }
 
   /**
    * \brief Display this particle system
-   * \param[in] sample_color sampling function for the particle color
+   * \param[in] sample_color sampling function for the particle color: uint32_t(int16_t, const Particle&)
    * \param[in, out] lamp The lamp object to write to
+   * \return The number of particles outside of the lamp
    */
-  uint16_t show(const std::function<uint32_t(int16_t, const Particle&)> sample_color, LampTy& lamp)
+  uint16_t show(const auto& sample_color, LampTy& lamp)
   {
     uint16_t particleCount = 0;
-    for (size_t i = 0; i < particuleCount; ++i)
+    for (uint16_t alive = 0; alive < aliveCount; ++alive)
     {
-      // do not show non allocated particles
-      if (not isAllocated[i])
-        continue;
-      const auto& particle = particules[i];
-      const auto& index = particle._savedLampIndex;
+      const uint16_t i = aliveSlots[alive];
+      const int16_t index = lampIndex[i];
       if (modes::is_led_index_valid(index))
-        lamp.setPixelColor(index, sample_color(i, particle));
+        lamp.setPixelColor(index, sample_color(i, get_particle(i)));
       else
         particleCount += 1;
     }
@@ -206,53 +322,196 @@ public:
   }
 
   /// Return the number of active particles
-  uint16_t get_number_of_active() const
+  uint16_t get_number_of_active() const { return aliveCount; }
+
+  /// Return a copy of a particle, from its slot index
+  Particle get_particle(const size_t index) const
   {
-    uint16_t particleCount = 0;
-    for (size_t i = 0; i < particuleCount; ++i)
-    {
-      // do not show non allocated particles
-      if (not isAllocated[i])
-        continue;
-      particleCount += 1;
-    }
-    return particleCount;
+    Particle particle;
+    particle.theta_rad = theta_rad[index];
+    particle.z_mm = z_mm[index];
+    particle.thetaSpeed_radS = thetaSpeed_radS[index];
+    particle.zSpeed_mS = zSpeed_mS[index];
+    particle._savedLampIndex = lampIndex[index];
+    return particle;
   }
 
 protected:
-  /// Return True if the position is already occupied
-  bool is_position_taken(const int16_t pos) const { return occupiedSpacesSet.find(pos) != occupiedSpacesSet.cend(); }
+  /// Return the arrays of particles. The live particles are the first get_number_of_active() aliveSlots
+  ParticleStorage get_storage() const
+  {
+    return {theta_rad, z_mm, thetaSpeed_radS, zSpeed_mS, lampIndex, slotLink, aliveSlots, capacity};
+  }
+
+  /// Use new arrays of particles, with no particle alive
+  void set_storage(const ParticleStorage& storage)
+  {
+    theta_rad = storage.theta_rad;
+    z_mm = storage.z_mm;
+    thetaSpeed_radS = storage.thetaSpeed_radS;
+    zSpeed_mS = storage.zSpeed_mS;
+    lampIndex = storage.lampIndex;
+    slotLink = storage.slotLink;
+    aliveSlots = storage.aliveSlots;
+    capacity = storage.capacity;
+    set_max_particle_count(0);
+  }
+
+  /// Return True if the position is already occupied. Positions outside of the lamp are never occupied
+  bool is_position_taken(const int16_t pos) const
+  {
+    if (not modes::is_led_index_valid(pos))
+      return false;
+    return (occupiedSpaces[pos >> 5] >> (pos & 31)) & 1;
+  }
+
+  /// Mark a position as occupied, if it is on the lamp
+  void take_position(const int16_t pos)
+  {
+    if (modes::is_led_index_valid(pos))
+      occupiedSpaces[pos >> 5] |= (1u << (pos & 31));
+  }
+
+  /// Mark a position as free, if it is on the lamp
+  void release_position(const int16_t pos)
+  {
+    if (modes::is_led_index_valid(pos))
+      occupiedSpaces[pos >> 5] &= ~(1u << (pos & 31));
+  }
 
   /**
-   * \brief Spawn a particle
-   * \param[in] index Index of this particle
-   * \param[in] positionGeneratorFunction Spawn function
+   * \brief Spawn a particle in the first free slot. The free list must not be empty
+   * \param[in] positionGeneratorFunction Spawn function, called with the slot index: int16_t(size_t)
    */
-  void spawn_particule(const size_t index, const std::function<int16_t(size_t)>& positionGeneratorFunction)
+  void spawn_particule(const auto& positionGeneratorFunction)
   {
+    const uint16_t index = firstFreeSlot;
+    firstFreeSlot = slotLink[index];
+    slotLink[index] = aliveCount;
+    aliveSlots[aliveCount] = index;
+    aliveCount += 1;
+
     int16_t pos = positionGeneratorFunction(index);
     int maxTries = 3;
-    while (ParticleSystem::is_position_taken(pos) and maxTries > 0)
+    while (is_position_taken(pos) and maxTries > 0)
     {
       pos = positionGeneratorFunction(index);
       maxTries--;
     }
     // generate start position from user function
     const auto& helixCoordinates = modes::strip_to_helix_unconstraint(pos);
-    particules[index] = Particle(utils::vec3d {helixCoordinates.x, helixCoordinates.y, helixCoordinates.z});
-    occupiedSpacesSet.insert(pos);
-    isAllocated[index] = true;
+    const Particle particle(utils::vec3d {helixCoordinates.x, helixCoordinates.y, helixCoordinates.z});
+    theta_rad[index] = particle.theta_rad;
+    z_mm[index] = particle.z_mm;
+    thetaSpeed_radS[index] = particle.thetaSpeed_radS;
+    zSpeed_mS[index] = particle.zSpeed_mS;
+    lampIndex[index] = particle._savedLampIndex;
+    take_position(pos);
+  }
+
+  /**
+   * \brief Return the slot of a live particle to the free list
+   * \param[in] alive Position of the particle in the live particles
+   */
+  void free_slot(const uint16_t alive)
+  {
+    const uint16_t index = aliveSlots[alive];
+
+    // swap remove from the live particles
+    aliveCount -= 1;
+    const uint16_t lastSlot = aliveSlots[aliveCount];
+    aliveSlots[alive] = lastSlot;
+    slotLink[lastSlot] = alive;
+
+    slotLink[index] = firstFreeSlot;
+    firstFreeSlot = index;
   }
 
 private:
-  static constexpr uint16_t maxParticuleCount = 512; ///< maximum particles allowed in a simulation
-  Particle particules[maxParticuleCount];            ///< Array of all particles
-  bool isAllocated[maxParticuleCount];               ///< store the allocated particules flag
+  float* theta_rad = nullptr;       ///< angle of the particles, in radians
+  float* z_mm = nullptr;            ///< height of the particles, in millimeters
+  float* thetaSpeed_radS = nullptr; ///< angular speed of the particles, in radian/seconds
+  float* zSpeed_mS = nullptr;       ///< vertical speed of the particles, in meter/seconds
+  int16_t* lampIndex = nullptr;     ///< led index of the particles
+  uint16_t capacity = 0;            ///< size of the arrays of particles
 
-  std::set<int16_t> occupiedSpacesSet; ///< store the occupied spaces
+  /// marks the end of the free list
+  static constexpr uint16_t noSlot = UINT16_MAX;
+  /// position in aliveSlots of a live particle, next free slot of a free one
+  uint16_t* slotLink = nullptr;
+  /// slots of the live particles, packed
+  uint16_t* aliveSlots = nullptr;
+  /// number of live particles
+  uint16_t aliveCount;
+  /// first slot of the free list, noSlot if all the slots are used
+  uint16_t firstFreeSlot;
 
-  /// forced to be less than maxParticuleCount
+  /// one bit per led, set for the occupied leds
+  std::array<uint32_t, (LampTy::ledCount + 31) / 32> occupiedSpaces;
+
+  /// forced to be less than capacity
   uint16_t particuleCount;
+
+  /// frame time not simulated yet, less than a step between frames
+  uint32_t timeAccumulator_us;
+  /// maximum duration of the steps of a frame, half a frame by default: the rest is left to the display
+  uint32_t simulationBudget_us = LampTy::frameDurationMs * 1000 / 2;
+  /// running average of the duration of a step
+  uint32_t stepDuration_us = 0;
+};
+
+/**
+ * \brief Particle system with its own particles
+ * \param[in] maxParticuleCount maximum particles allowed in a simulation
+ */
+template<uint16_t maxParticuleCount = 512> class ParticleSystemTy : public ParticleSystemBase
+{
+public:
+  ParticleSystemTy() { set_storage(particles.storage()); }
+
+  // the base class points to the particles of this object
+  ParticleSystemTy(const ParticleSystemTy&) = delete;
+  ParticleSystemTy& operator=(const ParticleSystemTy&) = delete;
+
+private:
+  ParticleArrays<maxParticuleCount> particles;
+};
+
+/// Particle system with the default particle count
+using ParticleSystem = ParticleSystemTy<>;
+
+/**
+ * \brief Particle system leasing its particles from the \ref particlePool
+ * It holds no particle until lease() is called, and should release() them when the mode exits.
+ */
+class PooledParticleSystem : public ParticleSystemBase
+{
+public:
+  PooledParticleSystem() = default;
+  ~PooledParticleSystem() { release(); }
+
+  PooledParticleSystem(const PooledParticleSystem&) = delete;
+  PooledParticleSystem& operator=(const PooledParticleSystem&) = delete;
+
+  /**
+   * \brief Lease particles from the pool, releasing the previous ones
+   * \param[in] particleCount Number of particles to lease, also the max particle count of the simulation
+   * \return true if the particles were leased. If not, the system holds no particle
+   */
+  bool lease(const uint16_t particleCount)
+  {
+    release();
+    set_storage(particlePool.lease(particleCount));
+    set_max_particle_count(particleCount);
+    return get_capacity() == particleCount;
+  }
+
+  /// Return the particles to the pool
+  void release()
+  {
+    particlePool.release(get_storage());
+    set_storage({});
+  }
 };
 
 } // namespace lampda::modes
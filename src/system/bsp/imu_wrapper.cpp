@@ -4,6 +4,8 @@
 #include "src/system/hal/time.h"
 #include "src/system/hal/print.h"
 
+#include "src/system/utils/utils.h"
+
 #include "src/system/driver/LSM6DS3.h"
 
 namespace lampda {
@@ -13,6 +15,30 @@ namespace imu {
 namespace __internal {
 // Create a instance of class LSM6DS3
 LSM6DS3 IMU(I2C_MODE, hal::i2c::imuI2cAddress); // I2C device address
+
+/// accelerometer sensitivity, in g per LSB
+float accelScale_g = 0.0f;
+/// gyroscope sensitivity, in degree per second per LSB
+float gyroScale_dps = 0.0f;
+/// latest successful reading
+Reading latestReading;
+
+/// FIFO words of a sample: the gyroscope axes, then the accelerometer axes
+static constexpr uint8_t wordsPerSample = 6;
+
+/// convert the raw outputs of a sample
+Reading to_reading(const int16_t* gyro, const int16_t* accel)
+{
+  Reading reads;
+  reads.accel.x = accel[0] * accelScale_g;
+  reads.accel.y = accel[1] * accelScale_g;
+  reads.accel.z = accel[2] * accelScale_g;
+
+  reads.gyro.x = gyro[0] * gyroScale_dps;
+  reads.gyro.y = gyro[1] * gyroScale_dps;
+  reads.gyro.z = gyro[2] * gyroScale_dps;
+  return reads;
+}
 } // namespace __internal
 
 bool Wrapper::init() const
@@ -29,6 +55,17 @@ bool Wrapper::init() const
 
   uint8_t error = status_t::IMU_SUCCESS;
 
+  // burst reads: auto-increment of the register address, and the output registers are not updated until both bytes
+  // are read
+  uint8_t ctrl3_flags = 0;
+  error += __internal::IMU.readRegister(&ctrl3_flags, LSM6DS3_ACC_GYRO_CTRL3_C);
+  ctrl3_flags |= LSM6DS3_ACC_GYRO_IF_INC_t::LSM6DS3_ACC_GYRO_IF_INC_ENABLED;
+  ctrl3_flags |= LSM6DS3_ACC_GYRO_BDU_t::LSM6DS3_ACC_GYRO_BDU_BLOCK_UPDATE;
+  error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_CTRL3_C, ctrl3_flags);
+
+  __internal::accelScale_g = __internal::IMU.accelScale();
+  __internal::gyroScale_dps = __internal::IMU.gyroScale();
+
   // free fall thresholds setup
   const uint8_t timingThreshold =
           (6 << LSM6DS3_ACC_GYRO_FREE_FALL_DUR_POSITION) & LSM6DS3_ACC_GYRO_FREE_FALL_DUR_MASK; // 6 samples for event
@@ -52,16 +89,81 @@ bool Wrapper::shutdown() const
 
 Reading Wrapper::get_reading() const
 {
-  Reading reads;
-  // coordinate change to the lamp body
-  reads.accel.x = __internal::IMU.readFloatAccelX();
-  reads.accel.y = __internal::IMU.readFloatAccelY();
-  reads.accel.z = __internal::IMU.readFloatAccelZ();
-
-  reads.gyro.x = __internal::IMU.readFloatGyroX();
-  reads.gyro.y = __internal::IMU.readFloatGyroY();
-  reads.gyro.z = __internal::IMU.readFloatGyroZ();
-  return reads;
+  // all the axes in a single transaction
+  LSM6DS3::RawMotion raw;
+  if (__internal::IMU.readRawMotion(raw) != status_t::IMU_SUCCESS)
+    return __internal::latestReading;
+
+  __internal::latestReading = __internal::to_reading(raw.gyro, raw.accel);
+  return __internal::latestReading;
+}
+
+bool Wrapper::enable_fifo(const uint16_t sampleRate_Hz, const uint8_t watermarkSamples) const
+{
+  // all the samples of the gyroscope and accelerometer, no decimation
+  __internal::IMU.settings.gyroFifoEnabled = 1;
+  __internal::IMU.settings.gyroFifoDecimation = 1;
+  __internal::IMU.settings.accelFifoEnabled = 1;
+  __internal::IMU.settings.accelFifoDecimation = 1;
+  __internal::IMU.settings.fifoSampleRate = sampleRate_Hz;
+  // in FIFO words
+  __internal::IMU.settings.fifoThreshold = watermarkSamples * __internal::wordsPerSample;
+
+  // restart from an empty FIFO
+  __internal::IMU.fifoEnd();
+  __internal::IMU.fifoBegin();
+
+  uint16_t unreadWords = 0;
+  uint16_t pattern = 0;
+  return __internal::IMU.fifoReadStatus(unreadWords, pattern) == status_t::IMU_SUCCESS;
+}
+
+void Wrapper::disable_fifo() const { __internal::IMU.fifoEnd(); }
+
+uint8_t Wrapper::get_fifo_readings(Reading* readings, const uint8_t maxReadings) const
+{
+  uint16_t unreadWords = 0;
+  uint16_t pattern = 0;
+  if (__internal::IMU.fifoReadStatus(unreadWords, pattern) != status_t::IMU_SUCCESS)
+    return 0;
+
+  // start on the first word of a sample
+  if (pattern != 0)
+  {
+    const uint8_t skippedWordCount = __internal::wordsPerSample - pattern;
+    if (unreadWords < skippedWordCount + __internal::wordsPerSample)
+      return 0;
+
+    int16_t skippedWords[__internal::wordsPerSample];
+    if (__internal::IMU.fifoReadWords(skippedWords, skippedWordCount) != status_t::IMU_SUCCESS)
+      return 0;
+    unreadWords -= skippedWordCount;
+  }
+
+  const uint16_t sampleCount = unreadWords / __internal::wordsPerSample;
+  if (sampleCount == 0)
+    return 0;
+
+  // too many samples to read, restart from the current one
+  if (sampleCount > maxReadings or sampleCount > maxFifoReadings)
+  {
+    __internal::IMU.fifoEnd();
+    __internal::IMU.fifoBegin();
+    readings[0] = get_reading();
+    return 1;
+  }
+
+  int16_t words[maxFifoReadings * __internal::wordsPerSample];
+  if (__internal::IMU.fifoReadWords(words, sampleCount * __internal::wordsPerSample) != status_t::IMU_SUCCESS)
+    return 0;
+
+  for (uint8_t sample = 0; sample < sampleCount; ++sample)
+  {
+    const int16_t* sampleWords = words + sample * __internal::wordsPerSample;
+    readings[sample] = __internal::to_reading(sampleWords, sampleWords + 3);
+  }
+  __internal::latestReading = readings[sampleCount - 1];
+  return sampleCount;
 }
 
 bool Wrapper::enable_free_fall_detection() const
@@ -182,6 +284,59 @@ bool Wrapper::disable_tilt_detection() const
   return error == status_t::IMU_SUCCESS;
 }
 
+bool Wrapper::enable_tap_detection() const
+{
+  uint8_t error = status_t::IMU_SUCCESS;
+
+  // taps on all axes
+  uint8_t tapCfg_flags = 0;
+  error += __internal::IMU.readRegister(&tapCfg_flags, LSM6DS3_ACC_GYRO_TAP_CFG);
+  tapCfg_flags |= LSM6DS3_ACC_GYRO_TAP_X_EN_t::LSM6DS3_ACC_GYRO_TAP_X_EN_ENABLED |
+                  LSM6DS3_ACC_GYRO_TAP_Y_EN_t::LSM6DS3_ACC_GYRO_TAP_Y_EN_ENABLED |
+                  LSM6DS3_ACC_GYRO_TAP_Z_EN_t::LSM6DS3_ACC_GYRO_TAP_Z_EN_ENABLED;
+  error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_TAP_CFG, tapCfg_flags);
+
+  // tap threshold, in full scale / 32 (a tap is a ~2g shock)
+  static constexpr float tapThreshold_g = 2.0f;
+  const uint8_t threshold = lmpd_constrain<uint16_t>(
+          tapThreshold_g * 32.0f / __internal::IMU.settings.accelRange, 1, LSM6DS3_ACC_GYRO_TAP_THS_MASK);
+  uint8_t tapThs_flags = 0;
+  error += __internal::IMU.readRegister(&tapThs_flags, LSM6DS3_ACC_GYRO_TAP_THS_6D);
+  tapThs_flags = (tapThs_flags & ~LSM6DS3_ACC_GYRO_TAP_THS_MASK) | threshold;
+  error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_TAP_THS_6D, tapThs_flags);
+
+  return error == status_t::IMU_SUCCESS;
+}
+
+bool Wrapper::disable_tap_detection() const
+{
+  uint8_t error = status_t::IMU_SUCCESS;
+
+  uint8_t tapCfg_flags = 0;
+  error += __internal::IMU.readRegister(&tapCfg_flags, LSM6DS3_ACC_GYRO_TAP_CFG);
+  tapCfg_flags &= ~(LSM6DS3_ACC_GYRO_TAP_X_EN_t::LSM6DS3_ACC_GYRO_TAP_X_EN_ENABLED |
+                    LSM6DS3_ACC_GYRO_TAP_Y_EN_t::LSM6DS3_ACC_GYRO_TAP_Y_EN_ENABLED |
+                    LSM6DS3_ACC_GYRO_TAP_Z_EN_t::LSM6DS3_ACC_GYRO_TAP_Z_EN_ENABLED);
+  error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_TAP_CFG, tapCfg_flags);
+
+  return error == status_t::IMU_SUCCESS;
+}
+
+bool Wrapper::set_interrupt_latch(const bool isLatched) const
+{
+  uint8_t error = status_t::IMU_SUCCESS;
+
+  uint8_t tapCfg_flags = 0;
+  error += __internal::IMU.readRegister(&tapCfg_flags, LSM6DS3_ACC_GYRO_TAP_CFG);
+  if (isLatched)
+    tapCfg_flags |= LSM6DS3_ACC_GYRO_LIR_t::LSM6DS3_ACC_GYRO_LIR_ENABLED;
+  else
+    tapCfg_flags &= ~LSM6DS3_ACC_GYRO_LIR_t::LSM6DS3_ACC_GYRO_LIR_ENABLED;
+  error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_TAP_CFG, tapCfg_flags);
+
+  return error == status_t::IMU_SUCCESS;
+}
+
 void Wrapper::disable_detection(const InterruptType interr) const
 {
   switch (interr)
@@ -201,6 +356,10 @@ void Wrapper::disable_detection(const InterruptType interr) const
       disable_step_detection();
       break;
 
+    case InterruptType::Tap:
+      disable_tap_detection();
+      break;
+
     default:
       {
         break;
@@ -255,6 +414,39 @@ bool Wrapper::enable_interrupt1(const InterruptType interr) const
         error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_MD1_CFG, int1Flag);
         return error == status_t::IMU_SUCCESS;
       }
+
+    case InterruptType::Tap:
+      {
+        uint8_t error = status_t::IMU_SUCCESS;
+        // MD1_CFG Functions routing on INT1 register
+        uint8_t int1Flag = 0;
+        error += __internal::IMU.readRegister(&int1Flag, LSM6DS3_ACC_GYRO_MD1_CFG);
+        int1Flag |= LSM6DS3_ACC_GYRO_INT1_SINGLE_TAP_t::LSM6DS3_ACC_GYRO_INT1_SINGLE_TAP_ENABLED;
+        error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_MD1_CFG, int1Flag);
+        return error == status_t::IMU_SUCCESS;
+      }
+
+    case InterruptType::DataReady:
+      {
+        uint8_t error = status_t::IMU_SUCCESS;
+        // INT1_CTRL Functions routing on INT1 register
+        uint8_t int1Flag = 0;
+        error += __internal::IMU.readRegister(&int1Flag, LSM6DS3_ACC_GYRO_INT1_CTRL);
+        int1Flag |= LSM6DS3_ACC_GYRO_INT1_DRDY_XL_t::LSM6DS3_ACC_GYRO_INT1_DRDY_XL_ENABLED;
+        error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_INT1_CTRL, int1Flag);
+        return error == status_t::IMU_SUCCESS;
+      }
+
+    case InterruptType::FifoWatermark:
+      {
+        uint8_t error = status_t::IMU_SUCCESS;
+        // INT1_CTRL Functions routing on INT1 register
+        uint8_t int1Flag = 0;
+        error += __internal::IMU.readRegister(&int1Flag, LSM6DS3_ACC_GYRO_INT1_CTRL);
+        int1Flag |= LSM6DS3_ACC_GYRO_INT1_FTH_t::LSM6DS3_ACC_GYRO_INT1_FTH_ENABLED;
+        error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_INT1_CTRL, int1Flag);
+        return error == status_t::IMU_SUCCESS;
+      }
     default:
       {
         break;
@@ -324,6 +516,39 @@ bool Wrapper::enable_interrupt2(const InterruptType interr) const
         error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_MD2_CFG, int2Flag);
         return error == status_t::IMU_SUCCESS;
       }
+
+    case InterruptType::Tap:
+      {
+        uint8_t error = status_t::IMU_SUCCESS;
+        // MD2_CFG Functions routing on INT2 register
+        uint8_t int2Flag = 0;
+        error += __internal::IMU.readRegister(&int2Flag, LSM6DS3_ACC_GYRO_MD2_CFG);
+        int2Flag |= LSM6DS3_ACC_GYRO_INT2_SINGLE_TAP_t::LSM6DS3_ACC_GYRO_INT2_SINGLE_TAP_ENABLED;
+        error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_MD2_CFG, int2Flag);
+        return error == status_t::IMU_SUCCESS;
+      }
+
+    case InterruptType::DataReady:
+      {
+        uint8_t error = status_t::IMU_SUCCESS;
+        // INT2_CTRL Functions routing on INT2 register
+        uint8_t int2Flag = 0;
+        error += __internal::IMU.readRegister(&int2Flag, LSM6DS3_ACC_GYRO_INT2_CTRL);
+        int2Flag |= LSM6DS3_ACC_GYRO_INT2_DRDY_XL_t::LSM6DS3_ACC_GYRO_INT2_DRDY_XL_ENABLED;
+        error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_INT2_CTRL, int2Flag);
+        return error == status_t::IMU_SUCCESS;
+      }
+
+    case InterruptType::FifoWatermark:
+      {
+        uint8_t error = status_t::IMU_SUCCESS;
+        // INT2_CTRL Functions routing on INT2 register
+        uint8_t int2Flag = 0;
+        error += __internal::IMU.readRegister(&int2Flag, LSM6DS3_ACC_GYRO_INT2_CTRL);
+        int2Flag |= LSM6DS3_ACC_GYRO_INT2_FTH_t::LSM6DS3_ACC_GYRO_INT2_FTH_ENABLED;
+        error += __internal::IMU.writeRegister(LSM6DS3_ACC_GYRO_INT2_CTRL, int2Flag);
+        return error == status_t::IMU_SUCCESS;
+      }
     default:
       {
         break;
@@ -408,6 +633,15 @@ bool Wrapper::is_event_detected(const InterruptType interr) const
                (func_flags & LSM6DS3_ACC_GYRO_TILT_IA_t::LSM6DS3_ACC_GYRO_TILT_IA_DETECTED);
       }
 
+    case InterruptType::Tap:
+      {
+        uint8_t tap_flags = 0;
+        const uint8_t error = __internal::IMU.readRegister(&tap_flags, LSM6DS3_ACC_GYRO_TAP_SRC);
+        // single tap detected
+        return (error == status_t::IMU_SUCCESS) and
+               (tap_flags & LSM6DS3_ACC_GYRO_SINGLE_TAP_EV_STATUS_t::LSM6DS3_ACC_GYRO_SINGLE_TAP_EV_STATUS_DETECTED);
+      }
+
     default:
       {
         break;
@@ -417,6 +651,36 @@ bool Wrapper::is_event_detected(const InterruptType interr) const
   return false;
 }
 
+uint8_t Wrapper::get_detected_events() const
+{
+  const auto event_bit = [](const InterruptType interr) {
+    return static_cast<uint8_t>(1 << static_cast<uint8_t>(interr));
+  };
+  uint8_t events = 0;
+
+  // WAKE_UP_SRC and TAP_SRC are contiguous, read them in a single burst
+  uint8_t sources[2] = {0, 0};
+  if (__internal::IMU.readRegisterRegion(sources, LSM6DS3_ACC_GYRO_WAKE_UP_SRC, 2) == status_t::IMU_SUCCESS)
+  {
+    if (sources[0] & LSM6DS3_ACC_GYRO_FF_EV_STATUS_t::LSM6DS3_ACC_GYRO_FF_EV_STATUS_DETECTED)
+      events |= event_bit(InterruptType::FreeFall);
+    if (sources[1] & LSM6DS3_ACC_GYRO_SINGLE_TAP_EV_STATUS_t::LSM6DS3_ACC_GYRO_SINGLE_TAP_EV_STATUS_DETECTED)
+      events |= event_bit(InterruptType::Tap);
+  }
+
+  uint8_t func_flags = 0;
+  if (__internal::IMU.readRegister(&func_flags, LSM6DS3_ACC_GYRO_FUNC_SRC) == status_t::IMU_SUCCESS)
+  {
+    if (func_flags & LSM6DS3_ACC_GYRO_SIGN_MOTION_IA_t::LSM6DS3_ACC_GYRO_SIGN_MOTION_IA_DETECTED)
+      events |= event_bit(InterruptType::BigMotion);
+    if (func_flags & LSM6DS3_ACC_GYRO_STEP_DETECTED_t::LSM6DS3_ACC_GYRO_STEP_DETECTED)
+      events |= event_bit(InterruptType::Step);
+    if (func_flags & LSM6DS3_ACC_GYRO_TILT_IA_t::LSM6DS3_ACC_GYRO_TILT_IA_DETECTED)
+      events |= event_bit(InterruptType::AngleChange);
+  }
+  return events;
+}
+
 } // namespace imu
 } // namespace bsp
 } // namespace lampda
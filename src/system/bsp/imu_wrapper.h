@@ -38,16 +38,41 @@ public:
    */
   bool shutdown() const;
 
-  /// get the latest accelerometer/gyroscope measurment
+  /// get the latest accelerometer/gyroscope measurment, all the axes from the same sample
   Reading get_reading() const;
 
+  /// Maximum number of samples read from the FIFO at once
+  static constexpr uint8_t maxFifoReadings = 21;
+
+  /**
+   * \brief Batch the samples in the IMU FIFO, in continuous mode: the oldest samples are overwritten when it is full
+   * \param[in] sampleRate_Hz Rate of the samples (10, 25, 50, 100, 200, 400), below the 416Hz of the sensors
+   * \param[in] watermarkSamples Number of samples that raise the FifoWatermark interrupt
+   * \return true if the FIFO was configured
+   */
+  bool enable_fifo(const uint16_t sampleRate_Hz, const uint8_t watermarkSamples = maxFifoReadings) const;
+  /// Stop batching the samples, and empty the FIFO
+  void disable_fifo() const;
+
+  /**
+   * \brief Read the samples batched in the FIFO since the latest call, in a single transaction
+   * If more than maxReadings samples are waiting, the FIFO is emptied and only the current sample is returned.
+   * \param[out] readings The samples, oldest first
+   * \param[in] maxReadings Size of readings, at most maxFifoReadings
+   * \return The number of samples read
+   */
+  uint8_t get_fifo_readings(Reading* readings, const uint8_t maxReadings) const;
+
   /// Interrupt type for the event callbacks.
   enum class InterruptType
   {
-    FreeFall,    ///< raised during a free fall event
-    BigMotion,   ///< raised with a >6g acceleration
-    Step,        ///< raised on a step event
-    AngleChange, ///< raised on portrait to landscape (or inverse) rotation
+    FreeFall,      ///< raised during a free fall event
+    BigMotion,     ///< raised with a >6g acceleration
+    Step,          ///< raised on a step event
+    AngleChange,   ///< raised on portrait to landscape (or inverse) rotation
+    Tap,           ///< raised on a single tap
+    DataReady,     ///< raised when a new accelerometer sample is ready, until it is read
+    FifoWatermark, ///< raised when the FIFO holds the watermark samples, until it is read below
   };
 
   /// Enable free fall events detection
@@ -70,6 +95,14 @@ public:
   /// Disable tilt detection
   bool disable_tilt_detection() const;
 
+  /// Enable single tap detection
+  bool enable_tap_detection() const;
+  /// Disable single tap detection
+  bool disable_tap_detection() const;
+
+  /// Latch the event interrupts until their source is read (with is_event_detected or get_detected_events)
+  bool set_interrupt_latch(const bool isLatched) const;
+
   /// disable event detection
   /// \warning WILL ALSO DISABLE THE ASSOCIATED INTERRUPTS
   void disable_detection(const InterruptType interr) const;
@@ -97,6 +130,12 @@ public:
 
   /// return true if the interrupt is raised, do not depend on physical interrupt pins
   bool is_event_detected(const InterruptType interr) const;
+
+  /**
+   * \brief Read all the event sources at once, to find the events behind an interrupt
+   * \return The detected events, with the bits (1 << InterruptType) set
+   */
+  uint8_t get_detected_events() const;
 };
 
 } // namespace imu
@@ -40,17 +40,18 @@ extern bool can_battery_be_charged();
  */
 inline uint16_t liion_mv_to_battery_percent(const uint16_t liionLevel_mv, const uint8_t batteryCountSerie)
 {
-  using curve_t = utils::curves::LinearCurve<uint16_t, uint16_t>;
-  static curve_t liionVoltagePercentToRealPercent({// low end of the curve, sharp drop
-                                                   curve_t::point_t {3000, 0},
-                                                   curve_t::point_t {3210, 500},
-                                                   curve_t::point_t {3350, 1000},
-                                                   curve_t::point_t {3430, 1500},
-                                                   curve_t::point_t {3470, 2000},
-                                                   // linear approximation works well enough in range 20-90%
-                                                   curve_t::point_t {4080, 9000},
-                                                   curve_t::point_t {4110, 9500},
-                                                   curve_t::point_t {4180, 10000}});
+  using point_t = utils::curves::Point<uint16_t, uint16_t>;
+  static constexpr auto liionVoltagePercentToRealPercent =
+          utils::curves::make_linear_curve<uint16_t, uint16_t>( // low end of the curve, sharp drop
+                  point_t {3000, 0},
+                  point_t {3210, 500},
+                  point_t {3350, 1000},
+                  point_t {3430, 1500},
+                  point_t {3470, 2000},
+                  // linear approximation works well enough in range 20-90%
+                  point_t {4080, 9000},
+                  point_t {4110, 9500},
+                  point_t {4180, 10000});
 
   // sample the curve
   return liionVoltagePercentToRealPercent.sample(liionLevel_mv / batteryCountSerie);
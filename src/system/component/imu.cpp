@@ -1,10 +1,12 @@
 #include "imu.h"
 
+#include <cmath>
 #include <cstring>
 
 #include "src/system/bsp/imu_wrapper.h"
 
 #include "src/system/utils/constants.h"
+#include "src/system/utils/spsc_queue.h"
 #include "src/system/utils/vector_math.h"
 
 #include "src/system/hal/time.h"
@@ -25,6 +27,30 @@ hal::gpio::DigitalPin interrupt2Pin(hal::gpio::DigitalPin::GPIO::Signal_ImuInter
 /// indicates if the driver is initialized
 bool isInitialized = false;
 
+/// rate setting of the samples batched in the IMU FIFO
+static constexpr uint16_t fifoSampleRate_Hz = 200;
+/// actual rate of the samples batched in the IMU FIFO, for this setting
+static constexpr float fifoSampleFrequency_Hz = 208.0f;
+/// indicates if the samples are batched in the IMU FIFO
+bool isFifoEnabled = false;
+/// FIFO samples that raise the watermark interrupt: about a frame of samples
+static constexpr uint8_t fifoWatermarkSamples =
+        (static_cast<uint16_t>(fifoSampleFrequency_Hz) * MAIN_LOOP_UPDATE_PERIOD_MS + 999) / 1000;
+static_assert(fifoWatermarkSamples <= bsp::imu::Wrapper::maxFifoReadings, "the watermark must fit in a FIFO read");
+
+/// indicates if the motion data and events are signaled by the interrupt pins
+volatile bool areInterruptEventsEnabled = false;
+/// indicates if the IMU signaled new motion data since the latest reading
+bool hasMotionData = false;
+/// indicates if the new motion data was signaled by its interrupt, readingTime_us is then the time of the interrupt
+bool hasMotionInterrupt = false;
+/// read the motion data anyway when no interrupt was raised for this long (missed interrupt)
+static constexpr uint32_t motionDataTimeout_us = 100000;
+/// time of the latest reading
+uint32_t latestReading_us = 0;
+/// time of the latest motion data, from its interrupt when enabled
+uint32_t readingTime_us = 0;
+
 /// Transform imu coordinates to board coordinates
 const utils::TransformationMatrix imuToBoardTransformation(
         utils::vec3d(imuToCircuitRotationX_rad, imuToCircuitRotationY_rad, imuToCircuitRotationZ_rad),
@@ -48,15 +74,27 @@ void init()
   else
   {
     isInitialized = true;
+
+    // sample at a higher rate than the frames, the filter sees the fast movements
+    isFifoEnabled = imuInstance.enable_fifo(fifoSampleRate_Hz, fifoWatermarkSamples);
+    if (not isFifoEnabled)
+      hal::lampda_print("IMU FIFO failed to start");
+
+    // only read the IMU when it has new data, and get the events with their real time
+    if (not enable_interrupt_events())
+      hal::lampda_print("IMU interrupts failed to start");
   }
 }
 
 void shutdown()
 {
   // remove callbacks from interrupts
+  disable_interrupt_events();
   interrupt1Pin.detach_callbacks();
 
   // enter deep sleep
+  imuInstance.disable_fifo();
+  isFifoEnabled = false;
   imuInstance.shutdown();
 }
 
@@ -79,6 +117,9 @@ bool enable_event_detection(const EventType eventType)
     case EventType::Tilt:
       return imuInstance.enable_tilt_detection();
 
+    case EventType::Tap:
+      return imuInstance.enable_tap_detection();
+
     default:
       return false;
   }
@@ -103,6 +144,9 @@ bool disable_event_detection(const EventType eventType)
     case EventType::Tilt:
       return imuInstance.disable_tilt_detection();
 
+    case EventType::Tap:
+      return imuInstance.disable_tap_detection();
+
     default:
       return false;
   }
@@ -127,15 +171,34 @@ bool is_event_detected(const EventType eventType)
     case EventType::Tilt:
       return imuInstance.is_event_detected(bsp::imu::Wrapper::InterruptType::AngleChange);
 
+    case EventType::Tap:
+      return imuInstance.is_event_detected(bsp::imu::Wrapper::InterruptType::Tap);
+
     default:
       return false;
   }
 }
 
+/// an interrupt raised on a pin, as queued by the pin callbacks
+struct PinInterrupt
+{
+  uint8_t pin;      ///< 1 or 2
+  uint32_t time_us; ///< time of the interrupt
+};
+/// interrupts of both pins: the pin callbacks run at the same priority, they are a single producer
+utils::SpscQueue<PinInterrupt, 32> pinInterrupts;
+/// events decoded from the pin 2 interrupts, for pop_event
+utils::SpscQueue<Event, 16> events;
+
 /// interrupt 1 result
 bool isInterrupt1Enabled = false;
 /// callback for the interrupt1 signal
-void interrupt1_callback() { isInterrupt1Enabled = true; }
+void interrupt1_callback()
+{
+  isInterrupt1Enabled = true;
+  if (areInterruptEventsEnabled)
+    pinInterrupts.push({1, static_cast<uint32_t>(hal::time_us())});
+}
 
 bool is_interrupt1_enabled()
 {
@@ -146,8 +209,13 @@ bool is_interrupt1_enabled()
 
 /// interrupt 2 result
 bool isInterrupt2Enabled = false;
-/// callback for the interrupt1 signal
-void interrupt2_callback() { isInterrupt2Enabled = true; }
+/// callback for the interrupt2 signal
+void interrupt2_callback()
+{
+  isInterrupt2Enabled = true;
+  if (areInterruptEventsEnabled)
+    pinInterrupts.push({2, static_cast<uint32_t>(hal::time_us())});
+}
 
 bool is_interrupt2_enabled()
 {
@@ -253,6 +321,110 @@ bool link_event_to_interrupt2(const EventType eventType)
 
 void unlink_interrupt_2() { imuInstance.disable_interrupt2(); }
 
+bool enable_interrupt_events()
+{
+  if (not isInitialized)
+    return false;
+
+  using InterruptType = bsp::imu::Wrapper::InterruptType;
+  imuInstance.disable_interrupt1();
+  imuInstance.disable_interrupt2();
+
+  // motion data on the pin 1: a frame of samples in the FIFO, or each sample without it
+  const InterruptType motionInterrupt = isFifoEnabled ? InterruptType::FifoWatermark : InterruptType::DataReady;
+  bool isEnabled = imuInstance.enable_interrupt1(motionInterrupt);
+  // detectors on the pin 2, latched until their source is read
+  isEnabled = isEnabled and imuInstance.set_interrupt_latch(true);
+  isEnabled = isEnabled and imuInstance.enable_tap_detection() and imuInstance.enable_interrupt2(InterruptType::Tap);
+  isEnabled = isEnabled and imuInstance.enable_free_fall_detection() and
+              imuInstance.enable_interrupt2(InterruptType::FreeFall);
+  if (not isEnabled)
+  {
+    hal::lampda_print("enable_interrupt_events: interrupt routing failed");
+    disable_interrupt_events();
+    return false;
+  }
+
+  // drop the interrupts raised before, and read the data already waiting
+  PinInterrupt interrupt;
+  while (pinInterrupts.pop(interrupt))
+  {
+  }
+  hasMotionData = true;
+  hasMotionInterrupt = false;
+  areInterruptEventsEnabled = true;
+
+  // the signals stay high until read: a single rising edge per interrupt
+  interrupt1Pin.set_pin_mode(hal::gpio::DigitalPin::Mode::kInput);
+  interrupt1Pin.detach_callbacks();
+  interrupt1Pin.attach_callback(interrupt1_callback, hal::gpio::DigitalPin::Interrupt::kRisingEdge);
+  interrupt2Pin.set_pin_mode(hal::gpio::DigitalPin::Mode::kInput);
+  interrupt2Pin.detach_callbacks();
+  interrupt2Pin.attach_callback(interrupt2_callback, hal::gpio::DigitalPin::Interrupt::kRisingEdge);
+  return true;
+}
+
+void disable_interrupt_events()
+{
+  areInterruptEventsEnabled = false;
+  interrupt1Pin.detach_callbacks();
+  interrupt2Pin.detach_callbacks();
+  if (not isInitialized)
+    return;
+
+  imuInstance.disable_interrupt1();
+  imuInstance.disable_interrupt2();
+  imuInstance.disable_tap_detection();
+  imuInstance.disable_free_fall_detection();
+  imuInstance.set_interrupt_latch(false);
+}
+
+bool pop_event(Event& event) { return events.pop(event); }
+
+uint32_t get_reading_time_us() { return readingTime_us; }
+
+/// Handle the interrupts queued by the pin callbacks, from the main loop
+void process_pin_interrupts()
+{
+  using InterruptType = bsp::imu::Wrapper::InterruptType;
+  static constexpr auto event_bit = [](const InterruptType interr) {
+    return static_cast<uint8_t>(1 << static_cast<uint8_t>(interr));
+  };
+
+  PinInterrupt interrupt;
+  while (pinInterrupts.pop(interrupt))
+  {
+    if (interrupt.pin == 1)
+    {
+      hasMotionData = true;
+      hasMotionInterrupt = true;
+      readingTime_us = interrupt.time_us;
+      continue;
+    }
+
+    // find the detectors behind the interrupt, this also clears the latch
+    const uint8_t detected = imuInstance.get_detected_events();
+    if (detected & event_bit(InterruptType::Tap))
+      events.push({EventType::Tap, interrupt.time_us});
+    if (detected & event_bit(InterruptType::FreeFall))
+      events.push({EventType::FreeFall, interrupt.time_us});
+  }
+}
+
+/// transform an IMU reading to lamp body space
+bsp::imu::Reading to_lamp_space(const bsp::imu::Reading& reading)
+{
+  // this new object is necessary or the computation returns garbage. TODO: WHY
+  bsp::imu::Reading lampSpaceVector;
+  lampSpaceVector.accel = boardToFirstPixelTransformation.transform(imuToBoardTransformation.transform(reading.accel));
+  lampSpaceVector.gyro = boardToFirstPixelTransformation.transform(imuToBoardTransformation.transform(reading.gyro));
+  // inverse z axis
+  lampSpaceVector.accel.x = -lampSpaceVector.accel.x;
+  lampSpaceVector.accel.y = -lampSpaceVector.accel.y;
+  lampSpaceVector.accel.z = -lampSpaceVector.accel.z;
+  return lampSpaceVector;
+}
+
 bsp::imu::Reading get_filtered_reading(const bool resetFilter)
 {
   static bsp::imu::Reading filtered;
@@ -271,37 +443,64 @@ bsp::imu::Reading get_filtered_reading(const bool resetFilter)
   return filtered;
 #else
 
-  const bsp::imu::Reading& read = imuInstance.get_reading();
-  if (resetFilter)
+  // filter gain per frame: average on the last 10 frames
+  static constexpr float frameFilterGain = 0.1f;
+  // same time constant, for each sample of the FIFO (1 - gain ^ samplesPerFrame = frameFilterGain)
+  static const float sampleFilterGain =
+          1.0f - powf(1.0f - frameFilterGain, 1000.0f / (MAIN_LOOP_UPDATE_PERIOD_MS * fifoSampleFrequency_Hz));
+
+  if (areInterruptEventsEnabled)
+    process_pin_interrupts();
+
+  // with the interrupts, only read the IMU when it signaled new data (or when its interrupt was missed)
+  const uint32_t time_us = static_cast<uint32_t>(hal::time_us());
+  if (areInterruptEventsEnabled and not hasMotionData and not resetFilter and
+      time_us - latestReading_us < motionDataTimeout_us)
+    return to_lamp_space(filtered);
+  // the time of the interrupt, or of this read (no interrupt, missed interrupt, reset)
+  if (not areInterruptEventsEnabled or not hasMotionInterrupt)
+    readingTime_us = time_us;
+  hasMotionData = false;
+  hasMotionInterrupt = false;
+  latestReading_us = time_us;
+
+  // all the samples since the latest call, in a single burst
+  bsp::imu::Reading samples[bsp::imu::Wrapper::maxFifoReadings];
+  uint8_t sampleCount = 0;
+  if (isFifoEnabled)
+    sampleCount = imuInstance.get_fifo_readings(samples, bsp::imu::Wrapper::maxFifoReadings);
+  const float filterGain = isFifoEnabled ? sampleFilterGain : frameFilterGain;
+  if (sampleCount == 0 and (resetFilter or not isFifoEnabled))
   {
-    filtered = read;
-    filtered.accel.x *= oneG;
-    filtered.accel.y *= oneG;
-    filtered.accel.z *= oneG;
+    samples[0] = imuInstance.get_reading();
+    sampleCount = 1;
   }
-  else
+
+  for (uint8_t i = 0; i < sampleCount; i++)
   {
-    // simple linear filter: average on the last 10 values
-    filtered.accel.x += 0.1f * (read.accel.x * oneG - filtered.accel.x);
-    filtered.accel.y += 0.1f * (read.accel.y * oneG - filtered.accel.y);
-    filtered.accel.z += 0.1f * (read.accel.z * oneG - filtered.accel.z);
-
-    filtered.gyro.x += 0.1f * (read.gyro.x - filtered.gyro.x);
-    filtered.gyro.y += 0.1f * (read.gyro.y - filtered.gyro.y);
-    filtered.gyro.z += 0.1f * (read.gyro.z - filtered.gyro.z);
+    const bsp::imu::Reading& read = samples[i];
+    if (resetFilter and i == 0)
+    {
+      filtered = read;
+      filtered.accel.x *= oneG;
+      filtered.accel.y *= oneG;
+      filtered.accel.z *= oneG;
+    }
+    else
+    {
+      // simple linear filter
+      filtered.accel.x += filterGain * (read.accel.x * oneG - filtered.accel.x);
+      filtered.accel.y += filterGain * (read.accel.y * oneG - filtered.accel.y);
+      filtered.accel.z += filterGain * (read.accel.z * oneG - filtered.accel.z);
+
+      filtered.gyro.x += filterGain * (read.gyro.x - filtered.gyro.x);
+      filtered.gyro.y += filterGain * (read.gyro.y - filtered.gyro.y);
+      filtered.gyro.z += filterGain * (read.gyro.z - filtered.gyro.z);
+    }
   }
 #endif
 
-  // transform to lamp body space
-  // this new object is necessary or the computation returns garbage. TODO: WHY
-  bsp::imu::Reading lampSpaceVector;
-  lampSpaceVector.accel = boardToFirstPixelTransformation.transform(imuToBoardTransformation.transform(filtered.accel));
-  lampSpaceVector.gyro = boardToFirstPixelTransformation.transform(imuToBoardTransformation.transform(filtered.gyro));
-  // inverse z axis
-  lampSpaceVector.accel.x = -lampSpaceVector.accel.x;
-  lampSpaceVector.accel.y = -lampSpaceVector.accel.y;
-  lampSpaceVector.accel.z = -lampSpaceVector.accel.z;
-  return lampSpaceVector;
+  return to_lamp_space(filtered);
 }
 
 } // namespace imu
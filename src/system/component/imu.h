@@ -5,6 +5,8 @@
 #ifndef COMPONENT_IMU_H
 #define COMPONENT_IMU_H
 
+#include <cstdint>
+
 #include "src/system/bsp/imu_wrapper.h"
 
 namespace lampda {
@@ -28,6 +30,14 @@ enum class EventType
   BigMotion, ///< raised during a big acceleration
   Step,      ///< raised during step detection
   Tilt,      ///< raised event during orientation flip
+  Tap,       ///< raised on a single tap
+};
+
+/// An IMU detection event, with the time of its interrupt
+struct Event
+{
+  EventType type;   ///< what was detected
+  uint32_t time_us; ///< time of the interrupt, in microseconds (wraps around)
 };
 
 /// Enable a specific event
@@ -54,6 +64,28 @@ bool is_interrupt1_enabled();
 /// Read and reset the interrupt2 bit
 bool is_interrupt2_enabled();
 
+/**
+ * \brief Drive the IMU from its interrupt pins, instead of polling it
+ * The pin 1 signals new motion data (FIFO watermark, or data ready without the FIFO): the motion data is only read
+ * after it was raised. The pin 2 signals the tap and free fall events, queued by \ref pop_event.
+ * The interrupts are timestamped as they are raised, and the IMU is read from the main loop.
+ * \warning Replaces the events linked by \ref link_event_to_interrupt1 and \ref link_event_to_interrupt2
+ * \return true if the interrupts are enabled
+ */
+extern bool enable_interrupt_events();
+/// Stop the interrupt events, the motion data is polled again
+extern void disable_interrupt_events();
+
+/**
+ * \brief Pop the oldest event raised on the interrupt pins, after \ref enable_interrupt_events
+ * \param[out] event The event, with the time of its interrupt
+ * \return false if there is no event
+ */
+extern bool pop_event(Event& event);
+
+/// Return the time of the latest motion data interrupt, in microseconds, or the latest reading time without interrupts
+extern uint32_t get_reading_time_us();
+
 /// get the filtered IMU readings
 bsp::imu::Reading get_filtered_reading(const bool resetFilter);
 
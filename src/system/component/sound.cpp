@@ -1,6 +1,7 @@
 #include "sound.h"
 
 #include <cstdint>
+#include <cstring>
 
 #include "src/system/utils/utils.h"
 
@@ -8,47 +9,67 @@
 #include "src/system/hal/gpio.h"
 #include "src/system/hal/pdm_handle.h"
 #include "src/system/hal/print.h"
+#include "src/system/hal/threads.h"
+
+#include "src/system/utils/audio_front_end.h"
+#include "src/system/utils/tempo_tracker.h"
+#include "src/system/utils/triple_buffer.h"
+
+#include <atomic>
 
 namespace lampda {
 namespace component {
 namespace microphone {
 
-utils::fft::FftAnalyzer<hal::microphone::PdmData::SAMPLE_SIZE, SoundStruct::numberOfFFtChanels, float> fftAnalyzer;
+/// analysis of the last SAMPLE_SIZE samples, on every capture, with decibel A weighted log bins
+using AnalyzerTy = utils::fft::ShortTimeFftAnalyzer<SoundStruct::SAMPLE_SIZE,
+                                                    SoundStruct::HOP_SIZE,
+                                                    SoundStruct::numberOfFFtChanels,
+                                                    float,
+                                                    utils::fft::Weighting::A>;
+AnalyzerTy fftAnalyzer;
+/// tempo of the sound, from the spectrum of every capture
+utils::fft::TempoTracker<SoundStruct::numberOfFFtChanels, SoundStruct::HOP_SIZE> tempoTracker;
+/// DC blocking and auto gain of the captures, in integer math
+utils::audio::AutoGainFrontEnd<hal::microphone::gainUpdateBaseline, gainedSignalTarget> frontEnd;
+/// auto gained samples of the analysis window, oldest first
+std::array<int16_t, SoundStruct::SAMPLE_SIZE> rectifiedWindow;
 
-inline float square(const float v) { return v * v; }
+/// set by the main loop, read by the analysis task
+std::atomic<bool> isStarted = false;
+/// set by the main loop when the microphone starts, the analysis task resets its state
+std::atomic<bool> shouldResetAnalysis = true;
+uint32_t lastMicFunctionCall = 0;
 
-/// Scaling for the DecibelA model
-float decibel_A_scaling(const float frequency)
-{
-  return square(12194.0f) * powf(frequency, 4) /
-         ((square(frequency) + square(20.6f)) *
-          sqrtf((square(frequency) + square(107.7f)) * (square(frequency) + square(737.9f))) *
-          (square(frequency) + square(12194.0f)));
-}
-/// Scaling for the DecibelB model
-float decibel_B_scaling(const float frequency)
-{
-  return square(12194.0f) * powf(frequency, 3) /
-         ((square(frequency) + square(20.6f)) * sqrtf((square(frequency) + square(158.5f))) *
-          (square(frequency) + square(12194.0f)));
-}
-/// Scaling for the DecibelC model
-float decibel_C_scaling(const float frequency)
-{
-  return square(12194.0f) * powf(frequency, 2) /
-         ((square(frequency) + square(20.6f)) * (square(frequency) + square(12194.0f)));
-}
+/// Latest sound analysis, written by the analysis task
+utils::TripleBuffer<SoundStruct> soundStructs;
+/// Latest compact sound analysis, written by the analysis task
+utils::TripleBuffer<SoundFeatures> soundFeatures;
 
-bool isStarted = false;
-uint32_t lastMicFunctionCall = 0;
-float autoGain = 1.0f;
+static_assert(SoundStruct::numberOfFFtChanels <= 32, "SoundFeatures::beatBands stores one bit per band");
+/// rolling average of the fft bands energy, for beat detection
+std::array<float, SoundStruct::numberOfFFtChanels> bandAverages;
+/// a band energy above its average times this factor is a beat
+static constexpr float beatThreshold = 1.5f;
+/// time constant of the band averages, in seconds
+static constexpr float bandAverageTime_s = 0.512f;
+/// weight of a new capture in the band averages, one capture per hop
+static constexpr float bandAverageWeight = SoundStruct::HOP_SIZE / (utils::fft::SAMPLE_RATE * bandAverageTime_s);
+
+/// no capture after this delay means the microphone stopped
+static constexpr int captureTimeout_ms = 100;
+/// event sent to the analysis task when the microphone starts
+static constexpr int startEvent = (1 << 2);
+/// sequence number of the last analyzed capture
+uint32_t lastAnalyzedSequenceNumber = 0;
 
-static constexpr float minAutoGain = 0.0001f;
-static constexpr float maxAutoGain = 30.0f;
+void analysis_task();
 
-// reactivity of the filter
-static constexpr float distortionFactor = 0.00005f; //[0, 1]
-static constexpr float desiredoutputRMS = desiredoutput * desiredoutput;
+/// fractional bits of the amplitude converted to decibels
+static constexpr uint8_t amplitudeShift = 8;
+/// a full scale A weighted amplitude is 108dB, in 1/256 decibel
+static constexpr int32_t levelOffsetDb_q8 =
+        108 * 256 - utils::audio::amplitude_to_decibels_q8(INT16_MAX << amplitudeShift);
 
 bool enable()
 {
@@ -56,8 +77,16 @@ bool enable()
   if (isStarted)
     return true;
 
-  autoGain = 1.0f;
+  // the analysis task is only started once, and waits for the microphone
+  hal::threads::start_thread(analysis_task, hal::threads::audio_taskName, 1, 1024);
+
+  shouldResetAnalysis = true;
   isStarted = hal::microphone::_private::start();
+  if (isStarted)
+  {
+    // wake up the analysis task
+    hal::threads::notify_thread(hal::threads::audio_taskName, startEvent);
+  }
   return isStarted;
 }
 
@@ -66,10 +95,8 @@ void disable()
   if (!isStarted)
     return;
 
-  autoGain = 1.0f;
-  hal::microphone::_private::stop();
-  fftAnalyzer.reset();
   isStarted = false;
+  hal::microphone::_private::stop();
 }
 
 void disable_after_non_use()
@@ -82,76 +109,52 @@ void disable_after_non_use()
   }
 }
 
-SoundStruct soundStruct;
-
-SoundStruct& process_sound_data(const hal::microphone::PdmData& data)
+void process_sound_data(const hal::microphone::PdmData& data, SoundStruct& soundStruct)
 {
   soundStruct.isDataValid = false;
   soundStruct.isFFTValid = false;
+  soundStruct.sequenceNumber = data.sequenceNumber;
   // validity checks
-  if (not data.is_valid() or data.sampleRead <= 0 or data.sampleRead > hal::microphone::PdmData::SAMPLE_SIZE)
-  {
-    return soundStruct;
-  }
-
-  // process the sound input as FFT
-  float dataMedian = 0.0;
-  for (uint16_t i = 0; i < data.sampleRead; i++)
+  if (not data.is_valid() or data.sampleRead <= 0 or data.sampleRead > SoundStruct::HOP_SIZE)
   {
-    // data is always at zero median, so use absolute
-    const int16_t dataP = data.data[i];
-    dataMedian += abs(dataP);
-    soundStruct.data[i] = dataP;
-
-    // FFT on the raw data
-    fftAnalyzer.set_data(dataP, i);
+    return;
   }
-  // fill the rest with zeros in FFT
-  for (uint16_t i = data.sampleRead; i < hal::microphone::PdmData::SAMPLE_SIZE; i++)
-    fftAnalyzer.set_data(0, i);
-  const float dataAverage = dataMedian / static_cast<float>(data.sampleRead);
 
-  // if average is greater than sound baseline, update the gain
-  const bool shouldUpdateGain = (dataAverage > hal::microphone::gainUpdateBaseline);
+  // slide the auto gained window
+  const uint16_t newSamples = data.sampleRead;
+  memmove(rectifiedWindow.data(),
+          rectifiedWindow.data() + newSamples,
+          (SoundStruct::SAMPLE_SIZE - newSamples) * sizeof(int16_t));
 
-  // decay gain to 1.0
-  if (not shouldUpdateGain)
-  {
-    static constexpr float restoreGain = 0.1f;
-    const float newGain = autoGain - restoreGain * (autoGain - 1.0f);
-    if (newGain > minAutoGain && newGain < maxAutoGain)
-      autoGain = newGain;
-  }
+  // remove the DC component and apply the auto gain, in a single pass
+  int16_t blockedSamples[SoundStruct::HOP_SIZE];
+  frontEnd.process(data.data.data(),
+                   newSamples,
+                   blockedSamples,
+                   rectifiedWindow.data() + SoundStruct::SAMPLE_SIZE - newSamples);
 
-  for (uint16_t i = 0; i < data.sampleRead; i++)
-  {
-    // use auto gain on data
-    const float autoGainedData = (soundStruct.data[i] / static_cast<float>(INT16_MAX)) * autoGain;
-    if (shouldUpdateGain)
-    {
-      const float autoGainB = (autoGainedData * autoGainedData) / desiredoutputRMS;
-      const float autoGainAA = 1.0f + (distortionFactor * (1.0f - autoGainB));
-      autoGain *= autoGainAA;
-    }
-
-    soundStruct.rectifiedData[i] = autoGainedData * static_cast<float>(INT16_MAX);
-  }
-  // keep the gain in bounds
-  autoGain = lmpd_constrain(autoGain, minAutoGain, maxAutoGain);
+  // slide the analysis window, and run the FFT on it
+  const bool isNewSpectrum = fftAnalyzer.push_samples(blockedSamples, newSamples);
 
-  // run FFT detection
-  fftAnalyzer.run_fast_fourrier_transform();
+  soundStruct.data = fftAnalyzer.samples;
+  soundStruct.rectifiedData = rectifiedWindow;
 
   // copy the FFT buffer
-  soundStruct.isFFTValid = true;
+  soundStruct.isFFTValid = isNewSpectrum;
   // copy the fft results
   soundStruct.fft_log = fftAnalyzer.fftLog;
   soundStruct.fft_raw = fftAnalyzer.fftBin;
 
-  const float decibelScaling = decibel_A_scaling(fftAnalyzer.maxFrequency);
-  // max sound level is actual sound level
-  soundStruct.sound_level_Db =
-          20.0f * log10f(decibelScaling * fftAnalyzer.maxMagnitude / static_cast<float>(INT16_MAX)) + 110.0f;
+  if (isNewSpectrum)
+    tempoTracker.update(fftAnalyzer.fftLog);
+  soundStruct.bpm = tempoTracker.get_bpm();
+  soundStruct.beatPhase = tempoTracker.get_beat_phase();
+  soundStruct.tempoConfidence = tempoTracker.get_confidence();
+
+  // A weighted amplitude of all the frequencies is the sound level
+  const float amplitude = lmpd_constrain(fftAnalyzer.totalAmplitude, 0.0f, static_cast<float>(UINT16_MAX));
+  const int32_t levelDb_q8 = utils::audio::amplitude_to_decibels_q8(amplitude * (1 << amplitudeShift) + 0.5f);
+  soundStruct.sound_level_Db = (levelDb_q8 + levelOffsetDb_q8) / 256.0f;
   soundStruct.maxAmplitude = fftAnalyzer.maxMagnitude;
   soundStruct.maxAmplitudeFrequency = fftAnalyzer.maxFrequency;
   soundStruct.isDataValid = true;
@@ -160,22 +163,126 @@ SoundStruct& process_sound_data(const hal::microphone::PdmData& data)
   {
     soundStruct.fft_log_end_frequencies[i] = fftAnalyzer.get_log_bin_max_frequency(i);
   }
+}
+
+/// Extract the compact features of an analysis
+void extract_features(const SoundStruct& soundStruct, SoundFeatures& features)
+{
+  features.isDataValid = soundStruct.isDataValid;
+  features.sequenceNumber = soundStruct.sequenceNumber;
+  features.sound_level_Db = soundStruct.sound_level_Db;
+  features.maxAmplitude = soundStruct.maxAmplitude;
+  features.maxAmplitudeFrequency = soundStruct.maxAmplitudeFrequency;
+  features.fft_log = soundStruct.fft_log;
+  features.bpm = soundStruct.bpm;
+  features.beatPhase = soundStruct.beatPhase;
+  features.tempoConfidence = soundStruct.tempoConfidence;
 
-  // we return a static object here...
-  return soundStruct;
+  features.beatBands = 0;
+  if (not soundStruct.isFFTValid)
+    return;
+  for (uint8_t i = 0; i < SoundStruct::numberOfFFtChanels; ++i)
+  {
+    const float energy = soundStruct.fft_log[i];
+    if (bandAverages[i] > 0.0f and energy > beatThreshold * bandAverages[i])
+      features.beatBands |= (1u << i);
+    bandAverages[i] += bandAverageWeight * (energy - bandAverages[i]);
+  }
+}
+
+/// forget the previous audio, from the analysis task
+void reset_analysis()
+{
+  frontEnd.reset();
+  fftAnalyzer.reset();
+  tempoTracker.reset();
+  rectifiedWindow.fill(0);
+  bandAverages.fill(0.0f);
+  lastAnalyzedSequenceNumber = 0;
 }
 
-SoundStruct& get_sound_characteristics()
+void analysis_task()
 {
-  if (!enable())
+  if (not isStarted)
+  {
+    // sleep until the microphone starts
+    hal::threads::wait_notification(0);
+    return;
+  }
+
+  // wait for the next capture, notified by the microphone interrupt
+  hal::threads::wait_notification(captureTimeout_ms);
+
+  if (shouldResetAnalysis.exchange(false))
+    reset_analysis();
+
+  // analyze all the pending captures, in order
+  for (hal::microphone::PdmData data = hal::microphone::_private::get(); data.is_valid();
+       data = hal::microphone::_private::get())
   {
-    // ERROR
-    return soundStruct;
+    const uint32_t analysisStartTime_us = hal::time_us();
+    // the analysis needs contiguous audio: restart it after dropped captures
+    if (lastAnalyzedSequenceNumber != 0 and data.sequenceNumber != lastAnalyzedSequenceNumber + 1)
+      reset_analysis();
+    lastAnalyzedSequenceNumber = data.sequenceNumber;
+
+    SoundStruct& soundStruct = soundStructs.write_buffer();
+    process_sound_data(data, soundStruct);
+    extract_features(soundStruct, soundFeatures.write_buffer());
+    soundStruct.analysisDuration_us = hal::time_us() - analysisStartTime_us;
+
+    soundStructs.publish();
+    soundFeatures.publish();
   }
+}
+
+/// generation of the fetched frames, incremented when the previous frame goes back to the analysis task
+uint32_t frameGeneration = 1;
+/// the frames were fetched during this main loop iteration
+bool isFrameFetched = false;
+/// read by stale views. constexpr: constant initialized, so it stays in flash (.rodata) instead of RAM
+constexpr SoundStruct emptySoundStruct {};
 
-  return process_sound_data(hal::microphone::_private::get());
+/// fetch the latest frames, once per main loop iteration
+void fetch_frames()
+{
+  // start the analysis on first use, the results come with the next capture
+  enable();
+
+  if (isFrameFetched)
+    return;
+  isFrameFetched = true;
+
+  // the previous frame is now owned by the analysis task
+  if (soundStructs.fetch())
+    frameGeneration++;
+  soundFeatures.fetch();
+}
+
+bool SoundFrame::is_readable() const { return frame != nullptr and generation == frameGeneration; }
+
+const SoundStruct& SoundFrame::get() const { return is_readable() ? *frame : emptySoundStruct; }
+
+SoundFrame get_sound_frame()
+{
+  fetch_frames();
+  return SoundFrame(&soundStructs.read_buffer(), frameGeneration);
+}
+
+const SoundStruct& get_sound_characteristics()
+{
+  fetch_frames();
+  return soundStructs.read_buffer();
 }
 
+const SoundFeatures& get_sound_features()
+{
+  fetch_frames();
+  return soundFeatures.read_buffer();
+}
+
+void release_sound_frame() { isFrameFetched = false; }
+
 } // namespace microphone
 } // namespace component
 } // namespace lampda
@@ -37,13 +37,17 @@ struct SoundStruct
 
   /// flag that indicate sound data validity
   bool isDataValid = false;
+  /// sequence number of the analyzed microphone capture, changes only when a new capture was analyzed
+  uint32_t sequenceNumber = 0;
 
-  /// Size fo the audio sample
-  static constexpr auto SAMPLE_SIZE = hal::microphone::PdmData::SAMPLE_SIZE;
+  /// Size fo the audio sample, the analysis window
+  static constexpr uint16_t SAMPLE_SIZE = 512;
+  /// New samples between two analysis (a microphone capture). The analysis windows overlap
+  static constexpr uint16_t HOP_SIZE = hal::microphone::PdmData::SAMPLE_SIZE;
 
-  /// raw audio data
+  /// raw audio data, the last SAMPLE_SIZE samples
   std::array<int16_t, SAMPLE_SIZE> data;
-  /// audio data with auto gain enabled
+  /// audio data with auto gain enabled, the last SAMPLE_SIZE samples
   std::array<int16_t, SAMPLE_SIZE> rectifiedData;
 
   /// Sound level of this sample, in Decibels A
@@ -53,6 +57,9 @@ struct SoundStruct
   /// Maximum detected amplitude frequency of this sample, in Hertz
   float maxAmplitudeFrequency = 0.0f;
 
+  /// Duration of the analysis of the last capture, in microseconds
+  uint32_t analysisDuration_us = 0;
+
   /*
    * FFT
    */
@@ -70,10 +77,84 @@ struct SoundStruct
 
   /// Results of the FFT process, in raw Hertz bins
   std::array<float, SAMPLE_SIZE / 2> fft_raw;
-  /// Results of the FFT process, in scaled logarithmic bins. This is closer to the sound sensitivity of the Human ear
+  /// Results of the FFT process, in scaled logarithmic bins weighted in decibel A. This is closer to the sound
+  /// sensitivity of the Human ear
   std::array<float, numberOfFFtChanels> fft_log;
   /// Results of the FFT process, in maximum frequency for every bin
   std::array<float, numberOfFFtChanels> fft_log_end_frequencies;
+
+  /*
+   * Tempo
+   */
+
+  /// Estimated tempo, in beats per minute. 0 until the first estimation
+  float bpm = 0.0f;
+  /// Position in the current beat, in [0, 1[. 0 is on the beat
+  float beatPhase = 0.0f;
+  /// Periodicity of the sound at the estimated tempo, in [0, 1]. The tempo is unreliable under ~0.3
+  float tempoConfidence = 0.0f;
+};
+
+/**
+ * \brief Compact results of a sound analysis, cheap to read on every frame.
+ * Use this instead of \ref SoundStruct when the raw data and raw FFT are not needed.
+ */
+struct SoundFeatures
+{
+  /// flag that indicate sound data validity
+  bool isDataValid = false;
+  /// sequence number of the analyzed microphone capture, changes only when a new capture was analyzed
+  uint32_t sequenceNumber = 0;
+
+  /// Sound level of this sample, in Decibels A
+  float sound_level_Db = 0.0f;
+  /// Maximum detected amplitude of this sample
+  float maxAmplitude = 0.0f;
+  /// Maximum detected amplitude frequency of this sample, in Hertz
+  float maxAmplitudeFrequency = 0.0f;
+
+  /// Results of the FFT process, in scaled logarithmic bins
+  std::array<float, SoundStruct::numberOfFFtChanels> fft_log;
+
+  /// One bit per \ref fft_log band, set when the band energy jumps above its recent average
+  uint32_t beatBands = 0;
+
+  /// Estimated tempo, in beats per minute. 0 until the first estimation
+  float bpm = 0.0f;
+  /// Position in the current beat, in [0, 1[. 0 is on the beat
+  float beatPhase = 0.0f;
+  /// Periodicity of the sound at the estimated tempo, in [0, 1]. The tempo is unreliable under ~0.3
+  float tempoConfidence = 0.0f;
+
+  /// Return true if a beat was detected on this band of \ref fft_log
+  bool is_beat_on_band(const uint8_t band) const { return (beatBands & (1u << band)) != 0; }
+};
+
+/**
+ * \brief Read only view of a sound analysis frame, without copy.
+ *
+ * The frames are fetched at most once per main loop iteration, and a view can only be read during the iteration it
+ * was obtained in. After that, the frame memory goes back to the analysis task: a stale view reads as an empty and
+ * invalid frame, never as a frame being written.
+ */
+class SoundFrame
+{
+public:
+  SoundFrame() = default;
+
+  /// Return true if the frame can be read: obtained during this main loop iteration
+  bool is_readable() const;
+  /// Return the analysis results, or an empty frame if the view is stale
+  const SoundStruct& get() const;
+  /// Access the analysis results, see \ref get
+  const SoundStruct* operator->() const { return &get(); }
+
+private:
+  friend SoundFrame get_sound_frame();
+  SoundFrame(const SoundStruct* frame, const uint32_t generation) : frame(frame), generation(generation) {}
+
+  const SoundStruct* frame = nullptr; ///< viewed frame
+  uint32_t generation = 0;            ///< frame generation, compared to the current one on read
 };
 
 /**
@@ -93,10 +174,32 @@ void disable();
 void disable_after_non_use();
 
 /**
- * \brief Compute and process sound data
+ * \brief Return a view of the latest sound analysis, without blocking nor copying.
+ * The analysis runs in its own task, on every microphone capture. All calls during a main loop iteration return the
+ * same frame.
  * \return the last sound data
  */
-SoundStruct& get_sound_characteristics();
+SoundFrame get_sound_frame();
+
+/**
+ * \brief Return the latest sound analysis, see \ref get_sound_frame.
+ * The reference is only valid during this main loop iteration.
+ * \return the last sound data
+ */
+const SoundStruct& get_sound_characteristics();
+
+/**
+ * \brief Return the compact results of the latest sound analysis, without blocking.
+ * The reference is only valid during this main loop iteration.
+ * \return the last sound features
+ */
+const SoundFeatures& get_sound_features();
+
+/**
+ * \brief End of a main loop iteration: the next sound frame request fetches the latest analysis.
+ * The views of the current frame become stale when the next frame is fetched.
+ */
+void release_sound_frame();
 
 } // namespace microphone
 } // namespace component
@@ -589,6 +589,50 @@ float LSM6DS3::calcGyro(int16_t input)
   return output;
 }
 
+//****************************************************************************//
+//
+//  Burst section
+//
+//****************************************************************************//
+status_t LSM6DS3::readRawMotion(RawMotion& motion)
+{
+  // OUTX_L_G to OUTZ_H_XL, the address auto-increments (IF_INC)
+  uint8_t buffer[12];
+  status_t errorLevel = readRegisterRegion(buffer, LSM6DS3_ACC_GYRO_OUTX_L_G, sizeof(buffer));
+  if (errorLevel != IMU_SUCCESS)
+  {
+    nonSuccessCounter++;
+    return errorLevel;
+  }
+
+  for (uint8_t axis = 0; axis < 3; axis++)
+  {
+    motion.gyro[axis] = (int16_t)buffer[2 * axis] | int16_t(buffer[2 * axis + 1] << 8);
+    motion.accel[axis] = (int16_t)buffer[6 + 2 * axis] | int16_t(buffer[6 + 2 * axis + 1] << 8);
+  }
+  return IMU_SUCCESS;
+}
+
+float LSM6DS3::accelScale(void)
+{
+  // 0.061 mg per LSB at 2g
+  const int32_t sensitivity_ug = 61 * (settings.accelRange >> 1);
+  return sensitivity_ug * 1e-6f;
+}
+
+float LSM6DS3::gyroScale(void)
+{
+  uint8_t gyroRangeDivisor = settings.gyroRange / 125;
+  if (settings.gyroRange == 245)
+  {
+    gyroRangeDivisor = 2;
+  }
+
+  // 4.375 mdps per LSB at 125dps
+  const int32_t sensitivity_udps = 4375 * gyroRangeDivisor;
+  return sensitivity_udps * 1e-6f;
+}
+
 //****************************************************************************//
 //
 //  Temperature section
@@ -737,6 +781,45 @@ uint16_t LSM6DS3::fifoGetStatus(void)
 }
 void LSM6DS3::fifoEnd(void)
 {
-  // turn off the fifo
-  writeRegister(LSM6DS3_ACC_GYRO_FIFO_STATUS1, 0x00); // Disable
+  // turn off the fifo (bypass mode), this also empties it
+  writeRegister(LSM6DS3_ACC_GYRO_FIFO_CTRL5, LSM6DS3_ACC_GYRO_FIFO_MODE_BYPASS); // Disable
+}
+
+status_t LSM6DS3::fifoReadStatus(uint16_t& unreadWords, uint16_t& pattern)
+{
+  // FIFO_STATUS1 to FIFO_STATUS4
+  uint8_t buffer[4];
+  status_t errorLevel = readRegisterRegion(buffer, LSM6DS3_ACC_GYRO_FIFO_STATUS1, sizeof(buffer));
+  if (errorLevel != IMU_SUCCESS)
+  {
+    nonSuccessCounter++;
+    return errorLevel;
+  }
+
+  unreadWords = buffer[0] | ((buffer[1] & LSM6DS3_ACC_GYRO_DIFF_FIFO_STATUS2_MASK) << 8);
+  pattern = buffer[2] | ((buffer[3] & 0x03) << 8);
+  return IMU_SUCCESS;
+}
+
+status_t LSM6DS3::fifoReadWords(int16_t* words, uint8_t count)
+{
+  if (count > 127)
+  {
+    return IMU_OUT_OF_BOUNDS;
+  }
+
+  // little endian words, read in place
+  uint8_t* buffer = (uint8_t*)words;
+  status_t errorLevel = readRegisterRegion(buffer, LSM6DS3_ACC_GYRO_FIFO_DATA_OUT_L, 2 * count);
+  if (errorLevel != IMU_SUCCESS)
+  {
+    nonSuccessCounter++;
+    return errorLevel;
+  }
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    words[i] = (int16_t)buffer[2 * i] | int16_t(buffer[2 * i + 1] << 8);
+  }
+  return IMU_SUCCESS;
 }
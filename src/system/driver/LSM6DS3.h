@@ -165,6 +165,21 @@ public:
   float readFloatGyroY(void);
   float readFloatGyroZ(void);
 
+  // Raw outputs of the gyroscope and accelerometer, in the register order
+  struct RawMotion
+  {
+    int16_t gyro[3];
+    int16_t accel[3];
+  };
+
+  // Reads the 12 output registers (OUTX_L_G to OUTZ_H_XL) in a single
+  //   auto-increment transaction: all axes come from the same sample
+  status_t readRawMotion(RawMotion&);
+
+  // Sensitivities from the full scale settings, in g and degree/s per LSB
+  float accelScale(void);
+  float gyroScale(void);
+
   // Temperature related methods
   int16_t readRawTemp(void);
   float readTempC(void);
@@ -177,6 +192,13 @@ public:
   uint16_t fifoGetStatus(void);
   void fifoEnd(void);
 
+  // Reads the number of unread FIFO words (DIFF_FIFO) and the pattern of
+  //   the next word (FIFO_PATTERN) in a single transaction
+  status_t fifoReadStatus(uint16_t& unreadWords, uint16_t& pattern);
+  // Reads FIFO words in a single transaction, at most 127: the address
+  //   rolls back from FIFO_DATA_OUT_H to FIFO_DATA_OUT_L
+  status_t fifoReadWords(int16_t* words, uint8_t count);
+
   enum InterruptType
   {
     None,        // no interrupt
@@ -246,8 +246,54 @@ int16_t grad16(uint8_t hash, int16_t x)
   return avg15(u, v);
 }
 
+/**
+ * \brief Hashes of the 8 corners of a 3D lattice cell.
+ * Computing them is most of the lattice work of a 3D noise sample, and they only depend on the cell coordinates:
+ * neighbor samples that fall in the same cell can share them.
+ */
+struct CellHashes
+{
+  uint8_t aa, ba, ab, bb, aa1, ba1, ab1, bb1;
+};
+
+/// Hash the corners of the lattice cell (X, Y, Z)
+static inline CellHashes hash_cell(uint8_t X, uint8_t Y, uint8_t Z)
+{
+  uint8_t A = P(X) + Y;
+  uint8_t AA = P(A) + Z;
+  uint8_t AB = P(A + 1) + Z;
+  uint8_t B = P(X + 1) + Y;
+  uint8_t BA = P(B) + Z;
+  uint8_t BB = P(B + 1) + Z;
+  return {P(AA), P(BA), P(AB), P(BB), P(AA + 1), P(BA + 1), P(AB + 1), P(BB + 1)};
+}
+
 namespace noise8 {
 
+/// 3D noise in a cell, from the signed positions (xx, yy, zz) and fades (u, v, w) of the point in this cell
+static inline int8_t inoise8_raw_in_cell(
+        const CellHashes& h, int8_t xx, int8_t yy, int8_t zz, uint8_t u, uint8_t v, uint8_t w)
+{
+  uint8_t N = 0x80;
+
+  int8_t X1 = lerp7by8(grad8(h.aa, xx, yy, zz), grad8(h.ba, xx - N, yy, zz), u);
+  int8_t X2 = lerp7by8(grad8(h.ab, xx, yy - N, zz), grad8(h.bb, xx - N, yy - N, zz), u);
+  int8_t X3 = lerp7by8(grad8(h.aa1, xx, yy, zz - N), grad8(h.ba1, xx - N, yy, zz - N), u);
+  int8_t X4 = lerp7by8(grad8(h.ab1, xx, yy - N, zz - N), grad8(h.bb1, xx - N, yy - N, zz - N), u);
+
+  int8_t Y1 = lerp7by8(X1, X2, v);
+  int8_t Y2 = lerp7by8(X3, X4, v);
+
+  return lerp7by8(Y1, Y2, w);
+}
+
+/// Rescale a raw 8 bits noise to the full output range
+static inline uint8_t scale_raw_noise(int8_t n)
+{
+  n += 64;            // 0..128
+  return qadd8(n, n); // 0..255
+}
+
 int8_t inoise8_raw(uint16_t x)
 {
   // Find the unit cube containing the point
@@ -310,18 +356,8 @@ int8_t inoise8_raw(uint16_t x, uint16_t y)
 
 int8_t inoise8_raw(uint16_t x, uint16_t y, uint16_t z)
 {
-  // Find the unit cube containing the point
-  uint8_t X = x >> 8;
-  uint8_t Y = y >> 8;
-  uint8_t Z = z >> 8;
-
-  // Hash cube corner coordinates
-  uint8_t A = P(X) + Y;
-  uint8_t AA = P(A) + Z;
-  uint8_t AB = P(A + 1) + Z;
-  uint8_t B = P(X + 1) + Y;
-  uint8_t BA = P(B) + Z;
-  uint8_t BB = P(B + 1) + Z;
+  // Find the unit cube containing the point, and hash its corners
+  const CellHashes hashes = hash_cell(x >> 8, y >> 8, z >> 8);
 
   // Get the relative position of the point in the cube
   uint8_t u = x;
@@ -332,23 +368,12 @@ int8_t inoise8_raw(uint16_t x, uint16_t y, uint16_t z)
   int8_t xx = ((uint8_t)(x) >> 1) & 0x7F;
   int8_t yy = ((uint8_t)(y) >> 1) & 0x7F;
   int8_t zz = ((uint8_t)(z) >> 1) & 0x7F;
-  uint8_t N = 0x80;
 
   u = FADE8(u);
   v = FADE8(v);
   w = FADE8(w);
 
-  int8_t X1 = lerp7by8(grad8(P(AA), xx, yy, zz), grad8(P(BA), xx - N, yy, zz), u);
-  int8_t X2 = lerp7by8(grad8(P(AB), xx, yy - N, zz), grad8(P(BB), xx - N, yy - N, zz), u);
-  int8_t X3 = lerp7by8(grad8(P(AA + 1), xx, yy, zz - N), grad8(P(BA + 1), xx - N, yy, zz - N), u);
-  int8_t X4 = lerp7by8(grad8(P(AB + 1), xx, yy - N, zz - N), grad8(P(BB + 1), xx - N, yy - N, zz - N), u);
-
-  int8_t Y1 = lerp7by8(X1, X2, v);
-  int8_t Y2 = lerp7by8(X3, X4, v);
-
-  int8_t ans = lerp7by8(Y1, Y2, w);
-
-  return ans;
+  return inoise8_raw_in_cell(hashes, xx, yy, zz, u, v, w);
 }
 
 uint8_t inoise(uint16_t x)
@@ -371,10 +396,48 @@ uint8_t inoise(uint16_t x, uint16_t y)
 uint8_t inoise(uint16_t x, uint16_t y, uint16_t z)
 {
   // return scale8(76+(inoise8_raw(x,y,z)),215)<<1;
-  int8_t n = inoise8_raw(x, y, z); // -64..+64
-  n += 64;                         //   0..128
-  uint8_t ans = qadd8(n, n);       //   0..255
-  return ans;
+  return scale_raw_noise(inoise8_raw(x, y, z)); // -64..+64 -> 0..255
+}
+
+void inoise_grid(uint16_t x,
+                 uint16_t xStep,
+                 uint16_t width,
+                 uint16_t y,
+                 uint16_t yStep,
+                 uint16_t height,
+                 uint16_t z,
+                 uint8_t* out)
+{
+  // z is shared by the whole grid
+  const uint8_t Z = z >> 8;
+  const int8_t zz = ((uint8_t)(z) >> 1) & 0x7F;
+  const uint8_t w = FADE8((uint8_t)z);
+
+  for (uint16_t j = 0; j < height; ++j, y += yStep)
+  {
+    // y is shared by the whole row
+    const uint8_t Y = y >> 8;
+    const int8_t yy = ((uint8_t)(y) >> 1) & 0x7F;
+    const uint8_t v = FADE8((uint8_t)y);
+
+    uint16_t sampleX = x;
+    uint8_t lastX = sampleX >> 8;
+    CellHashes hashes = hash_cell(lastX, Y, Z);
+    for (uint16_t i = 0; i < width; ++i, sampleX += xStep)
+    {
+      // rehash only when crossing a cell boundary
+      const uint8_t X = sampleX >> 8;
+      if (X != lastX)
+      {
+        lastX = X;
+        hashes = hash_cell(X, Y, Z);
+      }
+
+      const int8_t xx = ((uint8_t)(sampleX) >> 1) & 0x7F;
+      const uint8_t u = FADE8((uint8_t)sampleX);
+      *out++ = scale_raw_noise(inoise8_raw_in_cell(hashes, xx, yy, zz, u, v, w));
+    }
+  }
 }
 
 uint8_t inoise_octaves(uint16_t x, uint8_t octaves, int scale, uint16_t time)
@@ -455,26 +518,9 @@ int16_t inoise16_raw(uint32_t x, uint32_t y)
   return ans;
 }
 
-int16_t inoise16_raw(uint32_t x, uint32_t y, uint32_t z)
+/// 3D noise in a cell, from the position (u, v, w) of the point in this cell
+static inline int16_t inoise16_raw_in_cell(const CellHashes& h, uint16_t u, uint16_t v, uint16_t w)
 {
-  // Find the unit cube containing the point
-  uint8_t X = (x >> 16) & 0xFF;
-  uint8_t Y = (y >> 16) & 0xFF;
-  uint8_t Z = (z >> 16) & 0xFF;
-
-  // Hash cube corner coordinates
-  uint8_t A = P(X) + Y;
-  uint8_t AA = P(A) + Z;
-  uint8_t AB = P(A + 1) + Z;
-  uint8_t B = P(X + 1) + Y;
-  uint8_t BA = P(B) + Z;
-  uint8_t BB = P(B + 1) + Z;
-
-  // Get the relative position of the point in the cube
-  uint16_t u = x & 0xFFFF;
-  uint16_t v = y & 0xFFFF;
-  uint16_t w = z & 0xFFFF;
-
   // Get a signed version of the above for the grad function
   int16_t xx = (u >> 1) & 0x7FFF;
   int16_t yy = (v >> 1) & 0x7FFF;
@@ -487,17 +533,42 @@ int16_t inoise16_raw(uint32_t x, uint32_t y, uint32_t z)
 
   // skip the log fade adjustment for the moment, otherwise here we would
   // adjust fade values for u,v,w
-  int16_t X1 = lerp15by16(grad16(P(AA), xx, yy, zz), grad16(P(BA), xx - N, yy, zz), u);
-  int16_t X2 = lerp15by16(grad16(P(AB), xx, yy - N, zz), grad16(P(BB), xx - N, yy - N, zz), u);
-  int16_t X3 = lerp15by16(grad16(P(AA + 1), xx, yy, zz - N), grad16(P(BA + 1), xx - N, yy, zz - N), u);
-  int16_t X4 = lerp15by16(grad16(P(AB + 1), xx, yy - N, zz - N), grad16(P(BB + 1), xx - N, yy - N, zz - N), u);
+  int16_t X1 = lerp15by16(grad16(h.aa, xx, yy, zz), grad16(h.ba, xx - N, yy, zz), u);
+  int16_t X2 = lerp15by16(grad16(h.ab, xx, yy - N, zz), grad16(h.bb, xx - N, yy - N, zz), u);
+  int16_t X3 = lerp15by16(grad16(h.aa1, xx, yy, zz - N), grad16(h.ba1, xx - N, yy, zz - N), u);
+  int16_t X4 = lerp15by16(grad16(h.ab1, xx, yy - N, zz - N), grad16(h.bb1, xx - N, yy - N, zz - N), u);
 
   int16_t Y1 = lerp15by16(X1, X2, v);
   int16_t Y2 = lerp15by16(X3, X4, v);
 
-  int16_t ans = lerp15by16(Y1, Y2, w);
+  return lerp15by16(Y1, Y2, w);
+}
 
-  return ans;
+/// Rescale a raw 3D 16 bits noise to the full output range
+static inline uint16_t scale_raw_noise(int16_t raw)
+{
+  int32_t ans = raw;
+  ans = ans + 19052L;
+  uint32_t pan = ans;
+  // pan = (ans * 220L) >> 7.  That's the same as:
+  // pan = (ans * 440L) >> 8.  And this way avoids a 7X four-byte shift-loop on
+  // AVR. Identical math, except for the highest bit, which we don't care about
+  // anyway, since we're returning the 'middle' 16 out of a 32-bit value anyway.
+  pan *= 440L;
+  return (pan >> 8);
+
+  // // return scale16by8(pan,220)<<1;
+  // return ((inoise16_raw(x,y,z)+19052)*220)>>7;
+  // return scale16by8(inoise16_raw(x,y,z)+19052,220)<<1;
+}
+
+int16_t inoise16_raw(uint32_t x, uint32_t y, uint32_t z)
+{
+  // Find the unit cube containing the point, and hash its corners
+  const CellHashes hashes = hash_cell((x >> 16) & 0xFF, (y >> 16) & 0xFF, (z >> 16) & 0xFF);
+
+  // Get the relative position of the point in the cube
+  return inoise16_raw_in_cell(hashes, x & 0xFFFF, y & 0xFFFF, z & 0xFFFF);
 }
 
 uint16_t inoise(uint32_t x) { return ((uint32_t)((int32_t)inoise16_raw(x) + 17308L)) << 1; }
@@ -518,23 +589,255 @@ uint16_t inoise(uint32_t x, uint32_t y)
   // return scale16by8(inoise16_raw(x,y)+17308,242)<<1;
 }
 
-uint16_t inoise(uint32_t x, uint32_t y, uint32_t z)
+uint16_t inoise(uint32_t x, uint32_t y, uint32_t z) { return scale_raw_noise(inoise16_raw(x, y, z)); }
+
+void inoise(const uint32_t* x, const uint32_t* y, const uint32_t* z, uint16_t* out, uint16_t count)
 {
-  int32_t ans = inoise16_raw(x, y, z);
-  ans = ans + 19052L;
-  uint32_t pan = ans;
-  // pan = (ans * 220L) >> 7.  That's the same as:
-  // pan = (ans * 440L) >> 8.  And this way avoids a 7X four-byte shift-loop on
-  // AVR. Identical math, except for the highest bit, which we don't care about
-  // anyway, since we're returning the 'middle' 16 out of a 32-bit value anyway.
-  pan *= 440L;
-  return (pan >> 8);
+  if (count == 0)
+    return;
 
-  // // return scale16by8(pan,220)<<1;
-  // return ((inoise16_raw(x,y,z)+19052)*220)>>7;
-  // return scale16by8(inoise16_raw(x,y,z)+19052,220)<<1;
+  // cell of the last point, start with the first one
+  uint32_t lastCell = ((x[0] >> 16) & 0xFF) | (((y[0] >> 16) & 0xFF) << 8) | (((z[0] >> 16) & 0xFF) << 16);
+  CellHashes hashes = hash_cell(lastCell, lastCell >> 8, lastCell >> 16);
+  for (uint16_t i = 0; i < count; ++i)
+  {
+    // rehash only when the point leaves the cell of the previous one
+    const uint32_t cell = ((x[i] >> 16) & 0xFF) | (((y[i] >> 16) & 0xFF) << 8) | (((z[i] >> 16) & 0xFF) << 16);
+    if (cell != lastCell)
+    {
+      lastCell = cell;
+      hashes = hash_cell(cell, cell >> 8, cell >> 16);
+    }
+
+    out[i] = scale_raw_noise(inoise16_raw_in_cell(hashes, x[i] & 0xFFFF, y[i] & 0xFFFF, z[i] & 0xFFFF));
+  }
 }
 
 } // namespace noise16
 
+/**
+ * Simplex noise: the space is divided in simplices (triangles in 2D, tetrahedrons in 3D) instead of squares/cubes,
+ * so a sample only mixes the gradients of 3 (2D) or 4 (3D) corners, instead of 4 and 8.
+ * Fixed point implementation: coordinates are handled in Q16 and corner offsets in Q14, no floats.
+ */
+namespace simplex {
+
+/// 3D unskew factor (1/6), Q14 (the 1/3 skew and 1/6 unskew of the cell are exact integer divisions)
+static constexpr int32_t G3_q14 = 2731;
+/// 2D skew factor ((sqrt(3) - 1) / 2), Q32: the skew is applied to coordinates up to 2^17 cells
+static constexpr int64_t F2_q32 = 1572067139;
+/// 2D unskew factor ((3 - sqrt(3)) / 6), Q32
+static constexpr int64_t G2_q32 = 907633386;
+/// 2D unskew factor ((3 - sqrt(3)) / 6), Q14
+static constexpr int32_t G2_q14 = 3462;
+
+/// Dot product of a 3D gradient (one of the 12 cube edges) with the corner offset, Q14
+static inline int32_t grad(uint8_t hash, int32_t x, int32_t y, int32_t z)
+{
+  hash = hash & 15;
+  int32_t u = hash < 8 ? x : y;
+  int32_t v = hash < 4 ? y : hash == 12 || hash == 14 ? x : z;
+  return ((hash & 1) ? -u : u) + ((hash & 2) ? -v : v);
+}
+
+/// Dot product of a 2D gradient (one of 8 directions) with the corner offset, Q14
+static inline int32_t grad(uint8_t hash, int32_t x, int32_t y)
+{
+  hash = hash & 7;
+  if (hash & 4)
+  {
+    // axis aligned gradients
+    const int32_t u = (hash & 2) ? y : x;
+    return (hash & 1) ? -u : u;
+  }
+  return ((hash & 1) ? -x : x) + ((hash & 2) ? -y : y);
+}
+
+/// Falloff of a corner contribution (r² - d²)⁴, from the squared radius of influence and distance, in Q24.
+/// Coarser fixed point values show as steps in the output
+static inline int32_t falloff(int32_t radius_q28, int32_t squaredDistance_q28)
+{
+  int32_t t = radius_q28 - squaredDistance_q28;
+  if (t <= 0)
+    return 0;
+  const uint32_t t_q16 = t >> 12;
+  const uint32_t t2_q16 = (t_q16 * t_q16) >> 16;
+  return t2_q16 * t2_q16 >> 8; // Q24
+}
+
+/// Contribution of a corner: (r² - d²)⁴ * (gradient . offset), in Q28
+static inline int32_t corner(int32_t radius_q28, uint8_t hash, int32_t x, int32_t y, int32_t z)
+{
+  const int32_t t4_q24 = falloff(radius_q28, x * x + y * y + z * z);
+  if (t4_q24 == 0)
+    return 0;
+  return ((int64_t)t4_q24 * grad(hash, x, y, z)) >> 10;
+}
+
+/// \copydoc corner
+static inline int32_t corner(int32_t radius_q28, uint8_t hash, int32_t x, int32_t y)
+{
+  const int32_t t4_q24 = falloff(radius_q28, x * x + y * y);
+  if (t4_q24 == 0)
+    return 0;
+  return ((int64_t)t4_q24 * grad(hash, x, y)) >> 10;
+}
+
+/// Raw 3D simplex noise, from 16.16 fixed point coordinates, in Q28
+static int32_t noise_raw(uint32_t x, uint32_t y, uint32_t z)
+{
+  // skew the input space to find the simplex cell
+  const int64_t s = ((int64_t)x + y + z) / 3;
+  const uint32_t i = (x + s) >> 16;
+  const uint32_t j = (y + s) >> 16;
+  const uint32_t k = (z + s) >> 16;
+
+  // unskew the cell origin back, and get the offset of the point from it (Q14)
+  const int64_t t = (((int64_t)i + j + k) << 16) / 6;
+  const int32_t x0 = (x - ((int64_t)i << 16) + t) >> 2;
+  const int32_t y0 = (y - ((int64_t)j << 16) + t) >> 2;
+  const int32_t z0 = (z - ((int64_t)k << 16) + t) >> 2;
+
+  // find the tetrahedron we are in, from the offsets order
+  uint8_t i1, j1, k1, i2, j2, k2;
+  if (x0 >= y0)
+  {
+    if (y0 >= z0)
+    {
+      i1 = 1, j1 = 0, k1 = 0, i2 = 1, j2 = 1, k2 = 0;
+    }
+    else if (x0 >= z0)
+    {
+      i1 = 1, j1 = 0, k1 = 0, i2 = 1, j2 = 0, k2 = 1;
+    }
+    else
+    {
+      i1 = 0, j1 = 0, k1 = 1, i2 = 1, j2 = 0, k2 = 1;
+    }
+  }
+  else
+  {
+    if (y0 < z0)
+    {
+      i1 = 0, j1 = 0, k1 = 1, i2 = 0, j2 = 1, k2 = 1;
+    }
+    else if (x0 < z0)
+    {
+      i1 = 0, j1 = 1, k1 = 0, i2 = 0, j2 = 1, k2 = 1;
+    }
+    else
+    {
+      i1 = 0, j1 = 1, k1 = 0, i2 = 1, j2 = 1, k2 = 0;
+    }
+  }
+
+  // hash the 4 corners
+  const uint8_t ii = i;
+  const uint8_t jj = j;
+  const uint8_t kk = k;
+  const uint8_t h0 = P(P(P(ii) + jj) + kk);
+  const uint8_t h1 = P(P(P(ii + i1) + jj + j1) + kk + k1);
+  const uint8_t h2 = P(P(P(ii + i2) + jj + j2) + kk + k2);
+  const uint8_t h3 = P(P(P(ii + 1) + jj + 1) + kk + 1);
+
+  static constexpr int32_t one = 1 << 14;
+  // squared radius of influence of 0.5 and not the usual 0.6: the contributions vanish before the simplex borders,
+  // there is no discontinuity
+  static constexpr int32_t radius_q28 = 0.5 * (1 << 28);
+  return corner(radius_q28, h0, x0, y0, z0) +
+         corner(radius_q28, h1, x0 - i1 * one + G3_q14, y0 - j1 * one + G3_q14, z0 - k1 * one + G3_q14) +
+         corner(radius_q28,
+                h2,
+                x0 - i2 * one + 2 * G3_q14,
+                y0 - j2 * one + 2 * G3_q14,
+                z0 - k2 * one + 2 * G3_q14) +
+         corner(radius_q28, h3, x0 - one + 3 * G3_q14, y0 - one + 3 * G3_q14, z0 - one + 3 * G3_q14);
+}
+
+/// Raw 2D simplex noise, from 16.16 fixed point coordinates, in Q28
+static int32_t noise_raw(uint32_t x, uint32_t y)
+{
+  // skew the input space to find the simplex cell
+  const int64_t sum = (int64_t)x + y;
+  const int64_t s = (((sum >> 16) * F2_q32) >> 16) + (((sum & 0xFFFF) * F2_q32) >> 32);
+  const uint32_t i = (x + s) >> 16;
+  const uint32_t j = (y + s) >> 16;
+
+  // unskew the cell origin back, and get the offset of the point from it (Q14)
+  const int64_t t = (((int64_t)i + j) * G2_q32) >> 16;
+  const int32_t x0 = (x - ((int64_t)i << 16) + t) >> 2;
+  const int32_t y0 = (y - ((int64_t)j << 16) + t) >> 2;
+
+  // lower or upper triangle of the cell
+  const uint8_t i1 = x0 >= y0 ? 1 : 0;
+  const uint8_t j1 = 1 - i1;
+
+  // hash the 3 corners
+  const uint8_t ii = i;
+  const uint8_t jj = j;
+  const uint8_t h0 = P(P(ii) + jj);
+  const uint8_t h1 = P(P(ii + i1) + jj + j1);
+  const uint8_t h2 = P(P(ii + 1) + jj + 1);
+
+  static constexpr int32_t one = 1 << 14;
+  static constexpr int32_t radius_q28 = 0.5 * (1 << 28);
+  return corner(radius_q28, h0, x0, y0) + corner(radius_q28, h1, x0 - i1 * one + G2_q14, y0 - j1 * one + G2_q14) +
+         corner(radius_q28, h2, x0 - one + 2 * G2_q14, y0 - one + 2 * G2_q14);
+}
+
+/// Rescale a raw simplex noise to the 16 bits output range, with a Q8 gain (measured extremes to the full range)
+template<int32_t gain> static inline uint16_t scale_raw_noise(int32_t raw)
+{
+  return lmpd_constrain<int32_t>(32768 + ((raw >> 8) * gain >> 8), 0, UINT16_MAX);
+}
+
+} // namespace simplex
+
+namespace simplex16 {
+
+uint16_t inoise(uint32_t x, uint32_t y) { return simplex::scale_raw_noise<550>(simplex::noise_raw(x, y)); }
+
+uint16_t inoise(uint32_t x, uint32_t y, uint32_t z)
+{
+  return simplex::scale_raw_noise<600>(simplex::noise_raw(x, y, z));
+}
+
+void inoise(const uint32_t* x, const uint32_t* y, const uint32_t* z, uint16_t* out, uint16_t count)
+{
+  for (uint16_t i = 0; i < count; ++i)
+    out[i] = inoise(x[i], y[i], z[i]);
+}
+
+} // namespace simplex16
+
+namespace simplex8 {
+
+// 8.8 fixed point coordinates are the 16.16 ones, with a lower resolution
+
+uint8_t inoise(uint16_t x, uint16_t y) { return simplex16::inoise((uint32_t)x << 8, (uint32_t)y << 8) >> 8; }
+
+uint8_t inoise(uint16_t x, uint16_t y, uint16_t z)
+{
+  return simplex16::inoise((uint32_t)x << 8, (uint32_t)y << 8, (uint32_t)z << 8) >> 8;
+}
+
+void inoise_grid(uint16_t x,
+                 uint16_t xStep,
+                 uint16_t width,
+                 uint16_t y,
+                 uint16_t yStep,
+                 uint16_t height,
+                 uint16_t z,
+                 uint8_t* out)
+{
+  for (uint16_t row = 0; row < height; ++row, y += yStep)
+  {
+    uint16_t pointX = x;
+    for (uint16_t column = 0; column < width; ++column, pointX += xStep)
+      *out++ = inoise(pointX, y, z);
+  }
+}
+
+} // namespace simplex8
+
 } // namespace lampda
@@ -16,6 +16,17 @@ extern uint8_t inoise(uint16_t x, uint16_t y);
 // 3D perlin noise
 extern uint8_t inoise(uint16_t x, uint16_t y, uint16_t z);
 
+// 3D perlin noise on a regular XY grid at a constant z, written row by row in out (width * height values).
+// Faster than a call per point: lattice hashes are shared by the points of a cell, y and z fades by a row.
+extern void inoise_grid(uint16_t x,
+                        uint16_t xStep,
+                        uint16_t width,
+                        uint16_t y,
+                        uint16_t yStep,
+                        uint16_t height,
+                        uint16_t z,
+                        uint8_t* out);
+
 // 1d perlin noise with octaves
 extern uint8_t inoise_octaves(uint16_t x, uint8_t octaves, int scale, uint16_t time);
 
@@ -32,7 +43,48 @@ extern uint16_t inoise(uint32_t x, uint32_t y);
 // 3D perlin noise
 extern uint16_t inoise(uint32_t x, uint32_t y, uint32_t z);
 
+// 3D perlin noise on a batch of count points, written in out.
+// Lattice hashes are shared by consecutive points of the same cell: order the points so that array neighbors are
+// space neighbors (successive leds of the strip for example).
+extern void inoise(const uint32_t* x, const uint32_t* y, const uint32_t* z, uint16_t* out, uint16_t count);
+
 } // namespace noise16
+
+// Simplex noise: same interface as noise8/noise16, but mixes 3 (2D) or 4 (3D) lattice corners per sample instead of
+// 4 and 8, with fixed point math only. Output values are more evenly spread on the range than the perlin noise.
+
+namespace simplex8 {
+
+// 2D simplex noise
+extern uint8_t inoise(uint16_t x, uint16_t y);
+
+// 3D simplex noise
+extern uint8_t inoise(uint16_t x, uint16_t y, uint16_t z);
+
+// 3D simplex noise on a regular XY grid at a constant z, written row by row in out (width * height values).
+extern void inoise_grid(uint16_t x,
+                        uint16_t xStep,
+                        uint16_t width,
+                        uint16_t y,
+                        uint16_t yStep,
+                        uint16_t height,
+                        uint16_t z,
+                        uint8_t* out);
+
+} // namespace simplex8
+
+namespace simplex16 {
+
+// 2D simplex noise
+extern uint16_t inoise(uint32_t x, uint32_t y);
+
+// 3D simplex noise
+extern uint16_t inoise(uint32_t x, uint32_t y, uint32_t z);
+
+// 3D simplex noise on a batch of count points, written in out.
+extern void inoise(const uint32_t* x, const uint32_t* y, const uint32_t* z, uint16_t* out, uint16_t count);
+
+} // namespace simplex16
 } // namespace lampda
 
 #endif
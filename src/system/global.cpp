@@ -248,6 +248,9 @@ void main_loop(const uint32_t addedDelay)
   // loop the behavior
   logic::behavior::loop();
 
+  // the modes are done with this sound frame
+  component::microphone::release_sound_frame();
+
   // automatically deactivate sensors if they are not used for a time
   component::microphone::disable_after_non_use();
 }
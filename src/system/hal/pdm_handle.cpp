@@ -3,8 +3,10 @@
 
 #include "pdm_handle.h"
 #include "src/system/hal/time.h"
+#include "src/system/hal/threads.h"
 
 #include "src/system/utils/fft.h"
+#include "src/system/utils/spsc_queue.h"
 
 #include <PDM.h>
 
@@ -12,55 +14,70 @@ namespace lampda {
 namespace hal {
 namespace microphone {
 
-PdmData lastData;
+/// Captures waiting for the audio analysis, in order: the interrupt writes the next one in place, and never in a
+/// capture being read. When the analysis is late by more than the queue, the new captures are dropped.
+utils::SpscQueue<PdmData, 4> captures;
+/// time of the previous capture
+uint64_t lastCaptureTime_us = 0;
+/// sequence number of the latest capture, dropped or not. Written by the interrupt only
+uint32_t latestSequenceNumber = 0;
+
+/// event sent to the audio task on each capture
+static constexpr int newCaptureEvent = (1 << 1);
 
 // callback every time the microphone reads data
 // LEAVE THIS FUNCTION CLEAN, IT'S AN INTERRUPT CALLBACK
 void on_PDM_data()
 {
-  lastData.sampleRead = 0;
-  const auto newTime = hal::time_us();
+  const uint32_t sequenceNumber = ++latestSequenceNumber;
+  PdmData* nextCapture = captures.write_slot();
+  if (nextCapture == nullptr)
+  {
+    // the analysis is late: empty the microphone buffer, the analysis sees the gap in the sequence numbers
+    int16_t dropped[16];
+    while (PDM.read((char*)dropped, sizeof(dropped)) > 0)
+    {
+    }
+    lastCaptureTime_us = hal::time_us();
+    return;
+  }
+  PdmData& capture = *nextCapture;
 
-  lastData.sampleDuration_us = newTime - lastData.sampleTime_us;
-  lastData.sampleTime_us = newTime;
+  const auto newTime = hal::time_us();
+  capture.sampleDuration_us = newTime - lastCaptureTime_us;
+  capture.sampleTime_us = newTime;
+  lastCaptureTime_us = newTime;
 
   // read into the sample buffer. We cast cast our array as an 8bit array of twice the size
   const size_t dataCnt = PDM.available();
   const size_t pdmCnt = min(PdmData::SAMPLE_SIZE * 2, dataCnt);
-  const int bytesRead = PDM.read((char*)&lastData.data[0], pdmCnt);
+  const int bytesRead = PDM.read((char*)&capture.data[0], pdmCnt);
 
   // number of samples read
-  lastData.sampleRead = min(PdmData::SAMPLE_SIZE, bytesRead / 2);
+  capture.sampleRead = min(PdmData::SAMPLE_SIZE, bytesRead / 2);
+  capture.sequenceNumber = sequenceNumber;
+
+  // publish the complete capture
+  captures.commit();
+
+  // wake up the audio analysis
+  threads::notify_thread(threads::audio_taskName, newCaptureEvent);
 }
 
 namespace _private {
 
 PdmData get()
 {
+  // the oldest capture not analyzed yet
   PdmData copy;
-  copy.sampleDuration_us = lastData.sampleDuration_us;
-  copy.sampleTime_us = lastData.sampleTime_us;
-  copy.sampleRead = lastData.sampleRead;
+  if (not captures.pop(copy) or not copy.is_valid())
+    return {};
 
-  float mean = 0.0f;
-  for (size_t i = 0; i < copy.sampleRead; i++)
-  {
-    // add a fake gain (thick plastic body)
-    const auto d = lastData.data[i];
-    mean += d;
-    copy.data[i] = d;
-  }
+  // the DC component is removed by the sound analysis, with the auto gain
   for (size_t i = copy.sampleRead; i < PdmData::SAMPLE_SIZE; i++)
   {
     copy.data[i] = 0;
   }
-  mean /= static_cast<float>(copy.sampleRead);
-
-  // adjust dc voltage offset
-  for (size_t i = 0; i < copy.sampleRead; i++)
-  {
-    copy.data[i] -= mean;
-  }
 
   return copy;
 }
@@ -22,8 +22,8 @@ static constexpr int16_t gainUpdateBaseline = 80;
  */
 struct PdmData
 {
-  /// Size of the sound sample
-  static constexpr uint16_t SAMPLE_SIZE = 512;
+  /// Size of the sound sample: 8ms of sound, the analysis runs on every capture
+  static constexpr uint16_t SAMPLE_SIZE = 128;
   /// raw audio data buffer
   std::array<int16_t, SAMPLE_SIZE> data;
   /// duration of the sample in microseconds
@@ -33,12 +33,15 @@ struct PdmData
 
   /// number of sound sample in array. Will be <= SAMPLE_SIZE
   uint16_t sampleRead = 0;
+  /// index of this capture, incremented at every new capture. 0 for no capture
+  uint32_t sequenceNumber = 0;
   /// if this is false, all the data are garbage
   bool is_valid() const { return sampleRead > 0; }
 };
 
 namespace _private {
 
+// return the oldest capture not returned yet, the captures are returned in order. Not valid if there is none
 PdmData get();
 
 // start the microphone readings
@@ -24,6 +24,7 @@ const uint32_t taskScheduler_taskName = utils::hash("task_sched");
 const uint32_t sunset_taskName = utils::hash("sunset");
 const uint32_t ble_cli_taskName = utils::hash("ble_cli");
 const uint32_t print_taskName = utils::hash("print");
+const uint32_t audio_taskName = utils::hash("audio");
 
 const char* const get_name_from_hash(const uint32_t hash)
 {
@@ -47,6 +48,8 @@ const char* const get_name_from_hash(const uint32_t hash)
       return "ble_cli";
     case print_taskName:
       return "print";
+    case audio_taskName:
+      return "audio";
     default:
       break;
   }
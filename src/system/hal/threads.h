@@ -39,6 +39,8 @@ extern "C" {
   extern const uint32_t ble_cli_taskName;
   /// UART print task
   extern const uint32_t print_taskName;
+  /// microphone analysis task
+  extern const uint32_t audio_taskName;
 
   /// model of a task function
   typedef void (*taskfunc_t)(void);
@@ -0,0 +1,202 @@
+/*! \file audio_front_end.h
+    \brief Integer processing of the microphone captures: DC blocking, auto gain and sound levels.
+
+    The front end runs on every capture, before the FFT. It only uses integer operations, in a single pass over the
+    samples: on the microcontroller, the multiplications accumulate in 64 bits in one instruction, where the float
+    version of the auto gain had a dependency chain of float operations on every sample.
+*/
+
+#ifndef UTILS_AUDIO_FRONT_END_H
+#define UTILS_AUDIO_FRONT_END_H
+
+#include <cstdint>
+
+#include "src/system/utils/fft.h"
+
+namespace lampda {
+namespace utils {
+namespace audio {
+
+/// Number of intervals in the logarithm table
+static constexpr uint16_t log2TableSize = 32;
+
+/// log2(1 + i / log2TableSize) * 65536, for i in [0, log2TableSize]
+inline constexpr uint32_t log2Table[log2TableSize + 1] = {
+        0,     2909,  5732,  8473,  11136, 13727, 16248, 18704, 21098, 23433, 25711,
+        27936, 30109, 32234, 34312, 36346, 38336, 40286, 42196, 44068, 45904, 47705,
+        49472, 51207, 52911, 54584, 56229, 57845, 59434, 60997, 62534, 64047, 65536};
+
+/**
+ * \brief Base 2 logarithm of an integer, with a linear interpolation of the table
+ * \param[in] value The value, 0 is handled as 1
+ * \return log2(value) in 1/65536, with an absolute error of at most 12 (in 1/65536)
+ */
+inline constexpr uint32_t log2_q16(const uint32_t value)
+{
+  if (value <= 1)
+    return 0;
+
+  // integer part from the highest bit, then 5 bits of table index and 16 bits of interpolation
+  const uint32_t highestBit = 31 - __builtin_clz(value);
+  const uint32_t mantissa = (value << (31 - highestBit)) & 0x7FFFFFFF;
+  const uint32_t index = mantissa >> 26;
+  const uint32_t position = (mantissa >> 10) & 0xFFFF;
+
+  const uint32_t low = log2Table[index];
+  return (highestBit << 16) + low + (((log2Table[index + 1] - low) * position + (1 << 15)) >> 16);
+}
+
+/**
+ * \brief Amplitude of a value in decibels: 20 * log10(value)
+ * \param[in] value The value, 0 is handled as 1
+ * \return the level, in 1/256 decibel
+ */
+inline constexpr int32_t amplitude_to_decibels_q8(const uint32_t value)
+{
+  // 20 * log10(2) in 1/65536 decibel
+  constexpr int64_t decibelsPerOctave_q16 = 394566;
+  return (log2_q16(value) * decibelsPerOctave_q16 + (1 << 23)) >> 24;
+}
+
+/**
+ * \brief One pole DC blocker.
+ * The output is the input minus its running average, with a time constant of 2^shift samples: a first order high pass
+ * filter, with a cutoff around 10Hz. The average is kept with the fractional bits of the shift, so that it has no
+ * rounding bias.
+ */
+class DcBlocker
+{
+public:
+  /// time constant of the average, in samples: ~15ms
+  static constexpr uint8_t shift = fft::SAMPLE_RATE > 32000 ? 9 : 8;
+
+  void reset() { isPrimed = false; }
+
+  /// Start the running average from the average of the first samples, to avoid a long transient
+  void prime(const int16_t* samples, const uint16_t count)
+  {
+    int32_t sum = 0;
+    for (uint16_t i = 0; i < count; ++i)
+      sum += samples[i];
+    average = (static_cast<int64_t>(sum) << shift) / count;
+    isPrimed = true;
+  }
+
+  bool is_primed() const { return isPrimed; }
+
+  /// Filter a sample
+  inline int16_t filter(const int16_t sample)
+  {
+    average += sample - ((average + (1 << (shift - 1))) >> shift);
+    const int32_t output = sample - ((average + (1 << (shift - 1))) >> shift);
+    return output > INT16_MAX ? INT16_MAX : (output < INT16_MIN ? INT16_MIN : output);
+  }
+
+private:
+  /// running average, in 1/2^shift
+  int32_t average = 0;
+  bool isPrimed = false;
+};
+
+/**
+ * \brief Fixed point front end of the microphone captures.
+ *
+ * In a single pass over a capture, the samples are DC blocked, multiplied by the auto gain, and the level of the input
+ * and the power of the output are accumulated. The gain is then updated once per capture:
+ * - above the gate level, the gain converges to the target output RMS. The per sample update of the float version,
+ *   gain *= 1 + rate * (1 - output^2 / target^2), is accumulated over the capture. The rate is small, so the product
+ *   is the sum of the updates (the difference is below rate^2 * samples^2).
+ * - below the gate level, the gain goes back to 1.
+ *
+ * The gain is in Q8.24: from 0.0001 to 30 with more than 10 bits of precision.
+ *
+ * \param[in] gateLevel Average absolute level of the capture above which the gain adapts
+ * \param[in] targetRms Target RMS of the gained samples
+ */
+template<int16_t gateLevel, int16_t targetRms> class AutoGainFrontEnd
+{
+public:
+  static constexpr uint8_t gainShift = 24;
+  static constexpr int32_t unitGain = 1 << gainShift;
+  static constexpr int32_t minGain = 0.0001 * unitGain;
+  static constexpr int32_t maxGain = 30.0 * unitGain;
+
+  /// reactivity of the gain, per sample (in 1/2^32)
+  static constexpr int64_t adaptationRate_q32 = 0.00005 * 4294967296.0 + 0.5;
+  /// return of the gain to 1 below the gate level, per sample (in 1/2^24)
+  static constexpr int64_t restoreRate_q24 = 0.1 / 512.0 * unitGain + 0.5;
+  /// the gain is at most halved by a capture
+  static constexpr int64_t minGainUpdate_q32 = -(int64_t(1) << 31);
+
+  static constexpr int64_t targetPower = static_cast<int64_t>(targetRms) * targetRms;
+
+  void reset()
+  {
+    dcBlocker.reset();
+    gain = unitGain;
+  }
+
+  /**
+   * \brief Process a capture
+   * \param[in] input Samples of the capture
+   * \param[in] count Number of samples
+   * \param[out] blocked Input samples, without the DC component
+   * \param[out] gained Blocked samples, with the auto gain
+   */
+  void process(const int16_t* input, const uint16_t count, int16_t* blocked, int16_t* gained)
+  {
+    if (count == 0)
+      return;
+    if (not dcBlocker.is_primed())
+      dcBlocker.prime(input, count);
+
+    uint32_t absoluteSum = 0;
+    int64_t powerSum = 0;
+    for (uint16_t i = 0; i < count; ++i)
+    {
+      const int16_t sample = dcBlocker.filter(input[i]);
+      blocked[i] = sample;
+      absoluteSum += sample < 0 ? -sample : sample;
+
+      // the gain target uses the output before saturation
+      const int32_t output = (static_cast<int64_t>(sample) * gain) >> gainShift;
+      powerSum += static_cast<int64_t>(output) * output;
+      gained[i] = output > INT16_MAX ? INT16_MAX : (output < INT16_MIN ? INT16_MIN : output);
+    }
+
+    if (absoluteSum > static_cast<uint32_t>(gateLevel) * count)
+    {
+      // sum of (1 - output^2 / target^2), in 1/256
+      const int64_t error_q8 = (static_cast<int64_t>(count) << 8) - (powerSum << 8) / targetPower;
+      int64_t update_q32 = (adaptationRate_q32 * error_q8) >> 8;
+      if (update_q32 < minGainUpdate_q32)
+        update_q32 = minGainUpdate_q32;
+      gain += (static_cast<int64_t>(gain) * update_q32) >> 32;
+    }
+    else
+    {
+      gain -= (static_cast<int64_t>(gain - unitGain) * restoreRate_q24 * count) >> gainShift;
+    }
+    gain = gain < minGain ? minGain : (gain > maxGain ? maxGain : gain);
+
+    averageLevel = absoluteSum / count;
+  }
+
+  /// Gain applied to the next capture
+  float get_gain() const { return gain / static_cast<float>(unitGain); }
+  /// Gain applied to the next capture, in 1/2^24
+  int32_t get_gain_q24() const { return gain; }
+  /// Average absolute level of the last capture, without DC
+  uint16_t get_average_level() const { return averageLevel; }
+
+private:
+  DcBlocker dcBlocker;
+  int32_t gain = unitGain;
+  uint16_t averageLevel = 0;
+};
+
+} // namespace audio
+} // namespace utils
+} // namespace lampda
+
+#endif
@@ -8,7 +8,10 @@
 #include "src/system/utils/utils.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstddef>
+#include <type_traits>
 #include <vector>
 
 namespace lampda {
@@ -112,8 +115,178 @@ private:
   std::vector<point_t> pts;
 };
 
+/**
+ * \brief Fixed size linear curve, that can be built and sampled at compile time.
+ * Points are stored in a std::array (no heap use), and sampling uses a binary search on the segments.
+ * Prefer this over \ref LinearCurve when the points are known at compile time.
+ * \param[in] T Type of X coordinates
+ * \param[in] U type of Y coordinates
+ * \param[in] N number of points in the curve
+ */
+template<typename T, typename U, size_t N> class StaticLinearCurve
+{
+  static_assert(N >= 2, "Linear curve must have more than 1 points");
+
+public:
+  /// point in the linear curve
+  using point_t = Point<T, U>;
+
+  /// Build a curve from a set of points, in any order
+  constexpr StaticLinearCurve(const std::array<point_t, N>& points) : pts(points)
+  {
+    // sort by the x coordinate (insertion sort, std::sort is not constexpr in C++17)
+    for (size_t i = 1; i < N; ++i)
+    {
+      const point_t p = pts[i];
+      size_t j = i;
+      for (; j > 0 and p.x < pts[j - 1].x; --j)
+        pts[j] = pts[j - 1];
+      pts[j] = p;
+    }
+
+    for (size_t i = 0; i < N; ++i)
+    {
+      // (x != x) is a constexpr nan check
+      assert(pts[i].x == pts[i].x && pts[i].y == pts[i].y && "invalid value in curve parameters");
+      assert((i == 0 or pts[i - 1].x < pts[i].x) && "Linear curve points must have distinct x coordinates");
+    }
+  }
+
+  /// Sample a point Y from a given x
+  constexpr U sample(const T x) const
+  {
+    // bounds failure
+    if (x != x or x <= pts[0].x)
+      return pts[0].y;
+    if (x >= pts[N - 1].x)
+      return pts[N - 1].y;
+
+    // find the segment [lo, hi] that contains x
+    size_t lo = 0;
+    size_t hi = N - 1;
+    while (hi - lo > 1)
+    {
+      const size_t mid = (lo + hi) >> 1;
+      if (x < pts[mid].x)
+        hi = mid;
+      else
+        lo = mid;
+    }
+
+    // same operation order as lmpd_map, for identical results with LinearCurve
+    const point_t& a = pts[lo];
+    const point_t& b = pts[hi];
+    return static_cast<U>((static_cast<float>(b.y) - static_cast<float>(a.y)) *
+                                  (static_cast<float>(x) - static_cast<float>(a.x)) /
+                                  (static_cast<float>(b.x) - static_cast<float>(a.x)) +
+                          static_cast<float>(a.y));
+  }
+
+  /// lowest x coordinate of the curve
+  constexpr T min_x() const { return pts[0].x; }
+  /// highest x coordinate of the curve
+  constexpr T max_x() const { return pts[N - 1].x; }
+
+private:
+  /// sorted end points of the linear segments
+  std::array<point_t, N> pts;
+};
+
+/**
+ * \brief Build a \ref StaticLinearCurve without counting the points manually
+ * \param[in] points Points of the curve, in any order
+ */
+template<typename T, typename U, typename... Points>
+static constexpr StaticLinearCurve<T, U, sizeof...(Points)> make_linear_curve(const Points&... points)
+{
+  return StaticLinearCurve<T, U, sizeof...(Points)>(std::array<Point<T, U>, sizeof...(Points)> {points...});
+}
+
+/**
+ * \brief Curve baked in a lookup table of uniformly spaced samples.
+ * Sampling is a single table access and a linear interpolation between two neighbors, in integer math when the
+ * coordinates are integers. Can be built at compile time from a constexpr curve, or once at startup from any curve
+ * (\ref ExponentialCurve for example), to remove the costly sampling from the hot paths.
+ * \param[in] T Type of X coordinates
+ * \param[in] U type of Y coordinates
+ * \param[in] lutSize number of samples in the table
+ */
+template<typename T, typename U, uint16_t lutSize> class UniformLutCurve
+{
+  static_assert(lutSize >= 2, "Lookup table must have more than 1 points");
+
+public:
+  /**
+   * \brief Sample a curve uniformly between two bounds
+   * \param[in] curve The curve to sample, must have a sample(T) method
+   * \param[in] xMin Lower bound of the table
+   * \param[in] xMax Upper bound of the table. For integer types, (xMax - xMin) must be a multiple of (lutSize - 1)
+   */
+  template<typename CurveTy>
+  constexpr UniformLutCurve(const CurveTy& curve, const T xMin, const T xMax) :
+    minX(xMin),
+    maxX(xMax),
+    step((xMax - xMin) / static_cast<T>(lutSize - 1)),
+    lut {}
+  {
+    assert(xMin < xMax && "invalid lookup table bounds");
+    if constexpr (std::is_integral_v<T>)
+    {
+      assert((xMax - xMin) % (lutSize - 1) == 0 && "lookup table range must be a multiple of its size");
+      assert(step < (1 << 15) && "lookup table step is too large");
+    }
+
+    for (uint16_t i = 0; i < lutSize; ++i)
+    {
+      const auto y = curve.sample(static_cast<T>(minX + step * i));
+      // round floating results on integer tables
+      if constexpr (std::is_integral_v<U> and std::is_floating_point_v<decltype(y)>)
+        lut[i] = static_cast<U>(y < 0 ? y - 0.5f : y + 0.5f);
+      else
+        lut[i] = static_cast<U>(y);
+    }
+  }
+
+  /// Sample a point Y from a given x
+  constexpr U sample(const T x) const
+  {
+    // bounds failure
+    if (x != x or x <= minX)
+      return lut[0];
+    if (x >= maxX)
+      return lut[lutSize - 1];
+
+    if constexpr (std::is_integral_v<T> and std::is_integral_v<U>)
+    {
+      using wide_t = std::conditional_t<(sizeof(U) > 2), int64_t, int32_t>;
+      const auto offset = x - minX;
+      const uint16_t index = offset / step;
+      const wide_t remainder = offset % step;
+      return static_cast<U>(lut[index] + (static_cast<wide_t>(lut[index + 1]) - lut[index]) * remainder / step);
+    }
+    else
+    {
+      const float position = static_cast<float>(x - minX) / static_cast<float>(step);
+      const uint16_t index = static_cast<uint16_t>(position);
+      const float fraction = position - index;
+      return static_cast<U>(lut[index] + (static_cast<float>(lut[index + 1]) - lut[index]) * fraction);
+    }
+  }
+
+private:
+  /// lower bound of the X coordinates
+  T minX;
+  /// upper bound of the X coordinates
+  T maxX;
+  /// X distance between two samples
+  T step;
+  /// uniformly spaced samples
+  std::array<U, lutSize> lut;
+};
+
 /**
  * \brief Given two points and an exponent, fit an exponential function
+ * Sampling uses double precision math: bake it in a \ref UniformLutCurve for hot paths.
  * \param[in] T Type of X coordinates
  * \param[in] U type of Y coordinates
  */
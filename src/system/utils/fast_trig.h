@@ -0,0 +1,234 @@
+/*! \file fast_trig.h
+    \brief Fast trigonometry, from interpolated lookup tables.
+
+    The float library trigonometry (sinf, cosf, atan2f) are long software routines on the microcontroller, even with
+    the floating point unit. Those functions replace them on hot paths (particles, geometry), with bounded errors:
+    - sin, cos: absolute error below 2.5e-5, for angles in [-50, 50] radians (then the float angle precision adds up)
+    - sin_q15, cos_q15: absolute error below 2 (in 1/32767)
+    - atan2: absolute error below 3e-5 radians
+    - atan2_q16: absolute error below 1 (in 1/65536 turn)
+    - isqrt: exact (rounded down)
+
+    Float square roots are a single instruction of the floating point unit, and should still use sqrtf.
+*/
+
+#ifndef UTILS_FAST_TRIG_H
+#define UTILS_FAST_TRIG_H
+
+#include <cstdint>
+
+#include "src/user/constants.h"
+
+namespace lampda {
+namespace trig {
+
+/// Number of intervals in the sine table, for a quarter turn
+static constexpr uint16_t sineTableSize = 256;
+/// Number of intervals in the arctangent table, for ratios in [0, 1]
+static constexpr uint16_t arctanTableSize = 256;
+
+/// sin(i / sineTableSize * pi / 2) * 65535, for i in [0, sineTableSize]
+inline constexpr uint16_t sineQuarterTable[sineTableSize + 1] = {
+        0, 402, 804, 1206, 1608, 2010, 2412, 2814, 3216, 3617, 4019, 4420, 4821, 5222, 5623, 6023, 6424, 6824, 7223,
+        7623, 8022, 8421, 8820, 9218, 9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391, 12785, 13179, 13573, 13966,
+        14359, 14751, 15142, 15533, 15924, 16313, 16703, 17091, 17479, 17866, 18253, 18639, 19024, 19408, 19792, 20175,
+        20557, 20939, 21319, 21699, 22078, 22456, 22834, 23210, 23586, 23960, 24334, 24707, 25079, 25450, 25820, 26189,
+        26557, 26925, 27291, 27656, 28020, 28383, 28745, 29106, 29465, 29824, 30181, 30538, 30893, 31247, 31600, 31952,
+        32302, 32651, 32999, 33346, 33692, 34036, 34379, 34721, 35061, 35400, 35738, 36074, 36409, 36743, 37075, 37406,
+        37736, 38064, 38390, 38715, 39039, 39361, 39682, 40001, 40319, 40635, 40950, 41263, 41575, 41885, 42194, 42500,
+        42806, 43109, 43411, 43712, 44011, 44308, 44603, 44897, 45189, 45479, 45768, 46055, 46340, 46624, 46905, 47185,
+        47464, 47740, 48014, 48287, 48558, 48827, 49095, 49360, 49624, 49885, 50145, 50403, 50659, 50913, 51166, 51416,
+        51664, 51911, 52155, 52398, 52638, 52877, 53113, 53348, 53580, 53811, 54039, 54266, 54490, 54713, 54933, 55151,
+        55367, 55582, 55794, 56003, 56211, 56417, 56620, 56822, 57021, 57218, 57413, 57606, 57797, 57985, 58171, 58356,
+        58537, 58717, 58895, 59070, 59243, 59414, 59582, 59749, 59913, 60075, 60234, 60391, 60546, 60699, 60850, 60998,
+        61144, 61287, 61429, 61567, 61704, 61838, 61970, 62100, 62227, 62352, 62475, 62595, 62713, 62829, 62942, 63053,
+        63161, 63267, 63371, 63472, 63571, 63668, 63762, 63853, 63943, 64030, 64114, 64196, 64276, 64353, 64428, 64500,
+        64570, 64638, 64703, 64765, 64826, 64883, 64939, 64992, 65042, 65090, 65136, 65179, 65219, 65258, 65293, 65327,
+        65357, 65386, 65412, 65435, 65456, 65475, 65491, 65504, 65515, 65524, 65530, 65534, 65535};
+
+/// atan(i / arctanTableSize) in 1/2^18 turns, for i in [0, arctanTableSize]
+inline constexpr uint16_t arctanTable[arctanTableSize + 1] = {
+        0, 163, 326, 489, 652, 815, 978, 1141, 1303, 1466, 1629, 1792, 1954, 2117, 2279, 2442, 2604, 2767, 2929, 3091,
+        3253, 3415, 3577, 3738, 3900, 4061, 4223, 4384, 4545, 4706, 4867, 5028, 5188, 5349, 5509, 5669, 5829, 5989,
+        6148, 6308, 6467, 6626, 6784, 6943, 7101, 7260, 7418, 7575, 7733, 7890, 8047, 8204, 8361, 8517, 8673, 8829,
+        8985, 9140, 9296, 9450, 9605, 9759, 9914, 10067, 10221, 10374, 10527, 10680, 10832, 10984, 11136, 11287, 11439,
+        11590, 11740, 11890, 12040, 12190, 12339, 12488, 12637, 12785, 12933, 13081, 13228, 13375, 13522, 13668, 13814,
+        13959, 14105, 14249, 14394, 14538, 14682, 14825, 14968, 15111, 15253, 15395, 15537, 15678, 15819, 15960, 16100,
+        16239, 16379, 16518, 16656, 16794, 16932, 17069, 17206, 17343, 17479, 17615, 17750, 17885, 18020, 18154, 18288,
+        18421, 18554, 18687, 18819, 18951, 19083, 19213, 19344, 19474, 19604, 19733, 19862, 19991, 20119, 20247, 20374,
+        20501, 20627, 20753, 20879, 21004, 21129, 21254, 21378, 21501, 21624, 21747, 21870, 21992, 22113, 22234, 22355,
+        22475, 22595, 22714, 22834, 22952, 23070, 23188, 23306, 23423, 23539, 23655, 23771, 23886, 24001, 24116, 24230,
+        24344, 24457, 24570, 24682, 24795, 24906, 25017, 25128, 25239, 25349, 25459, 25568, 25677, 25785, 25893, 26001,
+        26108, 26215, 26321, 26427, 26533, 26638, 26743, 26848, 26952, 27056, 27159, 27262, 27364, 27467, 27568, 27670,
+        27771, 27871, 27972, 28072, 28171, 28270, 28369, 28467, 28565, 28663, 28760, 28857, 28953, 29050, 29145, 29241,
+        29336, 29430, 29525, 29619, 29712, 29805, 29898, 29991, 30083, 30175, 30266, 30357, 30448, 30538, 30628, 30718,
+        30807, 30896, 30985, 31073, 31161, 31248, 31336, 31423, 31509, 31595, 31681, 31767, 31852, 31937, 32022, 32106,
+        32190, 32273, 32357, 32439, 32522, 32604, 32686, 32768};
+
+/**
+ * \brief Sine of an angle in turns, with a linear interpolation of the quarter wave table
+ * \param[in] angle_q24 Angle in 1/2^24 turns (the higher bits, full turns, are ignored)
+ * \return the sine, in 1/65535 (in [-65535, 65535])
+ */
+inline constexpr int32_t sin_turn_q24(const uint32_t angle_q24)
+{
+  // 2 bits of quadrant, 8 bits of table index, 14 bits of interpolation
+  const uint32_t quadrant = (angle_q24 >> 22) & 3;
+  uint32_t position = angle_q24 & 0x3FFFFF;
+  // the second half of each half turn is the mirror of the first one
+  if (quadrant & 1)
+    position = 0x400000 - position;
+
+  const uint32_t index = position >> 14;
+  int32_t value = 0;
+  if (index >= sineTableSize)
+  {
+    value = sineQuarterTable[sineTableSize];
+  }
+  else
+  {
+    const int32_t low = sineQuarterTable[index];
+    value = low + (((sineQuarterTable[index + 1] - low) * static_cast<int32_t>(position & 0x3FFF) + (1 << 13)) >> 14);
+  }
+  return (quadrant & 2) ? -value : value;
+}
+
+/**
+ * \brief Convert an angle in radians to an angle in 1/2^24 turns
+ * The full turns are dropped before the conversion, any angle of less than 2^31 turns is valid (negative angles are
+ * wrapped). The precision is the one of the float angle.
+ */
+inline constexpr uint32_t to_turn_q24(const float angle_rad)
+{
+  const float turns = angle_rad * (1.0f / c_TWO_PI);
+  // the integer part of a float is exact, so is the fraction of turn
+  const float turnFraction = turns - static_cast<float>(static_cast<int32_t>(turns));
+  return static_cast<int32_t>(turnFraction * (1 << 24));
+}
+
+/// Fast sine of a float angle, in radians
+inline constexpr float sin(const float angle_rad)
+{
+  return sin_turn_q24(to_turn_q24(angle_rad)) * (1.0f / 65535.0f);
+}
+
+/// Fast cosine of a float angle, in radians
+inline constexpr float cos(const float angle_rad)
+{
+  return sin_turn_q24(to_turn_q24(angle_rad) + (1 << 22)) * (1.0f / 65535.0f);
+}
+
+/// Fast sine of a 16 bits angle (65536 is a full turn), in 1/32767
+inline constexpr int16_t sin_q15(const uint16_t angle)
+{
+  return sin_turn_q24(static_cast<uint32_t>(angle) << 8) / 2;
+}
+
+/// Fast cosine of a 16 bits angle (65536 is a full turn), in 1/32767
+inline constexpr int16_t cos_q15(const uint16_t angle) { return sin_q15(angle + 16384); }
+
+/**
+ * \brief Arctangent of a ratio in [0, 1], from the interpolated table
+ * \param[in] ratio_q16 The ratio in 1/65536, in [0, 65536]
+ * \return The angle, in 1/2^18 turn (in [0, 32768])
+ */
+inline constexpr uint32_t arctan_unit_q18(const uint32_t ratio_q16)
+{
+  const uint32_t index = ratio_q16 >> 8;
+  if (index >= arctanTableSize)
+    return arctanTable[arctanTableSize];
+
+  const uint32_t low = arctanTable[index];
+  return low + (((arctanTable[index + 1] - low) * (ratio_q16 & 0xFF) + (1 << 7)) >> 8);
+}
+
+/**
+ * \brief Fast arctangent of y/x, using the signs of the parameters to find the quadrant
+ * \return An angle in 1/65536 turn (wraps, as 16 bits angles)
+ */
+inline constexpr uint16_t atan2_q16(const int32_t y, const int32_t x)
+{
+  const uint32_t ax = x < 0 ? -static_cast<uint32_t>(x) : x;
+  const uint32_t ay = y < 0 ? -static_cast<uint32_t>(y) : y;
+  if (ax == 0 and ay == 0)
+    return 0;
+
+  // reduce to the first octant, in 1/2^18 turns
+  uint32_t angle = 0;
+  if (ay <= ax)
+    angle = arctan_unit_q18((static_cast<uint64_t>(ay) << 16) / ax);
+  else
+    angle = (1 << 16) - arctan_unit_q18((static_cast<uint64_t>(ax) << 16) / ay);
+  if (x < 0)
+    angle = (1 << 17) - angle;
+  if (y < 0)
+    angle = -angle;
+  return (angle + 2) >> 2;
+}
+
+/// Conversion of the arctangent table values to radians
+static constexpr float arctanUnitToRadians = c_TWO_PI / (1 << 18);
+
+/// Arctangent of a ratio in [0, 1], from the table interpolated in float, in radians
+inline constexpr float arctan_unit(const float ratio)
+{
+  const float position = ratio * arctanTableSize;
+  const uint32_t index = static_cast<uint32_t>(position);
+  if (index >= arctanTableSize)
+    return arctanTable[arctanTableSize] * arctanUnitToRadians;
+
+  const float low = arctanTable[index];
+  return (low + (arctanTable[index + 1] - low) * (position - index)) * arctanUnitToRadians;
+}
+
+/**
+ * \brief Fast arctangent of y/x, using the signs of the parameters to find the quadrant
+ * \return an angle in radians, in [-pi, pi], as std::atan2
+ */
+inline constexpr float atan2(const float y, const float x)
+{
+  const float ax = x < 0 ? -x : x;
+  const float ay = y < 0 ? -y : y;
+  if (ax == 0 and ay == 0)
+    return 0.0f;
+
+  // reduce to the first octant
+  float angle = 0.0f;
+  if (ay <= ax)
+    angle = arctan_unit(ay / ax);
+  else
+    angle = c_HALF_PI - arctan_unit(ax / ay);
+  if (x < 0)
+    angle = c_PI - angle;
+  return y < 0 ? -angle : angle;
+}
+
+/// Integer square root, rounded down
+inline constexpr uint16_t isqrt(uint32_t value)
+{
+  uint32_t result = 0;
+  // highest power of four below 2^32
+  uint32_t bit = 1UL << 30;
+  while (bit > value)
+    bit >>= 2;
+
+  while (bit != 0)
+  {
+    if (value >= result + bit)
+    {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    }
+    else
+    {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return result;
+}
+
+} // namespace trig
+} // namespace lampda
+
+#endif
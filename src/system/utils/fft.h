@@ -1,5 +1,5 @@
 /*! \file fft.h
-    \brief Wrapper of the ArduinoFFT library.
+    \brief Frequency analysis of the microphone data.
 */
 
 #pragma once
@@ -7,11 +7,10 @@
 #include <array>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 
-#define FFT_SQRT_APPROXIMATION
-#define FFT_SPEED_OVER_PRECISION
-#include "src/depends/arduinoFFT/src/arduinoFFT.h"
-
+#include "src/system/utils/filterbank.h"
+#include "src/system/utils/real_fft.h"
 #include "src/system/utils/utils.h"
 
 namespace lampda {
@@ -24,87 +23,41 @@ constexpr int SAMPLE_RATE = 16000; ///< Base sample rate in Hz - standard.
  * \brief Wrapper class for the FFT implementation
  * \param[in] samplesFFT Is the input frequency bins before analysis
  * \param[in] resultSize Is the resulting frequency bins after analysis
+ * \param[in] window Window applied to the samples. Rectangle reduces frequency response distortion.
+ * \param[in] weighting Frequency weighting of the logarithmic bins
  */
-template<uint16_t samplesFFT, uint16_t resultSize, typename T = float> class FftAnalyzer
+template<uint16_t samplesFFT,
+         uint16_t resultSize,
+         typename T = float,
+         Window window = Window::Rectangle,
+         Weighting weighting = Weighting::None>
+class FftAnalyzer
 {
   static_assert(samplesFFT > 0 && (samplesFFT & (samplesFFT - 1)) == 0, "samplesFFT must be a power of two");
   static constexpr uint16_t samplesFFTRes = samplesFFT >> 1;
   /// output variables
 public:
   std::array<T, samplesFFTRes> fftBin; //.< raw fft results
-  std::array<T, resultSize> fftLog;    ///< fft result as a log scale
+  std::array<T, resultSize> fftLog;    ///< weighted amplitude of the frequencies of each logarithmic bin
+  T totalAmplitude;                    ///< weighted amplitude of all the frequencies
   T maxMagnitude;                      ///< maximum detected frequency magnitude
   T maxFrequency;                      ///< maximum detected frequency, in Hertz
 
 private:
-  /// use this to convert bins to frequencies
-  std::array<T, resultSize + 1> minFrequenciesPerBin_log;
-
-  /// map fft index to log index
-  std::array<uint16_t, samplesFFTRes> _numSamplesPerBar_log;
-  /// Type of the FFT windows. Rectangle reduces frequency response distortion.
-  const FFTWindow fftWindowing = FFTWindow::Rectangle;
-  T windowSum = 0.0; ///< computed window sum
-
-  /// FFT entry/exit point: microphone raw values, and fft values
-  T vReal[samplesFFT];
-  /// FFT exit point: imaginary part of the FFT.
-  T vImag[samplesFFT];
-  /// ArduinoFFT object
-  ArduinoFFT<T> FFT = ArduinoFFT<T>(vReal, vImag, samplesFFT, SAMPLE_RATE, true);
+  /// map fft bins to log bins
+  using FilterbankTy = LogFilterbank<samplesFFT, SAMPLE_RATE, resultSize, weighting>;
+  /// Fixed point FFT, its buffer stores the microphone raw values.
+  RealFftQ15<samplesFFT, window> fft;
 
 public:
   void reset()
   {
     fftLog.fill(0);
     fftBin.fill(0);
+    totalAmplitude = 0;
   }
 
-  FftAnalyzer()
-  {
-    // fill the initial variables
-    // ]1; +oo[, closer to 1 get closer to a linear scale
-    static constexpr T logMultiplier = 1.2;
-
-    _numSamplesPerBar_log.fill(0);
-    minFrequenciesPerBin_log[0] = 0.0;
-    // calculate octave frequencies
-    for (uint16_t octave = 1; octave < resultSize; ++octave)
-    {
-      assert(octave < minFrequenciesPerBin_log.size());
-      // center frequency of this bin
-      minFrequenciesPerBin_log[octave] = (SAMPLE_RATE / 2.0) / pow(logMultiplier, resultSize - octave);
-    }
-    // set last max bin
-    minFrequenciesPerBin_log[resultSize] = (SAMPLE_RATE / 2.0);
-
-    // fill the linear to bin to log bin
-    _numSamplesPerBar_log[0] = 0;
-    for (uint16_t i = 1; i < samplesFFTRes; ++i)
-    {
-      const T freq = medium_bin_frequency(i);
-      uint16_t octave = 0;
-      for (; octave < resultSize; ++octave)
-      {
-        if (freq > get_log_bin_min_frequency(octave) && freq <= get_log_bin_max_frequency(octave))
-          break;
-      }
-      assert(octave >= 0 && octave < resultSize);
-      _numSamplesPerBar_log[i] = octave;
-    }
-
-    // compute window sum
-    // work on half the data for optimization
-    for (uint16_t i = 0; i < samplesFFTRes; ++i)
-      set_data(1.0, i);
-    FFT.windowing(fftWindowing, FFTDirection::Forward);
-    windowSum = 0.0;
-    for (uint16_t i = 0; i < samplesFFTRes; ++i)
-      windowSum += vReal[i] * 2;
-
-    // reset variables
-    reset();
-  }
+  FftAnalyzer() { reset(); }
 
   /// Map frequency to bin index
   int to_bin_index(const T frequency) const noexcept
@@ -133,9 +86,9 @@ public:
    */
   T get_log_bin_min_frequency(uint16_t index) const noexcept
   {
-    if (index >= minFrequenciesPerBin_log.size())
-      index = minFrequenciesPerBin_log.size() - 1;
-    return minFrequenciesPerBin_log[index];
+    if (index >= FilterbankTy::edges.size())
+      index = FilterbankTy::edges.size() - 1;
+    return FilterbankTy::edges[index];
   }
   /**
    * \brief get the minimum frequency represented by the fft bin at index
@@ -148,49 +101,124 @@ public:
     return get_log_bin_min_frequency(index + 1);
   }
 
-  /// Set the microphone data at the target index
+  /// Set the data at the target index, rounded to an integer sample
   inline void set_data(const T data, uint16_t index)
+  {
+    set_sample(static_cast<int16_t>(lmpd_constrain<long>(lroundf(data), INT16_MIN, INT16_MAX)), index);
+  }
+
+  /// Set the microphone sample at the target index
+  inline void set_sample(const int16_t sample, uint16_t index)
   {
     if (index >= samplesFFT)
       index = samplesFFT - 1;
 
-    vReal[index] = data;
-    vImag[index] = 0;
+    fft.buffer[index] = sample;
   }
 
   /// Run FFT main code
   void run_fast_fourrier_transform()
   {
-    // recenter all data around zero
-    FFT.dcRemoval();
+    // recenter all data around zero, and normalize them
+    const int8_t shift = fft.prepare();
+    // magnitudes to sample units
+    const T magnitudeScale = fft.windowGain / static_cast<T>(shift >= 0 ? (1 << shift) : 1.0 / (1 << -shift));
 
-    FFT.windowing(fftWindowing, FFTDirection::Forward);
-    FFT.compute(FFTDirection::Forward);
-    FFT.complexToMagnitude();
-
-    // store result
+    // store result, the log bins accumulate the bin powers
     fftLog.fill(0);
     maxMagnitude = 0.0;
     maxFrequency = 0.0;
-    for (uint16_t i = 0; i < samplesFFTRes; ++i)
-    {
-      const T t = fabsf(vReal[i]) * 2.0 / windowSum;
+    fft.compute([this, magnitudeScale](const uint16_t i, const uint32_t magnitude) {
+      const T t = magnitude * magnitudeScale;
       fftBin[i] = t;
+      FilterbankTy::accumulate(i, t * t, fftLog);
 
-      const uint16_t octave = _numSamplesPerBar_log[i];
-      assert(octave >= 0 && octave < fftLog.size());
-
-      // we prefer to keep the max every time, to not squash important frequencies in large bins
-      fftLog[octave] = max<T>(fftLog[octave], t);
       if (t > maxMagnitude)
       {
         maxMagnitude = t;
         maxFrequency = medium_bin_frequency(i);
       }
+    });
+
+    // the window spreads a sine on a few bins: remove its bandwidth to get amplitudes
+    static constexpr T oneOverNoiseBandwidth = 1.0 / decltype(fft)::noiseBandwidth;
+    T totalPower = 0.0;
+    for (T& bin: fftLog)
+    {
+      totalPower += bin;
+      bin = sqrt(bin * oneOverNoiseBandwidth);
     }
+    totalAmplitude = sqrt(totalPower * oneOverNoiseBandwidth);
   } // run_fast_fourrier_transform()
 };
 
+/**
+ * \brief Short time FFT: analyze the last \p samplesFFT samples every \p hopSize new samples.
+ *
+ * The analysis windows overlap, and use a Hann window to limit the spectral leakage.
+ * Smaller hops give more spectrums per second, at the cost of one transform per hop: the cost of the analysis is
+ * the cost of \ref FftAnalyzer::run_fast_fourrier_transform times ``SAMPLE_RATE / hopSize`` per second.
+ *
+ * \param[in] samplesFFT Size of the analysis window
+ * \param[in] hopSize New samples between two transforms, must divide \p samplesFFT
+ * \param[in] resultSize Is the resulting frequency bins after analysis
+ * \param[in] weighting Frequency weighting of the logarithmic bins
+ */
+template<uint16_t samplesFFT,
+         uint16_t hopSize,
+         uint16_t resultSize,
+         typename T = float,
+         Weighting weighting = Weighting::None>
+class ShortTimeFftAnalyzer : public FftAnalyzer<samplesFFT, resultSize, T, Window::Hann, weighting>
+{
+  static_assert(hopSize > 0 && samplesFFT % hopSize == 0, "hopSize must divide samplesFFT");
+
+public:
+  /// last samplesFFT samples, oldest first
+  std::array<int16_t, samplesFFT> samples;
+
+  void reset()
+  {
+    FftAnalyzer<samplesFFT, resultSize, T, Window::Hann, weighting>::reset();
+    samples.fill(0);
+    pendingSamples = 0;
+  }
+
+  ShortTimeFftAnalyzer() { reset(); }
+
+  /**
+   * \brief Add new samples to the analysis window, and run the transform if a hop is complete.
+   * If more than a hop is added at once, a single transform runs on the latest window.
+   * \return true if a new spectrum was computed
+   */
+  bool push_samples(const int16_t* newSamples, uint16_t count)
+  {
+    // only the latest window matters
+    if (count > samplesFFT)
+    {
+      newSamples += count - samplesFFT;
+      count = samplesFFT;
+    }
+    // slide the window
+    memmove(samples.data(), samples.data() + count, (samplesFFT - count) * sizeof(int16_t));
+    memcpy(samples.data() + samplesFFT - count, newSamples, count * sizeof(int16_t));
+
+    pendingSamples += count;
+    if (pendingSamples < hopSize)
+      return false;
+    pendingSamples = 0;
+
+    for (uint16_t i = 0; i < samplesFFT; ++i)
+      this->set_sample(samples[i], i);
+    this->run_fast_fourrier_transform();
+    return true;
+  }
+
+private:
+  /// samples added since the last transform
+  uint16_t pendingSamples = 0;
+};
+
 } // namespace fft
 } // namespace utils
 } // namespace lampda
@@ -0,0 +1,158 @@
+/*! \file filterbank.h
+    \brief Map the bins of a spectrum to logarithmic bands, with a precomputed sparse filterbank.
+*/
+
+#ifndef UTILS_FILTERBANK_H
+#define UTILS_FILTERBANK_H
+
+#include <array>
+#include <cstdint>
+
+namespace lampda {
+namespace utils {
+namespace fft {
+
+/// Frequency weightings folded in the filterbank
+enum class Weighting
+{
+  None, ///< flat response
+  A,    ///< decibel A weighting, sensitivity of the human ear (0dB at 1kHz)
+};
+
+/**
+ * \brief Triangular filterbank on logarithmic bands, computed at compile time.
+ *
+ * Band edges are spaced by a constant ratio, the top edge is the Nyquist frequency. Each band is a triangle peaking at
+ * the harmonic mean of its edges, and reaching zero at the peaks of its neighbours: the triangles cross at the band
+ * edges, and sum to one at every frequency. The first band is flat below its peak, the last band above its peak.
+ *
+ * A bin is in at most two adjacent bands, the filterbank stores the first band and the two weights of each bin:
+ * mapping a spectrum costs one multiply-add per nonzero weight. The weights apply to the bin powers, and include the
+ * square of the frequency weighting.
+ *
+ * \param[in] samplesFFT Size of the transform
+ * \param[in] sampleRate Sample rate, in Hertz
+ * \param[in] bands Number of logarithmic bands
+ * \param[in] weighting Frequency weighting folded in the weights
+ */
+template<uint16_t samplesFFT, uint32_t sampleRate, uint16_t bands, Weighting weighting = Weighting::None>
+class LogFilterbank
+{
+  static_assert(bands >= 2 && bands <= 255, "bands must fit the filter taps");
+
+public:
+  /// number of bins of the transform
+  static constexpr uint16_t binCount = samplesFFT / 2;
+  /// ratio of the edges of a band, ]1; +oo[, closer to 1 get closer to a linear scale
+  static constexpr double logMultiplier = 1.2;
+
+  /// weights of a bin
+  struct Tap
+  {
+    uint8_t band;     ///< first band of the bin, the second one is the next band
+    float lowWeight;  ///< power weight in the first band
+    float highWeight; ///< power weight in the next band
+  };
+
+  using EdgesTy = std::array<float, bands + 1>;
+  using TapsTy = std::array<Tap, binCount>;
+
+  /// center frequency of a bin
+  static constexpr double bin_frequency(const uint16_t index) { return index * sampleRate / double(samplesFFT); }
+
+  /// Power gain of the weighting at this frequency
+  static constexpr double weighting_power_gain(const double frequency)
+  {
+    if constexpr (weighting == Weighting::A)
+    {
+      // 0dB at 1kHz
+      return a_weighting_power(frequency) / a_weighting_power(1000.0);
+    }
+    else
+    {
+      return 1.0;
+    }
+  }
+
+  /// Add the power of a bin to its bands
+  template<typename T>
+  static inline void accumulate(const uint16_t bin, const T power, std::array<T, bands>& bandPowers)
+  {
+    const Tap& tap = taps[bin];
+    bandPowers[tap.band] += tap.lowWeight * power;
+    bandPowers[tap.band + 1] += tap.highWeight * power;
+  }
+
+private:
+  static constexpr EdgesTy make_edges()
+  {
+    EdgesTy table {};
+    double edge = sampleRate / 2.0;
+    for (uint16_t band = bands; band > 0; --band)
+    {
+      table[band] = edge;
+      edge /= logMultiplier;
+    }
+    table[0] = 0.0f;
+    return table;
+  }
+
+  static constexpr TapsTy make_taps()
+  {
+    const EdgesTy bandEdges = make_edges();
+    // peak of each band
+    std::array<double, bands> peaks {};
+    for (uint16_t band = 1; band < bands; ++band)
+      peaks[band] = 2.0 * bandEdges[band] * bandEdges[band + 1] / (bandEdges[band] + bandEdges[band + 1]);
+    // the first band has no lower edge: keep its crossing with the second band on their edge
+    peaks[0] = 2.0 * bandEdges[1] - peaks[1];
+
+    TapsTy table {};
+    // the continuous component is never in a band
+    table[0] = Tap {0, 0.0f, 0.0f};
+    for (uint16_t bin = 1; bin < binCount; ++bin)
+    {
+      const double frequency = bin_frequency(bin);
+      const float gain = static_cast<float>(weighting_power_gain(frequency));
+      if (frequency < peaks[0])
+      {
+        table[bin] = Tap {0, gain, 0.0f};
+        continue;
+      }
+      if (frequency >= peaks[bands - 1])
+      {
+        table[bin] = Tap {bands - 2, 0.0f, gain};
+        continue;
+      }
+
+      uint8_t band = 0;
+      while (frequency >= peaks[band + 1])
+        band++;
+      const double high = (frequency - peaks[band]) / (peaks[band + 1] - peaks[band]);
+      table[bin] = Tap {band, static_cast<float>((1.0 - high) * gain), static_cast<float>(high * gain)};
+    }
+    return table;
+  }
+
+  static constexpr double square(const double v) { return v * v; }
+
+  /// square of the A weighting transfer function
+  static constexpr double a_weighting_power(const double frequency)
+  {
+    const double f2 = square(frequency);
+    return square(square(12194.0)) * square(square(f2)) /
+           (square(f2 + square(20.6)) * (f2 + square(107.7)) * (f2 + square(737.9)) * square(f2 + square(12194.0)));
+  }
+
+public:
+  /// min frequency of the bands, and the max frequency of the last band
+  static constexpr EdgesTy edges = make_edges();
+  /// sparse weights, per bin
+  static constexpr TapsTy taps = make_taps();
+};
+
+} // namespace fft
+} // namespace utils
+} // namespace lampda
+
+#endif
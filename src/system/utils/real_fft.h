@@ -0,0 +1,266 @@
+/*! \file real_fft.h
+    \brief Fixed point (Q15) fast fourrier transform of real signals.
+*/
+
+#ifndef UTILS_REAL_FFT_H
+#define UTILS_REAL_FFT_H
+
+#include <array>
+#include <cstdint>
+
+#include "src/system/utils/fast_trig.h"
+
+namespace lampda {
+namespace utils {
+namespace fft {
+
+/// Windows applied to the samples before the transform
+enum class Window
+{
+  Rectangle, ///< no window, best amplitude on frequencies centered on a bin
+  Hann,      ///< less spectral leakage, for overlapping transforms
+};
+
+/**
+ * \brief Fixed point FFT of a real signal, with precomputed tables.
+ *
+ * The N real samples are packed as N/2 complex samples (even samples as real part, odd samples as imaginary part),
+ * transformed by a radix 2 complex FFT scaled by two at each stage, then split into the N/2 first bins of the real
+ * signal spectrum. The bit reversal, twiddle and window tables are computed at compile time.
+ *
+ * The samples are normalized before the transform (block floating point): the precision does not depend on the signal
+ * amplitude. The bin magnitudes use the alpha max plus beta min approximation, max error is 2.4%.
+ *
+ * \param[in] samples Number of samples, must be a power of two
+ * \param[in] window Window to apply to the samples
+ */
+template<uint16_t samples, Window window = Window::Rectangle> class RealFftQ15
+{
+  static_assert(samples >= 16 && (samples & (samples - 1)) == 0, "samples must be a power of two");
+  static_assert(samples <= 8192, "twiddle angles need 16 bits angles divisible by the sample count");
+
+public:
+  /// number of complex points of the transform, and number of output bins
+  static constexpr uint16_t binCount = samples / 2;
+  /// maximum absolute value of a normalized sample: with a factor two scaling per stage, nothing can overflow
+  static constexpr int32_t maxInput = 1 << 14;
+
+  /// Input samples, transformed in place
+  std::array<int16_t, samples> buffer;
+
+  /**
+   * \brief Remove the mean of the samples, normalize them and apply the window.
+   * \return the normalization shift: the magnitudes are in units of 1/2^shift sample units
+   */
+  int8_t prepare()
+  {
+    int32_t sum = 0;
+    for (const int16_t sample: buffer)
+      sum += sample;
+    const int32_t mean = sum / static_cast<int32_t>(samples);
+
+    int32_t peak = 0;
+    for (const int16_t sample: buffer)
+    {
+      const int32_t value = sample - mean;
+      const int32_t amplitude = value < 0 ? -value : value;
+      if (amplitude > peak)
+        peak = amplitude;
+    }
+    // largest shift that keeps the peak under maxInput
+    int8_t shift = 0;
+    if (peak > 0)
+    {
+      while ((peak << (shift + 1)) <= maxInput and shift < 14)
+        shift++;
+      while ((peak >> -shift) > maxInput)
+        shift--;
+    }
+
+    for (uint16_t i = 0; i < samples; ++i)
+    {
+      int32_t value = buffer[i] - mean;
+      value = shift >= 0 ? value << shift : value >> -shift;
+      if constexpr (window != Window::Rectangle)
+        value = (value * windowTable[i] + (1 << 14)) >> 15;
+      buffer[i] = value;
+    }
+    return shift;
+  }
+
+  /**
+   * \brief Run the transform on the prepared buffer
+   * \param[in] on_bin Called with the index and magnitude of every bin. The magnitude of a sine centered on a bin is
+   * its amplitude in normalized units, divided by \ref windowGain
+   */
+  template<typename BinCallbackTy> void compute(BinCallbackTy&& on_bin)
+  {
+    complex_transform();
+
+    // split the packed spectrum in the spectrums of the even and odd samples, and combine them
+    const int16_t* z = buffer.data();
+    for (uint16_t k = 0; k < binCount; ++k)
+    {
+      const uint16_t m = (binCount - k) & (binCount - 1);
+      const int32_t a = z[2 * k];
+      const int32_t b = z[2 * k + 1];
+      const int32_t c = z[2 * m];
+      const int32_t d = z[2 * m + 1];
+
+      // spectrums of the even and odd samples, times two
+      const int32_t evenRe = a + c;
+      const int32_t evenIm = b - d;
+      const int32_t oddRe = b + d;
+      const int32_t oddIm = c - a;
+
+      // odd samples are delayed by one sample
+      const int32_t cosine = twiddleTable[2 * k];
+      const int32_t sine = twiddleTable[2 * k + 1];
+      const int32_t rotatedRe = (oddRe * cosine + oddIm * sine + (1 << 14)) >> 15;
+      const int32_t rotatedIm = (oddIm * cosine - oddRe * sine + (1 << 14)) >> 15;
+
+      on_bin(k, magnitude((evenRe + rotatedRe) >> 1, (evenIm + rotatedIm) >> 1));
+    }
+  }
+
+  /// Approximation of sqrt(re^2 + im^2)
+  static constexpr uint32_t magnitude(int32_t re, int32_t im)
+  {
+    re = re < 0 ? -re : re;
+    im = im < 0 ? -im : im;
+    const int32_t high = re > im ? re : im;
+    const int32_t low = re > im ? im : re;
+    // max(high, 29/32 * high + 61/128 * low)
+    const int32_t approximation = (116 * high + 61 * low) >> 7;
+    return approximation > high ? approximation : high;
+  }
+
+private:
+  using TwiddleTableTy = std::array<int16_t, samples>;
+  using WindowTableTy = std::array<int16_t, samples>;
+  using BitReversalTableTy = std::array<uint16_t, binCount>;
+
+  /// 16 bits angle of the first twiddle
+  static constexpr uint16_t twiddleAngleStep = 65536u / samples;
+
+  /// cos and sin of 2 * pi * k / samples, interleaved, for k in [0, samples/2[
+  static constexpr TwiddleTableTy make_twiddle_table()
+  {
+    TwiddleTableTy table {};
+    for (uint16_t k = 0; k < binCount; ++k)
+    {
+      table[2 * k] = trig::cos_q15(k * twiddleAngleStep);
+      table[2 * k + 1] = trig::sin_q15(k * twiddleAngleStep);
+    }
+    return table;
+  }
+
+  /// window coefficients, in Q15
+  static constexpr WindowTableTy make_window_table()
+  {
+    WindowTableTy table {};
+    for (uint16_t i = 0; i < samples; ++i)
+    {
+      if (window == Window::Hann)
+        table[i] = (INT16_MAX - trig::cos_q15(i * twiddleAngleStep)) / 2;
+      else
+        table[i] = INT16_MAX;
+    }
+    return table;
+  }
+
+  /// bit reversed index of the complex points
+  static constexpr BitReversalTableTy make_bit_reversal_table()
+  {
+    BitReversalTableTy table {};
+    for (uint16_t i = 0; i < binCount; ++i)
+    {
+      uint16_t reversed = 0;
+      for (uint16_t bit = 1; bit < binCount; bit <<= 1)
+        reversed = (reversed << 1) | ((i & bit) ? 1 : 0);
+      table[i] = reversed;
+    }
+    return table;
+  }
+
+  static constexpr float compute_window_gain()
+  {
+    float sum = 0.0f;
+    for (const int16_t coefficient: windowTable)
+      sum += coefficient;
+    return samples * INT16_MAX / sum;
+  }
+
+  static constexpr float compute_noise_bandwidth()
+  {
+    float sum = 0.0f;
+    float squaredSum = 0.0f;
+    for (const int16_t coefficient: windowTable)
+    {
+      sum += coefficient;
+      squaredSum += static_cast<float>(coefficient) * coefficient;
+    }
+    return samples * squaredSum / (sum * sum);
+  }
+
+  static constexpr TwiddleTableTy twiddleTable = make_twiddle_table();
+  static constexpr WindowTableTy windowTable = make_window_table();
+  static constexpr BitReversalTableTy bitReversalTable = make_bit_reversal_table();
+
+public:
+  /// Multiply the magnitudes by this gain to compensate the window attenuation
+  static constexpr float windowGain = compute_window_gain();
+  /// Equivalent noise bandwidth of the window, in bins: the sum of the squared magnitudes of a sine, after the window
+  /// gain, is its squared amplitude times this bandwidth
+  static constexpr float noiseBandwidth = compute_noise_bandwidth();
+
+private:
+  /// in place radix 2 transform of the binCount packed complex points
+  void complex_transform()
+  {
+    int16_t* z = buffer.data();
+    for (uint16_t i = 0; i < binCount; ++i)
+    {
+      const uint16_t j = bitReversalTable[i];
+      if (i < j)
+      {
+        const int16_t re = z[2 * i];
+        const int16_t im = z[2 * i + 1];
+        z[2 * i] = z[2 * j];
+        z[2 * i + 1] = z[2 * j + 1];
+        z[2 * j] = re;
+        z[2 * j + 1] = im;
+      }
+    }
+
+    for (uint16_t half = 1; half < binCount; half <<= 1)
+    {
+      const uint16_t twiddleStep = binCount / half;
+      for (uint16_t k = 0; k < half; ++k)
+      {
+        const int32_t cosine = twiddleTable[2 * k * twiddleStep];
+        const int32_t sine = twiddleTable[2 * k * twiddleStep + 1];
+        for (uint16_t i = k; i < binCount; i += 2 * half)
+        {
+          int16_t* top = &z[2 * i];
+          int16_t* bottom = &z[2 * (i + half)];
+          const int32_t re = (bottom[0] * cosine + bottom[1] * sine + (1 << 14)) >> 15;
+          const int32_t im = (bottom[1] * cosine - bottom[0] * sine + (1 << 14)) >> 15;
+          const int32_t topRe = top[0];
+          const int32_t topIm = top[1];
+          // scale by two at each stage
+          top[0] = (topRe + re) >> 1;
+          top[1] = (topIm + im) >> 1;
+          bottom[0] = (topRe - re) >> 1;
+          bottom[1] = (topIm - im) >> 1;
+        }
+      }
+    }
+  }
+};
+
+} // namespace fft
+} // namespace utils
+} // namespace lampda
+
+#endif
@@ -0,0 +1,105 @@
+/*! \file spsc_queue.h
+    \brief Define a lock-free single producer, single consumer queue
+*/
+
+#ifndef UTILS_SPSC_QUEUE_H
+#define UTILS_SPSC_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace lampda {
+namespace utils {
+
+/**
+ * \brief Pass objects from a producer to a consumer, in order, without locks.
+ *
+ * A ring buffer with a write index owned by the producer and a read index owned by the consumer: an element is written
+ * before the write index is published, and read before the read index is published, so none of them ever waits for
+ * the other.
+ * When the queue is full, the new elements are dropped and counted.
+ *
+ * Safe to use from an interrupt (producer or consumer), with a single producer and a single consumer.
+ *
+ * \param[in] capacity Maximum number of elements in the queue, a power of two
+ */
+template<typename T, uint8_t capacity> class SpscQueue
+{
+  static_assert(capacity > 1 and (capacity & (capacity - 1)) == 0, "SpscQueue: capacity must be a power of two");
+
+public:
+  /**
+   * \brief Add an element at the end of the queue. Producer side
+   * \return false if the queue is full, the element is dropped
+   */
+  bool push(const T& element)
+  {
+    T* slot = write_slot();
+    if (slot == nullptr)
+      return false;
+
+    *slot = element;
+    commit();
+    return true;
+  }
+
+  /**
+   * \brief Element at the end of the queue, to write in place instead of copying it. Producer side
+   * \return nullptr if the queue is full, the element is dropped. Else, the element is added by commit()
+   */
+  T* write_slot()
+  {
+    const uint8_t writeIndex = _writeIndex.load(std::memory_order_relaxed);
+    if (static_cast<uint8_t>(writeIndex - _readIndex.load(std::memory_order_acquire)) >= capacity)
+    {
+      _droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &_elements[writeIndex & indexMask];
+  }
+
+  /// Add the element written in write_slot() at the end of the queue. Producer side
+  void commit() { _writeIndex.store(_writeIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  /**
+   * \brief Remove the first element of the queue. Consumer side
+   * \param[out] element The first element, unchanged if the queue is empty
+   * \return false if the queue is empty
+   */
+  bool pop(T& element)
+  {
+    const uint8_t readIndex = _readIndex.load(std::memory_order_relaxed);
+    if (readIndex == _writeIndex.load(std::memory_order_acquire))
+      return false;
+
+    element = _elements[readIndex & indexMask];
+    _readIndex.store(readIndex + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Return true if the queue has elements to pop
+  bool has_elements() const
+  {
+    return _readIndex.load(std::memory_order_relaxed) != _writeIndex.load(std::memory_order_relaxed);
+  }
+
+  /// Return the number of elements dropped because the queue was full
+  uint32_t get_dropped_count() const { return _droppedCount.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr uint8_t indexMask = capacity - 1;
+
+  std::array<T, capacity> _elements {};
+  /// next element to write, owned by the producer. Wraps around, with the read index
+  std::atomic<uint8_t> _writeIndex {0};
+  /// next element to read, owned by the consumer
+  std::atomic<uint8_t> _readIndex {0};
+  /// elements pushed when full
+  std::atomic<uint32_t> _droppedCount {0};
+};
+
+} // namespace utils
+} // namespace lampda
+
+#endif
@@ -0,0 +1,279 @@
+/*! \file tempo_tracker.h
+    \brief Estimate the tempo and the beat phase of a sound, from its spectrums.
+*/
+
+#ifndef UTILS_TEMPO_TRACKER_H
+#define UTILS_TEMPO_TRACKER_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "src/system/utils/fft.h"
+
+namespace lampda {
+namespace utils {
+namespace fft {
+
+/**
+ * \brief Incremental tempo tracker, fed by the spectrum of every analysis hop.
+ *
+ * The onset strength of a spectrum is its spectral flux: the sum of the increases of the log compressed bands, minus
+ * its recent average. The tracker keeps an autocorrelation of the onset strength for every lag of the tempo range,
+ * with an exponential decay of a few seconds: each hop adds one product per lag, and nothing is ever recomputed.
+ * The tempo is the autocorrelation peak, weighted by a prior around 120 BPM to avoid the half tempo.
+ *
+ * The beat phase comes from a histogram of the onset strength over the beat period, with the same kind of decay:
+ * the beat is on the loudest phase.
+ *
+ * The cost of an update does not depend on the history length: O(bands + lags + phaseBins).
+ *
+ * \param[in] bands Number of bands of the spectrums
+ * \param[in] hopSize Samples between two spectrums
+ */
+template<uint16_t bands, uint16_t hopSize> class TempoTracker
+{
+public:
+  /// spectrums per second
+  static constexpr float frameRate = SAMPLE_RATE / static_cast<float>(hopSize);
+
+  /// tempo range, in beats per minute
+  static constexpr float minBpm = 60.0f;
+  static constexpr float maxBpm = 200.0f;
+  /// tempo favored between a tempo and its half, in beats per minute
+  static constexpr float preferredBpm = 120.0f;
+
+  /// lags of the tempo range, in spectrums
+  static constexpr uint16_t minLag = static_cast<uint16_t>(frameRate * 60.0f / maxBpm);
+  static constexpr uint16_t maxLag = static_cast<uint16_t>(frameRate * 60.0f / minBpm) + 1;
+  static constexpr uint16_t lagCount = maxLag - minLag + 1;
+
+  /// time constant of the autocorrelation, in seconds
+  static constexpr float tempoMemory_s = 6.0f;
+  /// time constant of the phase histogram, in seconds
+  static constexpr float phaseMemory_s = 2.0f;
+  /// resolution of the beat phase
+  static constexpr uint8_t phaseBins = 32;
+
+  TempoTracker()
+  {
+    // log normal prior, one octave wide
+    for (uint16_t i = 0; i < lagCount; ++i)
+    {
+      const float octaves = log2f(lag_to_bpm(minLag + i) / preferredBpm);
+      tempoPrior[i] = expf(-0.5f * octaves * octaves);
+    }
+    reset();
+  }
+
+  void reset()
+  {
+    previousBands.fill(0.0f);
+    fluxAverage = 0.0f;
+    onsets.fill(0.0f);
+    onsetIndex = 0;
+    autocorrelation.fill(0.0f);
+    energy = 0.0f;
+    phaseHistogram.fill(0.0f);
+    period = frameRate * 60.0f / preferredBpm;
+    phase = 0.0f;
+    beatOffset = 0.0f;
+    bpm = 0.0f;
+    confidence = 0.0f;
+    onsetStrength = 0.0f;
+    isFirstSpectrum = true;
+  }
+
+  /**
+   * \brief Add the spectrum of a new hop
+   * \param[in] spectrum Amplitude of every band
+   */
+  void update(const std::array<float, bands>& spectrum)
+  {
+    update_onset_strength(spectrum);
+    update_autocorrelation();
+    update_tempo();
+    update_phase();
+  }
+
+  /// Estimated tempo, in beats per minute. 0 until the first estimation
+  float get_bpm() const { return bpm; }
+  /// Position in the current beat, in [0, 1[. 0 is on the beat
+  float get_beat_phase() const { return phase >= beatOffset ? phase - beatOffset : phase - beatOffset + 1.0f; }
+  /// Periodicity of the onsets at the estimated tempo, in [0, 1]
+  float get_confidence() const { return confidence; }
+  /// Onset strength of the last spectrum
+  float get_onset_strength() const { return onsetStrength; }
+
+  /// Tempo of a lag, in beats per minute
+  static constexpr float lag_to_bpm(const float lag) { return frameRate * 60.0f / lag; }
+
+private:
+  static constexpr uint16_t onsetHistorySize = maxLag + 1;
+
+  /// spectral flux, minus its recent average
+  void update_onset_strength(const std::array<float, bands>& spectrum)
+  {
+    float flux = 0.0f;
+    for (uint16_t i = 0; i < bands; ++i)
+    {
+      const float compressed = logf(1.0f + spectrum[i]);
+      const float increase = compressed - previousBands[i];
+      if (increase > 0.0f)
+        flux += increase;
+      previousBands[i] = compressed;
+    }
+    // the first spectrum is an increase from silence
+    if (isFirstSpectrum)
+    {
+      isFirstSpectrum = false;
+      flux = 0.0f;
+    }
+
+    // ~130ms average
+    static constexpr float averageWeight = 1.0f / 16.0f;
+    onsetStrength = flux > fluxAverage ? flux - fluxAverage : 0.0f;
+    fluxAverage += averageWeight * (flux - fluxAverage);
+
+    onsetIndex = onsetIndex + 1 < onsetHistorySize ? onsetIndex + 1 : 0;
+    onsets[onsetIndex] = onsetStrength;
+  }
+
+  /// decaying autocorrelation of the onset strength, for every lag of the tempo range
+  void update_autocorrelation()
+  {
+    static const float decay = expf(-1.0f / (tempoMemory_s * frameRate));
+    energy = decay * energy + onsetStrength * onsetStrength;
+    if (onsetStrength <= 0.0f)
+    {
+      // nothing to add
+      for (float& value: autocorrelation)
+        value *= decay;
+      return;
+    }
+
+    // oldest lag first
+    uint16_t delayedIndex = onsetIndex >= maxLag ? onsetIndex - maxLag : onsetIndex + onsetHistorySize - maxLag;
+    for (uint16_t i = lagCount; i > 0; --i)
+    {
+      float& value = autocorrelation[i - 1];
+      value = decay * value + onsetStrength * onsets[delayedIndex];
+      delayedIndex = delayedIndex + 1 < onsetHistorySize ? delayedIndex + 1 : 0;
+    }
+  }
+
+  /// weighted peak of the autocorrelation
+  void update_tempo()
+  {
+    uint16_t best = 0;
+    float bestScore = 0.0f;
+    float sum = 0.0f;
+    for (uint16_t i = 0; i < lagCount; ++i)
+    {
+      sum += autocorrelation[i];
+      const float score = autocorrelation[i] * tempoPrior[i];
+      if (score > bestScore)
+      {
+        bestScore = score;
+        best = i;
+      }
+    }
+    if (bestScore <= 0.0f)
+    {
+      confidence = 0.0f;
+      return;
+    }
+
+    // parabolic interpolation of the peak
+    float lag = minLag + best;
+    if (best > 0 and best + 1 < lagCount)
+    {
+      const float before = autocorrelation[best - 1];
+      const float peak = autocorrelation[best];
+      const float after = autocorrelation[best + 1];
+      const float curvature = before - 2.0f * peak + after;
+      if (curvature < 0.0f)
+        lag += lmpd_constrain(0.5f * (before - after) / curvature, -0.5f, 0.5f);
+    }
+
+    // periodicity: height of the peak above the average, relative to the onset energy
+    const float mean = sum / lagCount;
+    const float peakHeight = autocorrelation[best] - mean;
+    confidence = energy > mean ? lmpd_constrain(peakHeight / (energy - mean), 0.0f, 1.0f) : 0.0f;
+
+    // the beat positions are lost on large tempo changes
+    if (fabsf(lag - period) > 0.04f * period)
+      phaseHistogram.fill(0.0f);
+    period = lag;
+    bpm = lag_to_bpm(lag);
+  }
+
+  /// decaying histogram of the onset strength over the beat period
+  void update_phase()
+  {
+    phase += 1.0f / period;
+    if (phase >= 1.0f)
+      phase -= 1.0f;
+
+    static const float decay = expf(-1.0f / (phaseMemory_s * frameRate));
+    const uint8_t currentBin = lmpd_constrain<int>(phase * phaseBins, 0, phaseBins - 1);
+    uint8_t best = 0;
+    for (uint8_t i = 0; i < phaseBins; ++i)
+    {
+      phaseHistogram[i] *= decay;
+      if (i == currentBin)
+        phaseHistogram[i] += onsetStrength;
+      if (phaseHistogram[i] > phaseHistogram[best])
+        best = i;
+    }
+
+    // parabolic interpolation of the loudest phase, around the circle
+    const float before = phaseHistogram[best > 0 ? best - 1 : phaseBins - 1];
+    const float peak = phaseHistogram[best];
+    const float after = phaseHistogram[best + 1 < phaseBins ? best + 1 : 0];
+    const float curvature = before - 2.0f * peak + after;
+    float offset = best + 0.5f;
+    if (curvature < 0.0f)
+      offset += lmpd_constrain(0.5f * (before - after) / curvature, -0.5f, 0.5f);
+    beatOffset = offset / phaseBins;
+    if (beatOffset >= 1.0f)
+      beatOffset -= 1.0f;
+    else if (beatOffset < 0.0f)
+      beatOffset += 1.0f;
+  }
+
+  /// log compressed bands of the last spectrum
+  std::array<float, bands> previousBands;
+  /// recent average of the spectral flux
+  float fluxAverage;
+  /// last onset strengths, ring buffer
+  std::array<float, onsetHistorySize> onsets;
+  /// index of the last onset strength
+  uint16_t onsetIndex;
+  /// decaying autocorrelation of the onset strength, from minLag to maxLag
+  std::array<float, lagCount> autocorrelation;
+  /// decaying autocorrelation at lag 0
+  float energy;
+  /// tempo weight of every lag
+  std::array<float, lagCount> tempoPrior;
+
+  /// decaying onset strength, per phase of the beat period
+  std::array<float, phaseBins> phaseHistogram;
+  /// beat period, in spectrums
+  float period;
+  /// position in the beat period, in [0, 1[
+  float phase;
+  /// phase of the beats, in [0, 1[
+  float beatOffset;
+
+  float bpm;
+  float confidence;
+  float onsetStrength;
+  bool isFirstSpectrum;
+};
+
+} // namespace fft
+} // namespace utils
+} // namespace lampda
+
+#endif
@@ -0,0 +1,71 @@
+/*! \file triple_buffer.h
+    \brief Define a lock-free single producer, single consumer triple buffer
+*/
+
+#ifndef UTILS_TRIPLE_BUFFER_H
+#define UTILS_TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace lampda {
+namespace utils {
+
+/**
+ * \brief Share the latest version of an object between a producer and a consumer, without locks.
+ *
+ * The producer writes in its own buffer and publishes it, the consumer reads in its own buffer and fetches the latest
+ * published one. The third buffer is exchanged between them with a single atomic operation, so none of them ever
+ * waits for the other, and the consumer never sees a partially written object.
+ * Intermediate versions are dropped if the producer publishes faster than the consumer fetches.
+ *
+ * Safe to use from an interrupt (producer or consumer), with a single producer and a single consumer.
+ */
+template<typename T> class TripleBuffer
+{
+public:
+  /// Buffer owned by the producer, write the next version here
+  T& write_buffer() { return _buffers[_writeIndex]; }
+
+  /// Make the write buffer the latest version, and get a new write buffer
+  void publish()
+  {
+    _writeIndex = _sharedIndex.exchange(_writeIndex | newDataFlag, std::memory_order_acq_rel) & indexMask;
+  }
+
+  /**
+   * \brief Fetch the latest published version, if any new
+   * \return true if the read buffer changed
+   */
+  bool fetch()
+  {
+    if ((_sharedIndex.load(std::memory_order_relaxed) & newDataFlag) == 0)
+      return false;
+    _readIndex = _sharedIndex.exchange(_readIndex, std::memory_order_acq_rel) & indexMask;
+    return true;
+  }
+
+  /// Buffer owned by the consumer, contains the last fetched version. Valid until the next \ref fetch
+  const T& read_buffer() const { return _buffers[_readIndex]; }
+
+  /// Return true if a version was published since the last \ref fetch
+  bool has_new_data() const { return (_sharedIndex.load(std::memory_order_relaxed) & newDataFlag) != 0; }
+
+private:
+  static constexpr uint8_t indexMask = 0x03;
+  static constexpr uint8_t newDataFlag = 0x04;
+
+  std::array<T, 3> _buffers {};
+  /// index of the exchanged buffer, with the new data flag
+  std::atomic<uint8_t> _sharedIndex {0};
+  /// owned by the producer
+  uint8_t _writeIndex = 1;
+  /// owned by the consumer
+  uint8_t _readIndex = 2;
+};
+
+} // namespace utils
+} // namespace lampda
+
+#endif
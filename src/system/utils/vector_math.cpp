@@ -1,4 +1,5 @@
 #include "vector_math.h"
+#include "fast_trig.h"
 #include <cmath>
 
 namespace lampda {
@@ -43,13 +44,13 @@ void RotationMatrix::from_angles_XYZ(const vec3d& angles_rad)
 
 void RotationMatrix::from_angles_ZYX(const vec3d& angles_rad)
 {
-  auto sinAlpha = sinf(angles_rad.x);
-  auto sinBeta = sinf(angles_rad.y);
-  auto sinGamma = sinf(angles_rad.z);
+  auto sinAlpha = trig::sin(angles_rad.x);
+  auto sinBeta = trig::sin(angles_rad.y);
+  auto sinGamma = trig::sin(angles_rad.z);
 
-  auto cosAlpha = cosf(angles_rad.x);
-  auto cosBeta = cosf(angles_rad.y);
-  auto cosGamma = cosf(angles_rad.z);
+  auto cosAlpha = trig::cos(angles_rad.x);
+  auto cosBeta = trig::cos(angles_rad.y);
+  auto cosGamma = trig::cos(angles_rad.z);
 
   R11 = cosAlpha * cosBeta;
   R12 = cosAlpha * sinBeta * sinGamma - sinAlpha * cosGamma;
@@ -71,13 +71,16 @@ void brightness_update(const brightness_t brightness)
   }
 
   // map to a new curve, favorising low levels
+  // the exponential is baked once in a lookup table, sampled in integer math
   using curve_t = utils::curves::ExponentialCurve<brightness_t, brightness_t>;
-  static curve_t brightnessCurve(
-          curve_t::point_t {0, stripInputMinVoltage_mV},
-          curve_t::point_t {::lampda::brightness::absoluteMaximumBrightness, stripInputMaxVoltage_mV},
-          50.0);
-
-  currentBrightness = round(brightnessCurve.sample(constraintBrightness));
+  static const utils::curves::UniformLutCurve<brightness_t, brightness_t, 129> brightnessCurve(
+          curve_t(curve_t::point_t {0, stripInputMinVoltage_mV},
+                  curve_t::point_t {::lampda::brightness::absoluteMaximumBrightness, stripInputMaxVoltage_mV},
+                  50.0),
+          0,
+          ::lampda::brightness::absoluteMaximumBrightness);
+
+  currentBrightness = brightnessCurve.sample(constraintBrightness);
 
   component::outputPower::write_voltage(currentBrightness);
   set_color(currentColor);
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "src/system/component/sound.h"
+
+#include "src/system/hal/threads.h"
+#include "src/system/hal/time.h"
+
+// access simulation states
+#include "simulator/include/simulator_state.h"
+#include "simulator/include/hardware_influencer.h"
+#include "simulator/include/wav_source.h"
+
+namespace lampda {
+
+using namespace std::chrono_literals;
+
+// simulated time goes faster than real time
+static constexpr float timeFactor = 4.0f;
+// convergence of the tempo estimation
+static constexpr uint32_t analysisDuration_ms = 12 * 1000;
+
+class MicrophoneFixture : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    //
+    simulator::mock_registers::shouldStopThreads = false;
+    ::simulator::globals::state.slowTimeFactor = timeFactor;
+    ::simulator::time_mocks::reset();
+  }
+
+  void TearDown() override
+  {
+    component::microphone::disable();
+    // shutdown all threads
+    hal::threads::shutdown();
+
+    simulator::mock_microphone::set_wav_file(nullptr);
+    ::simulator::globals::state.slowTimeFactor = 1.0f;
+    std::remove(wavPath.c_str());
+  }
+
+  // write a drum loop, at a sample rate different from the microphone
+  void write_drum_loop(const float bpm)
+  {
+    static constexpr uint32_t fileRate = 44100;
+    std::vector<int16_t> signal(8 * fileRate);
+    const float beatSamples = fileRate * 60.0f / bpm;
+    uint32_t randomState = 11;
+    for (size_t i = 0; i < signal.size(); i++)
+    {
+      randomState = randomState * 1664525u + 1013904223u;
+      const float noise = static_cast<int32_t>(randomState >> 16) / 32768.0f - 1.0f;
+
+      const float beatPosition = fmodf(i, beatSamples);
+      const float kickTime = beatPosition / fileRate;
+      const float hihatTime = fmodf(beatPosition + beatSamples / 2.0f, beatSamples) / fileRate;
+
+      float value = 300.0f * noise;
+      value += 8000.0f * expf(-kickTime * 30.0f) * sinf(2.0f * M_PI * 70.0f * kickTime);
+      value += 6000.0f * expf(-kickTime * 150.0f) * noise;
+      value += 1500.0f * expf(-hihatTime * 80.0f) * noise;
+      signal[i] = lround(value);
+    }
+    // the file loops, keep whole beats
+    signal.resize(static_cast<size_t>(floor(signal.size() / beatSamples) * beatSamples));
+
+    wavPath = ::testing::TempDir() + "drum_loop.wav";
+    ASSERT_TRUE(simulator::write_wav(wavPath, signal, fileRate));
+    ASSERT_TRUE(simulator::mock_microphone::set_wav_file(wavPath.c_str(), true));
+  }
+
+  std::string wavPath;
+};
+
+// Replay a drum loop through the microphone, and estimate its tempo
+TEST_F(MicrophoneFixture, wav_file_tempo)
+{
+  static constexpr float bpm = 128.0f;
+  write_drum_loop(bpm);
+  ASSERT_TRUE(component::microphone::enable());
+
+  float estimatedBpm = 0.0f;
+  float confidence = 0.0f;
+  while (hal::time_ms() < analysisDuration_ms)
+  {
+    std::this_thread::sleep_for(10ms);
+
+    // one main loop iteration
+    const auto& features = component::microphone::get_sound_features();
+    estimatedBpm = features.bpm;
+    confidence = features.tempoConfidence;
+    component::microphone::release_sound_frame();
+  }
+
+  EXPECT_NEAR(estimatedBpm, bpm, bpm * 0.03);
+  EXPECT_GT(confidence, 0.5f);
+}
+
+} // namespace lampda
@@ -0,0 +1,172 @@
+/**
+ * Test for the fixed point audio front end
+ */
+#include <cmath>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "src/system/utils/audio_front_end.h"
+
+namespace lampda::utils::audio {
+
+namespace {
+
+constexpr uint16_t blockSize = 128;
+constexpr int16_t gateLevel = 80;
+constexpr int16_t targetRms = INT16_MAX * 0.5f;
+
+using FrontEndTy = AutoGainFrontEnd<gateLevel, targetRms>;
+
+/// previous float front end: mean removal of the capture, then the auto gain updated on every sample
+struct FloatFrontEnd
+{
+  float autoGain = 1.0f;
+
+  void process(const int16_t* input, const uint16_t count, int16_t* blocked, int16_t* gained)
+  {
+    float mean = 0.0f;
+    for (uint16_t i = 0; i < count; i++)
+      mean += input[i];
+    mean /= static_cast<float>(count);
+    for (uint16_t i = 0; i < count; i++)
+      blocked[i] = input[i] - mean;
+
+    float dataMedian = 0.0;
+    for (uint16_t i = 0; i < count; i++)
+      dataMedian += abs(blocked[i]);
+    const bool shouldUpdateGain = dataMedian / static_cast<float>(count) > gateLevel;
+
+    if (not shouldUpdateGain)
+    {
+      const float newGain = autoGain - 0.1f * count / 512.0f * (autoGain - 1.0f);
+      if (newGain > 0.0001f && newGain < 30.0f)
+        autoGain = newGain;
+    }
+    for (uint16_t i = 0; i < count; i++)
+    {
+      const float autoGainedData = (blocked[i] / static_cast<float>(INT16_MAX)) * autoGain;
+      if (shouldUpdateGain)
+        autoGain *= 1.0f + (0.00005f * (1.0f - (autoGainedData * autoGainedData) / 0.25f));
+      gained[i] = lmpd_constrain<float>(autoGainedData * INT16_MAX, INT16_MIN, INT16_MAX);
+    }
+    autoGain = lmpd_constrain(autoGain, 0.0001f, 30.0f);
+  }
+};
+
+/// a quiet part, a loud part, then a quiet part again, with a DC offset
+std::vector<int16_t> generate_signal(const int16_t offset)
+{
+  std::vector<int16_t> signal(8 * fft::SAMPLE_RATE);
+  uint32_t randomState = 7;
+  for (size_t i = 0; i < signal.size(); i++)
+  {
+    randomState = randomState * 1664525u + 1013904223u;
+    const float noise = static_cast<int32_t>(randomState >> 16) / 32768.0f - 1.0f;
+    const float time = i / static_cast<float>(fft::SAMPLE_RATE);
+
+    // the quiet parts are below the gate level
+    const float amplitude = (time > 2.0f and time < 5.0f) ? 6000.0f : 40.0f;
+    const float value = amplitude * (sinf(2.0f * M_PI * 440.0f * time) + 0.3f * sinf(2.0f * M_PI * 1234.0f * time)) +
+                        20.0f * noise;
+    signal[i] = lround(offset + value);
+  }
+  return signal;
+}
+
+double rms(const int16_t* samples, const size_t count)
+{
+  double sum = 0.0;
+  for (size_t i = 0; i < count; i++)
+    sum += static_cast<double>(samples[i]) * samples[i];
+  return sqrt(sum / count);
+}
+
+} // namespace
+
+TEST(audioFrontEndTest, log2Accuracy)
+{
+  uint32_t maxError = 0;
+  for (uint32_t value = 1; value < (1u << 31); value += 1 + value / 1000)
+  {
+    const int64_t expected = llround(log2(static_cast<double>(value)) * 65536.0);
+    maxError = std::max<uint32_t>(maxError, llabs(static_cast<int64_t>(log2_q16(value)) - expected));
+  }
+  EXPECT_LE(maxError, 12u);
+
+  // exact on the powers of two
+  static_assert(log2_q16(1) == 0);
+  static_assert(log2_q16(1024) == 10 << 16);
+  EXPECT_EQ(log2_q16(0), 0u);
+
+  // decibels of the sound level, from an amplitude in 1/256
+  float maxDecibelError = 0.0f;
+  for (float amplitude = 1.0f; amplitude < 65535.0f; amplitude *= 1.01f)
+  {
+    const float decibels = amplitude_to_decibels_q8(lroundf(amplitude * 256)) / 256.0f - 20.0f * log10f(256.0f);
+    maxDecibelError = std::max(maxDecibelError, fabsf(decibels - 20.0f * log10f(amplitude)));
+  }
+  EXPECT_LT(maxDecibelError, 0.02f);
+}
+
+TEST(audioFrontEndTest, dcBlocking)
+{
+  for (const int16_t offset: {0, 1500, -3000})
+  {
+    const auto signal = generate_signal(offset);
+    FrontEndTy frontEnd;
+    FloatFrontEnd floatFrontEnd;
+
+    int16_t blocked[blockSize], gained[blockSize];
+    int16_t floatBlocked[blockSize], floatGained[blockSize];
+    int64_t blockedSum = 0;
+    double power = 0.0;
+    double floatPower = 0.0;
+    for (size_t start = 0; start + blockSize <= signal.size(); start += blockSize)
+    {
+      frontEnd.process(signal.data() + start, blockSize, blocked, gained);
+      floatFrontEnd.process(signal.data() + start, blockSize, floatBlocked, floatGained);
+      for (uint16_t i = 0; i < blockSize; i++)
+        blockedSum += blocked[i];
+
+      power += pow(rms(blocked, blockSize), 2);
+      floatPower += pow(rms(floatBlocked, blockSize), 2);
+    }
+
+    // no DC is left, and the same signal is left for the FFT
+    EXPECT_LT(fabs(blockedSum / static_cast<double>(signal.size())), 1.0) << "offset " << offset;
+    EXPECT_NEAR(power / floatPower, 1.0, 0.01) << "offset " << offset;
+  }
+}
+
+TEST(audioFrontEndTest, autoGainEquivalence)
+{
+  const auto signal = generate_signal(1500);
+  FrontEndTy frontEnd;
+  FloatFrontEnd floatFrontEnd;
+
+  int16_t blocked[blockSize], gained[blockSize];
+  int16_t floatBlocked[blockSize], floatGained[blockSize];
+  float maxGainError = 0.0f;
+  double maxRmsError = 0.0;
+  for (size_t start = 0; start + blockSize <= signal.size(); start += blockSize)
+  {
+    frontEnd.process(signal.data() + start, blockSize, blocked, gained);
+    floatFrontEnd.process(signal.data() + start, blockSize, floatBlocked, floatGained);
+
+    maxGainError = std::max(maxGainError, fabsf(frontEnd.get_gain() / floatFrontEnd.autoGain - 1.0f));
+    // the quiet parts are a few units: the rounding dominates
+    const double floatRms = rms(floatGained, blockSize);
+    if (floatRms > 1000.0)
+      maxRmsError = std::max(maxRmsError, fabs(rms(gained, blockSize) / floatRms - 1.0));
+  }
+
+  // the running average of the DC blocker keeps the gate open for one more capture after the loud part: the gains
+  // differ by one gain update, then converge back to 1 together
+  EXPECT_LT(maxGainError, 0.03f);
+  EXPECT_LT(maxRmsError, 0.03);
+
+  // the gain went back to 1 after the loud part
+  EXPECT_NEAR(frontEnd.get_gain(), 1.0f, 0.01f);
+}
+
+} // namespace lampda::utils::audio
@@ -0,0 +1,141 @@
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <gtest/gtest.h>
+
+#include "src/modes/include/audio/beat_tracker.hpp"
+
+namespace lampda::modes::audio {
+
+namespace {
+
+static constexpr size_t bands = 24;
+static constexpr size_t historySize = 31;
+using SpectrumTy = std::array<float, bands>;
+using HistoryTy = std::array<SpectrumTy, historySize>;
+
+/// the previous beat tracking: mean and deviation of the whole history, on every update
+std::array<bool, bands> reference_beats(const HistoryTy& history, const SpectrumTy& spectrum, float* margin)
+{
+  std::array<bool, bands> beats;
+  for (size_t i = 0; i < bands; i++)
+  {
+    float average = 0.0f;
+    for (const auto& past: history)
+      average += past[i] / historySize;
+    float variance = 0.0f;
+    for (const auto& past: history)
+      variance += (past[i] - average) * (past[i] - average);
+    const float threshold = average + 1.5f * sqrtf(variance / historySize);
+    beats[i] = spectrum[i] > threshold;
+    margin[i] = fabsf(spectrum[i] - threshold);
+  }
+  return beats;
+}
+
+/// a music like sequence of spectrums: kicks on the low bands, snares on the mid bands, noise and level changes
+class SpectrumGenerator
+{
+public:
+  SpectrumTy next()
+  {
+    SpectrumTy spectrum;
+    const float level = (frame / 400) % 2 == 0 ? 1.0f : 4.0f;
+    for (size_t i = 0; i < bands; i++)
+    {
+      float value = 20.0f + 3000.0f / (1 + i) + random_float() * 400.0f;
+      if (i < 6 and frame % 37 < 3)
+        value += 6000.0f;
+      if (i >= 8 and i < 14 and frame % 37 == 18)
+        value += 2500.0f;
+      spectrum[i] = value * level;
+    }
+    frame++;
+    return spectrum;
+  }
+
+private:
+  float random_float()
+  {
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) / static_cast<float>(1 << 24);
+  }
+
+  uint32_t state = 1234;
+  uint32_t frame = 0;
+};
+
+} // namespace
+
+TEST(test_beat_tracker, same_beats_as_full_history_statistics)
+{
+  static constexpr uint32_t frames = 5000;
+  BeatTracker<bands, historySize> tracker;
+  tracker.reset();
+  SpectrumGenerator generator;
+
+  HistoryTy history;
+  size_t historyIndex = 0;
+  size_t historyCount = 0;
+  uint32_t beatCount = 0;
+
+  for (uint32_t frame = 0; frame < frames; frame++)
+  {
+    const SpectrumTy spectrum = generator.next();
+    const auto& beats = tracker.update(spectrum);
+
+    if (historyCount < historySize)
+    {
+      historyCount++;
+    }
+    else
+    {
+      float margin[bands];
+      const auto expected = reference_beats(history, spectrum, margin);
+      for (size_t i = 0; i < bands; i++)
+      {
+        beatCount += expected[i] ? 1 : 0;
+        if (beats[i] == expected[i])
+          continue;
+        // float rounding differs between the two computations: only exact ties can differ
+        ASSERT_LT(margin[i], 1e-4f * spectrum[i]) << "frame " << frame << " band " << i;
+      }
+    }
+    history[historyIndex] = spectrum;
+    historyIndex = (historyIndex + 1) % historySize;
+  }
+
+  // the sequence has beats
+  EXPECT_GT(beatCount, frames / 37 * 6);
+}
+
+TEST(test_beat_tracker, decimated_history)
+{
+  static constexpr uint32_t frames = 2000;
+  BeatTracker<bands, historySize> tracker;
+  BeatTracker<bands, historySize> decimatedTracker;
+  tracker.reset();
+  decimatedTracker.reset();
+  SpectrumGenerator generator;
+  SpectrumGenerator otherGenerator;
+
+  for (uint32_t frame = 0; frame < frames; frame++)
+  {
+    const SpectrumTy spectrum = generator.next();
+    const auto beats = tracker.update(spectrum);
+
+    // the spectrums out of the history change the beats, not the statistics
+    for (uint8_t skipped = 0; skipped < 3; skipped++)
+    {
+      SpectrumTy loud = otherGenerator.next();
+      for (float& band: loud)
+        band *= 10.0f;
+      const auto& loudBeats = decimatedTracker.update(loud, false);
+      if (frame > historySize)
+        ASSERT_TRUE(loudBeats[0]) << "frame " << frame;
+    }
+    ASSERT_EQ(decimatedTracker.update(spectrum), beats) << "frame " << frame;
+  }
+}
+
+} // namespace lampda::modes::audio
@@ -213,4 +213,102 @@ TEST(test_curves, N_points_linear_curve)
   ASSERT_EQ(curveFU.sample(-Inf), 0);
 }
 
+TEST(test_curves, static_linear_curve_matches_linear_curve)
+{
+  using point_t = curves::Point<float, uint8_t>;
+  // unsorted points, same as the vector based curve
+  static constexpr auto staticCurve = curves::make_linear_curve<float, uint8_t>(
+          point_t {300.0f, 255}, point_t {-100.0f, 0}, point_t {200.0f, 191}, point_t {100.0f, 127});
+  const curves::LinearCurve<float, uint8_t> curve(
+          {point_t {300.0f, 255}, point_t {-100.0f, 0}, point_t {200.0f, 191}, point_t {100.0f, 127}});
+
+  // evaluated at compile time
+  static_assert(staticCurve.sample(-100.0f) == 0);
+  static_assert(staticCurve.sample(100.0f) == 127);
+  static_assert(staticCurve.min_x() == -100.0f);
+  static_assert(staticCurve.max_x() == 300.0f);
+
+  for (float x = -200.0f; x < 400.0f; x += 0.5f)
+  {
+    ASSERT_EQ(staticCurve.sample(x), curve.sample(x));
+  }
+  // invalid vals
+  ASSERT_EQ(staticCurve.sample(NAN), 0);
+  ASSERT_EQ(staticCurve.sample(Inf), 255);
+  ASSERT_EQ(staticCurve.sample(-Inf), 0);
+}
+
+TEST(test_curves, static_linear_curve_integers)
+{
+  using point_t = curves::Point<uint16_t, uint16_t>;
+  static constexpr auto curve = curves::make_linear_curve<uint16_t, uint16_t>(point_t {3000, 0},
+                                                                              point_t {3210, 500},
+                                                                              point_t {3350, 1000},
+                                                                              point_t {3430, 1500},
+                                                                              point_t {3470, 2000},
+                                                                              point_t {4080, 9000},
+                                                                              point_t {4110, 9500},
+                                                                              point_t {4180, 10000});
+  const curves::LinearCurve<uint16_t, uint16_t> reference({point_t {3000, 0},
+                                                           point_t {3210, 500},
+                                                           point_t {3350, 1000},
+                                                           point_t {3430, 1500},
+                                                           point_t {3470, 2000},
+                                                           point_t {4080, 9000},
+                                                           point_t {4110, 9500},
+                                                           point_t {4180, 10000}});
+
+  static_assert(curve.sample(0) == 0);
+  static_assert(curve.sample(3000) == 0);
+  static_assert(curve.sample(4180) == 10000);
+  static_assert(curve.sample(UINT16_MAX) == 10000);
+
+  for (uint16_t x = 2500; x < 4500; ++x)
+  {
+    ASSERT_EQ(curve.sample(x), reference.sample(x));
+  }
+}
+
+TEST(test_curves, uniform_lut_curve)
+{
+  using point_t = curves::Point<uint16_t, uint16_t>;
+  static constexpr auto curve =
+          curves::make_linear_curve<uint16_t, uint16_t>(point_t {0, 100}, point_t {512, 1000}, point_t {1024, 1100});
+  // compile time baked table
+  static constexpr curves::UniformLutCurve<uint16_t, uint16_t, 129> lut(curve, 0, 1024);
+
+  static_assert(lut.sample(0) == 100);
+  static_assert(lut.sample(512) == 1000);
+  static_assert(lut.sample(1024) == 1100);
+  static_assert(lut.sample(2000) == 1100);
+
+  // the lut points are on the curve segments: exact up to the integer truncation
+  for (uint16_t x = 0; x <= 1024; ++x)
+  {
+    ASSERT_NEAR(lut.sample(x), curve.sample(x), 1);
+  }
+
+  // runtime baked exponential
+  using expCurve_t = curves::ExponentialCurve<uint16_t, uint16_t>;
+  const expCurve_t expCurve(expCurve_t::point_t {0, 9000}, expCurve_t::point_t {1024, 12000}, 50.0);
+  const curves::UniformLutCurve<uint16_t, uint16_t, 129> expLut(expCurve, 0, 1024);
+  for (uint16_t x = 0; x <= 1024; ++x)
+  {
+    ASSERT_NEAR(expLut.sample(x), round(expCurve.sample(x)), 2);
+  }
+  ASSERT_EQ(expLut.sample(0), 9000);
+  ASSERT_EQ(expLut.sample(1024), 12000);
+
+  // floating point table
+  using floatPoint_t = curves::Point<float, float>;
+  static constexpr auto floatCurve =
+          curves::make_linear_curve<float, float>(floatPoint_t {-1.0f, -10.0f}, floatPoint_t {1.0f, 10.0f});
+  static constexpr curves::UniformLutCurve<float, float, 17> floatLut(floatCurve, -1.0f, 1.0f);
+  for (float x = -1.5f; x <= 1.5f; x += 0.01f)
+  {
+    ASSERT_NEAR(floatLut.sample(x), floatCurve.sample(x), 1e-4);
+  }
+  ASSERT_EQ(floatLut.sample(NAN), -10.0f);
+}
+
 } // namespace lampda::utils
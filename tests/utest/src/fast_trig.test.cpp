@@ -0,0 +1,108 @@
+#include <cmath>
+#include <cstdint>
+#include <gtest/gtest.h>
+
+#include "src/system/utils/fast_trig.h"
+
+namespace lampda {
+
+TEST(test_fast_trig, sin_cos_accuracy)
+{
+  float maxError = 0.0f;
+  for (float angle = -50.0f; angle < 50.0f; angle += 0.000731f)
+  {
+    maxError = std::max(maxError, fabsf(trig::sin(angle) - std::sin(static_cast<double>(angle))));
+    maxError = std::max(maxError, fabsf(trig::cos(angle) - std::cos(static_cast<double>(angle))));
+  }
+  EXPECT_LT(maxError, 2.5e-5f);
+
+  // exact on the axes
+  EXPECT_FLOAT_EQ(trig::sin(0.0f), 0.0f);
+  EXPECT_FLOAT_EQ(trig::cos(0.0f), 1.0f);
+  EXPECT_NEAR(trig::sin(c_HALF_PI), 1.0f, 1e-6f);
+  EXPECT_NEAR(trig::cos(c_PI), -1.0f, 1e-6f);
+}
+
+TEST(test_fast_trig, sin_cos_large_angles)
+{
+  // angles that keep growing with time: the error is the one of the float angle
+  float maxError = 0.0f;
+  for (float angle = 1e3f; angle < 1e5f; angle *= 1.0001f)
+  {
+    for (const float signedAngle: {angle, -angle})
+    {
+      // tolerance of the float angle itself
+      const float tolerance = 2.5e-5f + 2.0f * std::nextafter(angle, 2.0f * angle) - 2.0f * angle;
+      const float sinError = fabsf(trig::sin(signedAngle) - std::sin(static_cast<double>(signedAngle)));
+      const float cosError = fabsf(trig::cos(signedAngle) - std::cos(static_cast<double>(signedAngle)));
+      maxError = std::max(maxError, std::max(sinError, cosError) / tolerance);
+    }
+  }
+  EXPECT_LT(maxError, 1.0f);
+}
+
+TEST(test_fast_trig, fixed_point_sin_cos_accuracy)
+{
+  int32_t maxError = 0;
+  for (uint32_t angle = 0; angle < 65536; ++angle)
+  {
+    const double radians = angle * 2.0 * M_PI / 65536.0;
+    maxError = std::max<int32_t>(maxError, abs(trig::sin_q15(angle) - lround(std::sin(radians) * 32767)));
+    maxError = std::max<int32_t>(maxError, abs(trig::cos_q15(angle) - lround(std::cos(radians) * 32767)));
+  }
+  EXPECT_LT(maxError, 2);
+
+  // usable in constant expressions
+  static_assert(trig::sin_q15(16384) == 32767);
+  static_assert(trig::cos_q15(32768) == -32767);
+}
+
+TEST(test_fast_trig, atan2_accuracy)
+{
+  float maxError = 0.0f;
+  int32_t maxFixedError = 0;
+  for (float angle = -c_PI; angle < c_PI; angle += 0.000517f)
+  {
+    for (const float radius: {0.001f, 1.0f, 1000.0f})
+    {
+      const float x = radius * std::cos(angle);
+      const float y = radius * std::sin(angle);
+      const double expected = std::atan2(static_cast<double>(y), static_cast<double>(x));
+      maxError = std::max(maxError, fabsf(trig::atan2(y, x) - expected));
+
+      // fixed point: 16 bits angle, with the wrap on -pi/pi
+      const int32_t expectedFixed = lround(expected / (2.0 * M_PI) * 65536.0) & 0xFFFF;
+      const int32_t error = abs(static_cast<int16_t>(trig::atan2_q16(lroundf(y * 1000), lroundf(x * 1000)) -
+                                                     expectedFixed));
+      if (radius > 1.0f)
+        maxFixedError = std::max(maxFixedError, error);
+    }
+  }
+  EXPECT_LT(maxError, 3e-5f);
+  EXPECT_LE(maxFixedError, 1);
+
+  // quadrants and axes, as std::atan2
+  EXPECT_FLOAT_EQ(trig::atan2(0.0f, 0.0f), 0.0f);
+  EXPECT_FLOAT_EQ(trig::atan2(0.0f, -1.0f), c_PI);
+  EXPECT_FLOAT_EQ(trig::atan2(1.0f, 0.0f), c_HALF_PI);
+  EXPECT_FLOAT_EQ(trig::atan2(-1.0f, 0.0f), -c_HALF_PI);
+  EXPECT_EQ(trig::atan2_q16(0, 5), 0);
+  EXPECT_EQ(trig::atan2_q16(5, 0), 16384);
+  EXPECT_EQ(trig::atan2_q16(0, -5), 32768);
+  EXPECT_EQ(trig::atan2_q16(-5, 0), 49152);
+  EXPECT_EQ(trig::atan2_q16(INT32_MIN, INT32_MIN), 40960);
+}
+
+TEST(test_fast_trig, isqrt)
+{
+  for (uint32_t value = 0; value < 1000000; ++value)
+  {
+    const uint32_t root = trig::isqrt(value);
+    ASSERT_LE(root * root, value);
+    ASSERT_GT((root + 1) * (root + 1), value);
+  }
+  EXPECT_EQ(trig::isqrt(UINT32_MAX), 65535);
+  EXPECT_EQ(trig::isqrt(65536u * 65535u), 65535);
+}
+
+} // namespace lampda
@@ -20,6 +20,44 @@ double generate_sin_frequency(const double frequency,
   return amplitude * sin(index * 2.0f * M_PI * frequency / samplingFrequency + offset);
 }
 
+/// index of the logarithm bin containing a frequency
+template<typename AnalyzerTy> size_t log_bin_index(const AnalyzerTy& fftAnalyzer, const float frequency)
+{
+  size_t i = 0;
+  while (i < fftAnalyzer.fftLog.size() - 1 && frequency > fftAnalyzer.get_log_bin_max_frequency(i))
+    i++;
+  return i;
+}
+
+/// amplitude of the logarithm bin containing a frequency, and its two neighbours
+template<typename AnalyzerTy> float log_amplitude_around(const AnalyzerTy& fftAnalyzer, const float frequency)
+{
+  const size_t index = log_bin_index(fftAnalyzer, frequency);
+  float power = 0.0;
+  for (size_t i = (index > 0 ? index - 1 : 0); i <= index + 1 && i < fftAnalyzer.fftLog.size(); i++)
+    power += fftAnalyzer.fftLog[i] * fftAnalyzer.fftLog[i];
+  return sqrt(power);
+}
+
+/// a sine is split between the logarithm bin containing it and a neighbour, the other bins are under the tolerance
+template<typename AnalyzerTy>
+void expect_sine_in_log_bins(const AnalyzerTy& fftAnalyzer,
+                             const float frequency,
+                             const float amplitude,
+                             const float tolerance)
+{
+  const size_t index = log_bin_index(fftAnalyzer, frequency);
+  for (size_t i = 0; i < fftAnalyzer.fftLog.size(); i++)
+  {
+    // the bin containing the frequency has the highest amplitude
+    EXPECT_LE(fftAnalyzer.fftLog[i], fftAnalyzer.fftLog[index] * 1.001) << "at " << frequency << "Hz";
+    if (i + 1 < index || i > index + 1)
+      EXPECT_NEAR(fftAnalyzer.fftLog[i], 0.0, tolerance) << "at " << frequency << "Hz";
+  }
+  EXPECT_NEAR(log_amplitude_around(fftAnalyzer, frequency), amplitude, amplitude * 0.05) << "at " << frequency << "Hz";
+  EXPECT_NEAR(fftAnalyzer.totalAmplitude, amplitude, amplitude * 0.05) << "at " << frequency << "Hz";
+}
+
 TEST(fastFourrierTest, simpleSignalAmplitude)
 {
   const size_t samples = 512;
@@ -43,15 +81,7 @@ TEST(fastFourrierTest, simpleSignalAmplitude)
   EXPECT_LT(fftAnalyzer.fftBin[frequIndex + 1], fftAnalyzer.fftBin[frequIndex]);
 
   // check the logarithm bin values
-  for (size_t i = 0; i < numberOfBins; i++)
-  {
-    const float minLogFrequency = fftAnalyzer.get_log_bin_min_frequency(i);
-    const float maxLogFrequency = fftAnalyzer.get_log_bin_max_frequency(i);
-    if (frequency >= minLogFrequency && frequency <= maxLogFrequency)
-      EXPECT_NEAR(fftAnalyzer.fftLog[i], amplitude, amplitude * 0.05);
-    else
-      EXPECT_LT(fftAnalyzer.fftLog[i], amplitude * 0.2);
-  }
+  expect_sine_in_log_bins(fftAnalyzer, frequency, amplitude, amplitude * 0.2);
 }
 
 TEST(fastFourrierTest, composedSignalAmplitude)
@@ -99,17 +129,18 @@ TEST(fastFourrierTest, composedSignalAmplitude)
   EXPECT_LT(fftAnalyzer.fftBin[frequ3Index - 1], fftAnalyzer.fftBin[frequ3Index]);
   EXPECT_LT(fftAnalyzer.fftBin[frequ3Index + 1], fftAnalyzer.fftBin[frequ3Index]);
 
+  const size_t bin1 = log_bin_index(fftAnalyzer, frequency1);
+  const size_t bin2 = log_bin_index(fftAnalyzer, frequency2);
+  const size_t bin3 = log_bin_index(fftAnalyzer, frequency3);
+  EXPECT_NEAR(fftAnalyzer.fftLog[bin1], amplitude1, amplitude1 * 2);
+  EXPECT_GT(log_amplitude_around(fftAnalyzer, frequency2), amplitude2 * 0.8);
+  EXPECT_GT(log_amplitude_around(fftAnalyzer, frequency3), amplitude3 * 0.8);
   for (size_t i = 0; i < numberOfBins; i++)
   {
-    const float minLogFrequency = fftAnalyzer.get_log_bin_min_frequency(i);
-    const float maxLogFrequency = fftAnalyzer.get_log_bin_max_frequency(i);
-    if (frequency1 >= minLogFrequency && frequency1 <= maxLogFrequency)
-      EXPECT_NEAR(fftAnalyzer.fftLog[i], amplitude1, amplitude1 * 2);
-    else if (frequency2 >= minLogFrequency && frequency2 <= maxLogFrequency)
-      EXPECT_GT(fftAnalyzer.fftLog[i], amplitude2 * 0.8);
-    else if (frequency3 >= minLogFrequency && frequency3 <= maxLogFrequency)
-      EXPECT_GT(fftAnalyzer.fftLog[i], amplitude3 * 0.8);
-    else
+    const auto is_around = [i](const size_t bin) {
+      return i + 1 >= bin && i <= bin + 1;
+    };
+    if (not is_around(bin1) && not is_around(bin2) && not is_around(bin3))
       EXPECT_LT(fftAnalyzer.fftLog[i], amplitude2);
   }
 }
@@ -142,15 +173,7 @@ TEST(fastFourrierTest, simpleSignalAmplitudeSweep)
     EXPECT_LT(fftAnalyzer.fftBin[freqSample + 1], fftAnalyzer.fftBin[freqSample]);
 
     // check the logarithm bin values
-    for (size_t i = 0; i < numberOfBins; i++)
-    {
-      const float minLogFrequency = fftAnalyzer.get_log_bin_min_frequency(i);
-      const float maxLogFrequency = fftAnalyzer.get_log_bin_max_frequency(i);
-      if (frequency >= minLogFrequency && frequency <= maxLogFrequency)
-        EXPECT_NEAR(fftAnalyzer.fftLog[i], amplitude, amplitude * 0.05);
-      else
-        EXPECT_NEAR(fftAnalyzer.fftLog[i], 0.0, amplitude * 0.05);
-    }
+    expect_sine_in_log_bins(fftAnalyzer, frequency, amplitude, amplitude * 0.05);
   }
 }
 
@@ -190,14 +213,113 @@ TEST(fastFourrierTest, composedSignalAmplitudeSweep)
     EXPECT_LT(fftAnalyzer.fftBin[freqSample + 1], fftAnalyzer.fftBin[freqSample]);
 
     // check the logarithm bin values
-    for (size_t i = 0; i < numberOfBins; i++)
+    EXPECT_GT(log_amplitude_around(fftAnalyzer, frequency1), amplitude1 * 0.8);
+  }
+}
+
+TEST(fastFourrierTest, fixedPointMatchesReference)
+{
+  static constexpr size_t samples = 512;
+  RealFftQ15<samples> fft;
+
+  // a few sines and some noise, far from the full scale
+  std::array<double, samples> signal;
+  uint32_t randomState = 7;
+  for (uint16_t i = 0; i < samples; i++)
+  {
+    randomState = randomState * 1664525u + 1013904223u;
+    signal[i] = generate_sin_frequency(440.0, 300.0, i) + generate_sin_frequency(2500.0, 120.0, i, 0.7) +
+                generate_sin_frequency(6000.0, 40.0, i, 1.3) + static_cast<int32_t>(randomState >> 28) - 8;
+    fft.buffer[i] = lround(signal[i]);
+  }
+  const int8_t shift = fft.prepare();
+
+  std::array<double, samples / 2> magnitudes;
+  fft.compute([&magnitudes, shift](const uint16_t i, const uint32_t magnitude) {
+    magnitudes[i] = magnitude / pow(2.0, shift);
+  });
+
+  // discrete fourrier transform of the rounded signal, without dc
+  double mean = 0.0;
+  for (uint16_t i = 0; i < samples; i++)
+    mean += lround(signal[i]);
+  mean /= samples;
+  for (uint16_t k = 1; k < samples / 2; k++)
+  {
+    double re = 0.0;
+    double im = 0.0;
+    for (uint16_t i = 0; i < samples; i++)
+    {
+      re += (lround(signal[i]) - mean) * cos(2.0 * M_PI * k * i / samples);
+      im -= (lround(signal[i]) - mean) * sin(2.0 * M_PI * k * i / samples);
+    }
+    const double reference = sqrt(re * re + im * im) * 2.0 / samples;
+    // magnitude approximation error, and fixed point rounding relative to the largest sine
+    EXPECT_NEAR(magnitudes[k], reference, reference * 0.025 + 300.0 * 0.005) << "at bin " << k;
+  }
+}
+
+TEST(fastFourrierTest, hannWindowAmplitude)
+{
+  static constexpr size_t samples = 512;
+  RealFftQ15<samples, Window::Hann> fft;
+
+  const float freqBinSize = samplingFrequency / static_cast<float>(samples);
+  const float amplitude = 1000.0;
+  for (const size_t frequencyBin: {5, 40, 200})
+  {
+    for (uint16_t i = 0; i < samples; i++)
+      fft.buffer[i] = lround(generate_sin_frequency(frequencyBin * freqBinSize, amplitude, i));
+    const int8_t shift = fft.prepare();
+
+    std::array<float, samples / 2> magnitudes;
+    fft.compute([&magnitudes, shift](const uint16_t i, const uint32_t magnitude) {
+      magnitudes[i] = magnitude * RealFftQ15<samples, Window::Hann>::windowGain / pow(2.0, shift);
+    });
+
+    // the window gain compensates the attenuation
+    EXPECT_NEAR(magnitudes[frequencyBin], amplitude, amplitude * 0.05);
+    // leakage is only on the closest bins
+    EXPECT_NEAR(magnitudes[frequencyBin - 1], amplitude / 2, amplitude * 0.05);
+    EXPECT_NEAR(magnitudes[frequencyBin + 1], amplitude / 2, amplitude * 0.05);
+    EXPECT_LT(magnitudes[frequencyBin - 3], amplitude * 0.01);
+    EXPECT_LT(magnitudes[frequencyBin + 3], amplitude * 0.01);
+  }
+}
+
+TEST(fastFourrierTest, shortTimeHops)
+{
+  static constexpr size_t samples = 512;
+  static constexpr size_t hop = 128;
+  static constexpr size_t numberOfBins = 24;
+  ShortTimeFftAnalyzer<samples, hop, numberOfBins> fftAnalyzer;
+
+  const float freqBinSize = samplingFrequency / static_cast<float>(samples);
+  const float frequency = freqBinSize * 30;
+  const float amplitude = 2000.0;
+
+  int16_t block[hop];
+  uint32_t sampleIndex = 0;
+  for (uint16_t hopIndex = 0; hopIndex < 20; hopIndex++)
+  {
+    // half hops: a spectrum every two blocks
+    for (uint16_t half = 0; half < 2; half++)
+    {
+      for (uint16_t i = 0; i < hop / 2; i++)
+        block[i] = lround(generate_sin_frequency(frequency, amplitude, sampleIndex++));
+      ASSERT_EQ(fftAnalyzer.push_samples(block, hop / 2), half == 1);
+    }
+
+    // the window is full: same spectrum at every hop
+    if (hopIndex >= samples / hop)
     {
-      const float minLogFrequency = fftAnalyzer.get_log_bin_min_frequency(i);
-      const float maxLogFrequency = fftAnalyzer.get_log_bin_max_frequency(i);
-      if (frequency1 >= minLogFrequency && frequency1 <= maxLogFrequency)
-        EXPECT_GT(fftAnalyzer.fftLog[i], amplitude1 * 0.8);
+      EXPECT_NEAR(fftAnalyzer.fftBin[30], amplitude, amplitude * 0.05);
+      EXPECT_NEAR(fftAnalyzer.maxFrequency, frequency, freqBinSize);
+      EXPECT_LT(fftAnalyzer.fftBin[25], amplitude * 0.01);
     }
   }
+  // the window holds the last samples
+  EXPECT_EQ(fftAnalyzer.samples[samples - 1], block[hop / 2 - 1]);
 }
 
 } // namespace lampda::utils::fft
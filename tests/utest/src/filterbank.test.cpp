@@ -0,0 +1,96 @@
+/**
+ * Test for the logarithmic filterbank
+ */
+#include <cmath>
+#include <gtest/gtest.h>
+
+#include "src/system/utils/fft.h"
+#include "src/system/utils/filterbank.h"
+
+namespace lampda::utils::fft {
+
+namespace {
+
+constexpr uint16_t samples = 512;
+constexpr uint16_t bands = 24;
+
+using FlatFilterbank = LogFilterbank<samples, SAMPLE_RATE, bands>;
+using AWeightedFilterbank = LogFilterbank<samples, SAMPLE_RATE, bands, Weighting::A>;
+
+float a_weighting_dB(const float frequency)
+{
+  return 10.0 * log10(AWeightedFilterbank::weighting_power_gain(frequency));
+}
+
+} // namespace
+
+TEST(filterbankTest, trianglesSumToOne)
+{
+  // the continuous component is in no band
+  EXPECT_EQ(FlatFilterbank::taps[0].lowWeight, 0.0f);
+  EXPECT_EQ(FlatFilterbank::taps[0].highWeight, 0.0f);
+
+  for (uint16_t bin = 1; bin < FlatFilterbank::binCount; ++bin)
+  {
+    const auto& tap = FlatFilterbank::taps[bin];
+    ASSERT_LT(tap.band + 1, bands);
+    EXPECT_NEAR(tap.lowWeight + tap.highWeight, 1.0f, 1e-6) << "at bin " << bin;
+    EXPECT_GE(tap.lowWeight, 0.0f);
+    EXPECT_GE(tap.highWeight, 0.0f);
+
+    // the triangles cross on the band edges: the band containing the bin has the highest weight
+    const double frequency = FlatFilterbank::bin_frequency(bin);
+    const double edge = FlatFilterbank::edges[tap.band + 1];
+    if (frequency < edge)
+      EXPECT_GE(tap.lowWeight, 0.5f) << "at bin " << bin;
+    else
+      EXPECT_GE(tap.highWeight, 0.5f) << "at bin " << bin;
+  }
+
+  // edges are increasing, up to the Nyquist frequency
+  for (uint16_t band = 0; band < bands; ++band)
+    EXPECT_LT(FlatFilterbank::edges[band], FlatFilterbank::edges[band + 1]);
+  EXPECT_FLOAT_EQ(FlatFilterbank::edges[bands], SAMPLE_RATE / 2.0);
+}
+
+TEST(filterbankTest, aWeightingGain)
+{
+  // reference values of the A weighting
+  EXPECT_NEAR(a_weighting_dB(1000.0), 0.0, 0.01);
+  EXPECT_NEAR(a_weighting_dB(100.0), -19.1, 0.1);
+  EXPECT_NEAR(a_weighting_dB(250.0), -8.6, 0.1);
+  EXPECT_NEAR(a_weighting_dB(4000.0), 1.0, 0.1);
+  EXPECT_NEAR(a_weighting_dB(8000.0), -1.1, 0.1);
+
+  // the weighting is folded in the weights
+  for (uint16_t bin = 1; bin < AWeightedFilterbank::binCount; ++bin)
+  {
+    const auto& tap = AWeightedFilterbank::taps[bin];
+    const float gain = AWeightedFilterbank::weighting_power_gain(AWeightedFilterbank::bin_frequency(bin));
+    EXPECT_NEAR(tap.lowWeight + tap.highWeight, gain, gain * 1e-5) << "at bin " << bin;
+  }
+}
+
+TEST(filterbankTest, aWeightedAmplitude)
+{
+  ShortTimeFftAnalyzer<samples, samples, bands, float, Weighting::A> fftAnalyzer;
+  const float freqBinSize = SAMPLE_RATE / static_cast<float>(samples);
+  const float amplitude = 2000.0;
+
+  for (const uint16_t frequencyBin: {4, 8, 32, 64, 128, 200})
+  {
+    const float frequency = frequencyBin * freqBinSize;
+    int16_t block[samples];
+    for (uint16_t i = 0; i < samples; i++)
+      block[i] = lround(amplitude * sin(2.0 * M_PI * frequency * i / SAMPLE_RATE));
+    fftAnalyzer.reset();
+    ASSERT_TRUE(fftAnalyzer.push_samples(block, samples));
+
+    const float expected = amplitude * pow(10.0, a_weighting_dB(frequency) / 20.0);
+    EXPECT_NEAR(fftAnalyzer.totalAmplitude, expected, expected * 0.05) << "at " << frequency << "Hz";
+    // unweighted raw bins
+    EXPECT_NEAR(fftAnalyzer.maxMagnitude, amplitude, amplitude * 0.05) << "at " << frequency << "Hz";
+  }
+}
+
+} // namespace lampda::utils::fft
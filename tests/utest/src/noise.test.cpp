@@ -0,0 +1,183 @@
+#include <cmath>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include "src/system/ext/noise.h"
+
+namespace lampda {
+
+namespace {
+
+/// deterministic pseudo random coordinates
+uint32_t next_random(uint32_t& state)
+{
+  state = state * 1664525u + 1013904223u;
+  return state;
+}
+
+/// check the spread of noise values on random coordinates
+template<typename Noise> void check_distribution(const Noise& noise, const char* name)
+{
+  static constexpr uint32_t samples = 200000;
+  static constexpr uint8_t binCount = 16;
+  uint32_t bins[binCount] = {};
+  uint32_t randomState = 42;
+  double sum = 0.0;
+  double squaredSum = 0.0;
+  uint16_t mini = UINT16_MAX;
+  uint16_t maxi = 0;
+  for (uint32_t i = 0; i < samples; ++i)
+  {
+    const uint16_t value = noise(next_random(randomState), next_random(randomState), next_random(randomState));
+    sum += value;
+    squaredSum += static_cast<double>(value) * value;
+    mini = std::min(mini, value);
+    maxi = std::max(maxi, value);
+    bins[value / (65536 / binCount)]++;
+  }
+  const double mean = sum / samples;
+  const double deviation = sqrt(squaredSum / samples - mean * mean);
+
+  // centered, spread on the whole range
+  EXPECT_NEAR(mean, 32768.0, 65536 * 0.02) << name;
+  EXPECT_GT(deviation, 65536 * 0.1) << name;
+  EXPECT_LT(mini, 65536 * 0.05) << name;
+  EXPECT_GT(maxi, 65536 * 0.95) << name;
+  // symmetric, and no empty part of the range
+  for (uint8_t bin = 0; bin < binCount; ++bin)
+  {
+    EXPECT_GT(bins[bin], 0u) << name << " bin " << (int)bin;
+    EXPECT_NEAR(bins[bin], bins[binCount - 1 - bin], samples * 0.01) << name << " bin " << (int)bin;
+  }
+}
+
+/// check that the noise has no discontinuities, along a fine walk
+template<typename Noise> void check_continuity(const Noise& noise, const char* name)
+{
+  static constexpr uint32_t steps = 500000;
+  const uint32_t x = UINT32_MAX / 2;
+  const uint32_t y = UINT32_MAX / 3;
+  const uint32_t z = UINT32_MAX / 5;
+  int32_t last = noise(x, y, z);
+  for (uint32_t i = 1; i < steps; ++i)
+  {
+    // each step is ~1/5000 of a noise cell
+    const int32_t value = noise(x + i * 7, y + i * 3, z + i * 5);
+    ASSERT_LT(abs(value - last), 100) << name << " at step " << i;
+    last = value;
+  }
+}
+
+} // namespace
+
+TEST(test_noise, batch_noise16_matches_single_samples)
+{
+  static constexpr uint16_t count = 512;
+  uint32_t x[count];
+  uint32_t y[count];
+  uint32_t z[count];
+  uint16_t out[count];
+
+  // spatially coherent points (shared cells), then large jumps between points (no shared cells)
+  for (const uint32_t stride: {600u, 45000u, 700000u})
+  {
+    for (uint16_t i = 0; i < count; ++i)
+    {
+      x[i] = UINT32_MAX / 2 + i * stride;
+      y[i] = UINT32_MAX / 3 + (i % 30) * stride * 3;
+      z[i] = UINT32_MAX / 4 + i * 20;
+    }
+    noise16::inoise(x, y, z, out, count);
+
+    for (uint16_t i = 0; i < count; ++i)
+    {
+      ASSERT_EQ(out[i], noise16::inoise(x[i], y[i], z[i])) << "at index " << i << " stride " << stride;
+    }
+  }
+}
+
+TEST(test_noise, grid_noise8_matches_single_samples)
+{
+  static constexpr uint16_t width = 31;
+  static constexpr uint16_t height = 29;
+  uint8_t out[width * height];
+
+  for (const uint16_t z: {0, 777, 65000})
+  {
+    noise8::inoise_grid(100, 60, width, 1234, 45, height, z, out);
+
+    for (uint16_t j = 0; j < height; ++j)
+    {
+      for (uint16_t i = 0; i < width; ++i)
+      {
+        ASSERT_EQ(out[j * width + i], noise8::inoise(100 + i * 60, 1234 + j * 45, z));
+      }
+    }
+  }
+}
+
+TEST(test_noise, simplex_distribution)
+{
+  check_distribution(
+          [](uint32_t x, uint32_t y, uint32_t z) {
+            return simplex16::inoise(x, y, z);
+          },
+          "simplex 3D");
+  check_distribution(
+          [](uint32_t x, uint32_t y, uint32_t) {
+            return simplex16::inoise(x, y);
+          },
+          "simplex 2D");
+  check_distribution(
+          [](uint32_t x, uint32_t y, uint32_t z) {
+            return static_cast<uint16_t>(simplex8::inoise(x, y, z) << 8);
+          },
+          "simplex8 3D");
+}
+
+TEST(test_noise, simplex_continuity)
+{
+  check_continuity(
+          [](uint32_t x, uint32_t y, uint32_t z) {
+            return simplex16::inoise(x, y, z);
+          },
+          "simplex 3D");
+  check_continuity(
+          [](uint32_t x, uint32_t y, uint32_t) {
+            return simplex16::inoise(x, y);
+          },
+          "simplex 2D");
+}
+
+TEST(test_noise, simplex_batch_matches_single_samples)
+{
+  static constexpr uint16_t count = 256;
+  uint32_t x[count];
+  uint32_t y[count];
+  uint32_t z[count];
+  uint16_t out[count];
+  for (uint16_t i = 0; i < count; ++i)
+  {
+    x[i] = UINT32_MAX / 2 + i * 600;
+    y[i] = UINT32_MAX / 3 + (i % 30) * 1800;
+    z[i] = UINT32_MAX / 4 + i * 20;
+  }
+  simplex16::inoise(x, y, z, out, count);
+  for (uint16_t i = 0; i < count; ++i)
+  {
+    ASSERT_EQ(out[i], simplex16::inoise(x[i], y[i], z[i])) << "at index " << i;
+  }
+
+  static constexpr uint16_t width = 31;
+  static constexpr uint16_t height = 29;
+  uint8_t grid[width * height];
+  simplex8::inoise_grid(100, 60, width, 1234, 45, height, 777, grid);
+  for (uint16_t j = 0; j < height; ++j)
+  {
+    for (uint16_t i = 0; i < width; ++i)
+    {
+      ASSERT_EQ(grid[j * width + i], simplex8::inoise(100 + i * 60, 1234 + j * 45, 777));
+    }
+  }
+}
+
+} // namespace lampda
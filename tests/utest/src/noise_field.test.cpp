@@ -0,0 +1,66 @@
+#include <cstdint>
+#include <gtest/gtest.h>
+
+#include "src/modes/include/noise/noise_field.hpp"
+
+namespace lampda {
+
+using FieldTy = modes::noise::NoiseField<>;
+using LampTy = modes::hardware::LampTy;
+
+TEST(test_noise_field, upsampling_error)
+{
+  static FieldTy field;
+  field.reset();
+
+  for (const uint16_t scale: {300, 600, 1000})
+  {
+    field.set_origin(UINT32_MAX / 2, UINT32_MAX / 3, scale);
+    for (uint32_t z = UINT32_MAX / 4; z < UINT32_MAX / 4 + 20000; z += 3000)
+    {
+      field.update(z);
+      const float error = field.compute_upsampling_error(z);
+      EXPECT_LT(error, 3.0f) << "scale " << scale << " z " << z;
+    }
+  }
+}
+
+TEST(test_noise_field, cached_keyframes_match_direct_lattice)
+{
+  static FieldTy cached;
+  static FieldTy direct;
+  cached.reset();
+
+  cached.set_origin(UINT32_MAX / 2, UINT32_MAX / 3, 600);
+  // z crosses several keyframes
+  const uint32_t start = (UINT32_MAX / 4) & ~(FieldTy::timeStep - 1);
+  uint16_t keyframeCount = 0;
+  for (uint32_t z = start; z < start + FieldTy::timeStep * 5; z += FieldTy::timeStep / 16)
+  {
+    cached.update(z);
+    // a fresh field evaluates its lattice directly, without keyframes
+    direct.reset();
+    direct.set_origin(UINT32_MAX / 2, UINT32_MAX / 3, 600);
+    direct.update(z);
+
+    // a blended lattice stays close to the direct one
+    float squaredErrorSum = 0.0f;
+    for (uint16_t i = 0; i < LampTy::ledCount; ++i)
+    {
+      const float error = (static_cast<float>(cached.sample(i)) - direct.sample(i)) / UINT16_MAX;
+      squaredErrorSum += error * error;
+    }
+    EXPECT_LT(100.0f * sqrtf(squaredErrorSum / LampTy::ledCount), 3.0f) << "at z " << z;
+
+    // on the keyframes, both are equal
+    if ((z & (FieldTy::timeStep - 1)) == 0)
+    {
+      keyframeCount += 1;
+      for (uint16_t i = 0; i < LampTy::ledCount; ++i)
+        ASSERT_EQ(cached.sample(i), direct.sample(i)) << "at z " << z;
+    }
+  }
+  EXPECT_EQ(keyframeCount, 5);
+}
+
+} // namespace lampda
@@ -0,0 +1,627 @@
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+
+#include "src/modes/include/particle_system/particle_interactions.hpp"
+#include "src/modes/include/particle_system/particle_system.hpp"
+
+namespace lampda {
+
+namespace {
+
+using LampTy = modes::hardware::LampTy;
+
+static constexpr uint16_t particleCount = 512;
+static constexpr float frameDuration_s = 0.012f;
+
+/// expose the occupancy and the arrays of the particle system
+template<uint16_t capacity = particleCount> class TestParticleSystemTy : public modes::ParticleSystemTy<capacity>
+{
+public:
+  using modes::ParticleSystemTy<capacity>::is_position_taken;
+  using modes::ParticleSystemTy<capacity>::get_storage;
+};
+using TestParticleSystem = TestParticleSystemTy<>;
+
+/// spread the particles on the lamp, with a few collisions
+int16_t spawn_position(const size_t index) { return (index * 7) % LampTy::ledCount; }
+
+/// previous occupancy, with a set of the occupied leds
+struct SetParticleSystem
+{
+  std::vector<modes::Particle> particles;
+  std::set<int16_t> occupiedSpacesSet;
+
+  void init()
+  {
+    particles.clear();
+    occupiedSpacesSet.clear();
+    for (size_t i = 0; i < particleCount; ++i)
+    {
+      const int16_t pos = spawn_position(i);
+      const auto& helixCoordinates = modes::strip_to_helix_unconstraint(pos);
+      particles.emplace_back(utils::vec3d {helixCoordinates.x, helixCoordinates.y, helixCoordinates.z});
+      occupiedSpacesSet.insert(pos);
+    }
+  }
+
+  /// reference sweep: walk the movement every half led, stop on the last free led before an occupied one
+  bool sweep(const modes::Particle& from, modes::Particle& to) const
+  {
+    float angle_rad = to.theta_rad - from.theta_rad;
+    if (angle_rad > c_PI)
+      angle_rad -= c_TWO_PI;
+    else if (angle_rad < -c_PI)
+      angle_rad += c_TWO_PI;
+    const float height_mm = to.z_mm - from.z_mm;
+
+    const float halfLeds = 2.0f * std::max(fabsf(angle_rad) * LampTy::lampBodyRadius_mm / LampTy::ledSize_mm,
+                                           fabsf(height_mm) / LampTy::ledStripWidth_mm);
+    const uint16_t stepCount = std::max<uint16_t>(1, ceilf(halfLeds));
+
+    modes::Particle lastFree = from;
+    for (uint16_t step = 1; step <= stepCount; ++step)
+    {
+      // the last step is the destination
+      const float progress = step / static_cast<float>(stepCount);
+      const modes::Particle sample =
+              step == stepCount ? to
+                                : modes::Particle(wrap_angle(from.theta_rad + angle_rad * progress),
+                                                  from.z_mm + height_mm * progress);
+      if (sample._savedLampIndex != from._savedLampIndex and occupiedSpacesSet.count(sample._savedLampIndex) != 0)
+      {
+        to = lastFree;
+        return true;
+      }
+      lastFree = sample;
+    }
+    return false;
+  }
+
+  void iterate_with_collisions(const utils::vec3d& acceleration, const float deltaTime_s)
+  {
+    for (auto& p: particles)
+    {
+      const int16_t ledIndex = p._savedLampIndex;
+      modes::Particle newP = p.simulate_after_acceleration(acceleration, deltaTime_s, true);
+      if (newP._savedLampIndex != ledIndex)
+      {
+        const bool hasCollided = sweep(p, newP);
+        occupiedSpacesSet.erase(ledIndex);
+        occupiedSpacesSet.insert(newP._savedLampIndex);
+        if (hasCollided)
+        {
+          p.theta_rad = newP.theta_rad;
+          p.z_mm = newP.z_mm;
+          p._savedLampIndex = newP._savedLampIndex;
+          p.thetaSpeed_radS = -p.thetaSpeed_radS * 0.75;
+          p.zSpeed_mS = -p.zSpeed_mS * 0.75;
+          continue;
+        }
+      }
+      p = newP;
+    }
+  }
+};
+
+/// previous particle update: the acceleration projected on the cylinder for every particle, with vectors
+void apply_acceleration_vector(modes::Particle& p, const utils::vec3d& acceleration, const float deltaTime_s)
+{
+  const utils::vec3d e_theta(
+          -trig::sin(p.theta_rad) * modes::cylinderRadius_m, trig::cos(p.theta_rad) * modes::cylinderRadius_m, 0);
+  const utils::vec3d e_z(0, 0, 1);
+  const utils::vec3d& accelerationVector =
+          e_theta.multiply(acceleration.dot(e_theta)).add(e_z.multiply(acceleration.dot(e_z)));
+  const utils::vec2d speedIncrement(modes::angularSpeedGain * accelerationVector.dot(e_theta) /
+                                            static_cast<float>(modes::cylinderRadius_m) * deltaTime_s,
+                                    modes::linearSpeedGain * accelerationVector.dot(e_z) * deltaTime_s);
+
+  p.dampen_speed(modes::speedDampening);
+  p.thetaSpeed_radS = lmpd_constrain<float>(
+          p.thetaSpeed_radS + speedIncrement.x, -modes::maxAngularSpeed_radS, modes::maxAngularSpeed_radS);
+  p.zSpeed_mS = lmpd_constrain<float>(
+          p.zSpeed_mS + speedIncrement.y, -modes::maxVerticalSpeed_mmS, modes::maxVerticalSpeed_mmS);
+
+  static constexpr float angularUnit = LampTy::maxWidthFloat / c_TWO_PI;
+  static constexpr float verticalUnit = LampTy::ledStripWidth_mm * 1.5f;
+  p.z_mm += lmpd_constrain<float>(p.zSpeed_mS * deltaTime_s, -verticalUnit, verticalUnit) * 1000.0;
+  p.theta_rad =
+          wrap_angle(p.theta_rad + lmpd_constrain<float>(p.thetaSpeed_radS * deltaTime_s, -angularUnit, angularUnit));
+  p.constraint_into_lamp_body();
+}
+
+/// a lamp shaken in every direction
+utils::vec3d frame_acceleration(const uint32_t frame)
+{
+  const float angle = frame * 0.05f;
+  return utils::vec3d(3.0f * trig::cos(angle), 3.0f * trig::sin(angle), -9.81f);
+}
+
+using Interactions = modes::ParticleInteractionsTy<>;
+
+/// densities of all the particles, comparing all the pairs
+void brute_force_densities(const TestParticleSystem& particleSystem,
+                           std::vector<float>& density,
+                           std::vector<float>& nearDensity)
+{
+  const modes::ParticleStorage particles = particleSystem.get_storage();
+  const uint16_t count = particleSystem.get_number_of_active();
+  density.assign(particles.capacity, 0.0f);
+  nearDensity.assign(particles.capacity, 0.0f);
+  for (uint16_t a = 0; a < count; ++a)
+  {
+    const uint16_t i = particles.aliveSlots[a];
+    for (uint16_t b = 0; b < count; ++b)
+    {
+      const uint16_t j = particles.aliveSlots[b];
+      if (i == j or Interactions::cell_of(particles.theta_rad[j], particles.z_mm[j]) < 0)
+        continue;
+      // shortest way around the lamp
+      float angle = wrap_angle(particles.theta_rad[j] - particles.theta_rad[i]);
+      if (angle > c_PI)
+        angle -= c_TWO_PI;
+      const float du = angle * LampTy::lampBodyRadius_mm;
+      const float dv = particles.z_mm[j] - particles.z_mm[i];
+      const float distance = sqrtf(du * du + dv * dv);
+      if (distance >= Interactions::radius_mm)
+        continue;
+      const float q = 1.0f - distance / Interactions::radius_mm;
+      density[i] += q * q;
+      nearDensity[i] += q * q * q;
+    }
+  }
+}
+
+/// interactions without the viscosity
+struct PressureOnly : public modes::ParticleInteractionConfig
+{
+  static constexpr float viscosity = 0.0f;
+};
+
+/// interactions with only the viscosity
+struct ViscosityOnly : public modes::ParticleInteractionConfig
+{
+  static constexpr float stiffness = 0.0f;
+  static constexpr float nearStiffness = 0.0f;
+};
+
+/// place a particle of a particle system
+void place_particle(const auto& particleSystem,
+                    const uint16_t slot,
+                    const float theta_rad,
+                    const float z_mm,
+                    const float thetaSpeed_radS = 0.0f,
+                    const float zSpeed_mS = 0.0f)
+{
+  const modes::ParticleStorage particles = particleSystem.get_storage();
+  particles.theta_rad[slot] = theta_rad;
+  particles.z_mm[slot] = z_mm;
+  particles.thetaSpeed_radS[slot] = thetaSpeed_radS;
+  particles.zSpeed_mS[slot] = zSpeed_mS;
+}
+
+} // namespace
+
+TEST(test_particle_system, occupancy)
+{
+  static TestParticleSystem particleSystem;
+  particleSystem.set_max_particle_count(4);
+  particleSystem.init_particules([](size_t index) {
+    return static_cast<int16_t>(10 + index);
+  });
+
+  EXPECT_TRUE(particleSystem.is_position_taken(10));
+  EXPECT_TRUE(particleSystem.is_position_taken(13));
+  EXPECT_FALSE(particleSystem.is_position_taken(14));
+
+  // positions outside of the lamp are never occupied: spawn areas can hold any number of particles
+  particleSystem.init_particules([](size_t index) {
+    return static_cast<int16_t>(-5 - index);
+  });
+  EXPECT_FALSE(particleSystem.is_position_taken(-5));
+  EXPECT_FALSE(particleSystem.is_position_taken(LampTy::ledCount));
+  EXPECT_FALSE(particleSystem.is_position_taken(10));
+  EXPECT_EQ(particleSystem.get_number_of_active(), 4);
+
+  // depopped particles free their position
+  particleSystem.init_particules([](size_t index) {
+    return static_cast<int16_t>(20 + index);
+  });
+  particleSystem.depop_particules([](const modes::Particle&) {
+    return true;
+  });
+  EXPECT_FALSE(particleSystem.is_position_taken(20));
+  EXPECT_EQ(particleSystem.get_number_of_active(), 0);
+}
+
+TEST(test_particle_system, free_list)
+{
+  static modes::ParticleSystemTy<8> particleSystem;
+  particleSystem.set_max_particle_count(6);
+
+  // deferred spawns fill the slots in order, up to the particle count
+  std::vector<size_t> spawnedSlots;
+  const auto spawn = [&spawnedSlots](size_t index) {
+    spawnedSlots.push_back(index);
+    return static_cast<int16_t>(100 + 10 * index);
+  };
+  particleSystem.init_deferred_particules(4, spawn);
+  EXPECT_EQ(spawnedSlots, std::vector<size_t>({0, 1, 2, 3}));
+  particleSystem.init_deferred_particules(4, spawn);
+  EXPECT_EQ(spawnedSlots, std::vector<size_t>({0, 1, 2, 3, 4, 5}));
+  EXPECT_EQ(particleSystem.get_number_of_active(), 6);
+
+  // depop the particles of slots 1 and 4, the others keep their slot
+  const auto isDepopped = [](const modes::Particle& p) {
+    return p._savedLampIndex == 110 or p._savedLampIndex == 140;
+  };
+  EXPECT_EQ(particleSystem.depop_particules(isDepopped), 4);
+  EXPECT_EQ(particleSystem.depop_particules(isDepopped), 4);
+  for (const size_t slot: {0, 2, 3, 5})
+    EXPECT_EQ(particleSystem.get_particle(slot)._savedLampIndex, 100 + 10 * slot);
+
+  // the freed slots are reused, and nothing else
+  spawnedSlots.clear();
+  particleSystem.init_deferred_particules(4, spawn);
+  std::sort(spawnedSlots.begin(), spawnedSlots.end());
+  EXPECT_EQ(spawnedSlots, std::vector<size_t>({1, 4}));
+  EXPECT_EQ(particleSystem.get_number_of_active(), 6);
+
+  // depop everything, then restart from the first slot
+  EXPECT_EQ(particleSystem.depop_particules([](const modes::Particle&) {
+    return true;
+  }),
+            0);
+  spawnedSlots.clear();
+  particleSystem.init_particules(spawn);
+  EXPECT_EQ(spawnedSlots, std::vector<size_t>({0, 1, 2, 3, 4, 5}));
+}
+
+TEST(test_particle_system, pool_leases)
+{
+  static modes::ParticlePoolTy<100> pool;
+
+  const auto first = pool.lease(40);
+  const auto second = pool.lease(40);
+  EXPECT_EQ(first.capacity, 40);
+  EXPECT_EQ(second.capacity, 40);
+  EXPECT_EQ(second.theta_rad - first.theta_rad, 40);
+  EXPECT_EQ(pool.get_free_count(), 20);
+
+  // not enough particles left
+  EXPECT_EQ(pool.lease(30).capacity, 0);
+
+  // the gap of a released lease is reused first
+  pool.release(first);
+  const auto third = pool.lease(30);
+  EXPECT_EQ(third.theta_rad, first.theta_rad);
+  const auto fourth = pool.lease(20);
+  EXPECT_EQ(fourth.theta_rad - first.theta_rad, 80);
+  EXPECT_EQ(pool.get_free_count(), 10);
+
+  pool.release(second);
+  pool.release(third);
+  pool.release(fourth);
+  EXPECT_EQ(pool.get_free_count(), 100);
+  EXPECT_EQ(pool.lease(100).capacity, 100);
+}
+
+TEST(test_particle_system, pooled_system)
+{
+  {
+    modes::PooledParticleSystem particleSystem;
+    EXPECT_EQ(particleSystem.get_capacity(), 0);
+
+    // no particles before the lease
+    particleSystem.init_particules(spawn_position);
+    EXPECT_EQ(particleSystem.get_number_of_active(), 0);
+
+    ASSERT_TRUE(particleSystem.lease(255));
+    EXPECT_EQ(modes::particlePool.get_free_count(), modes::particlePoolCapacity - 255);
+    particleSystem.init_particules(spawn_position);
+    EXPECT_EQ(particleSystem.get_number_of_active(), 255);
+
+    // same movement as a system with its own particles
+    static modes::ParticleSystem reference;
+    reference.set_max_particle_count(255);
+    reference.init_particules(spawn_position);
+    for (uint32_t frame = 0; frame < 50; ++frame)
+    {
+      particleSystem.iterate_with_collisions(frame_acceleration(frame), frameDuration_s);
+      reference.iterate_with_collisions(frame_acceleration(frame), frameDuration_s);
+    }
+    for (size_t i = 0; i < 255; ++i)
+      ASSERT_EQ(particleSystem.get_particle(i)._savedLampIndex, reference.get_particle(i)._savedLampIndex);
+
+    // the arrays of the interactions of these particles fit in the pool too (gravity mode)
+    {
+      Interactions interactions;
+      ASSERT_TRUE(interactions.lease(255));
+      EXPECT_EQ(modes::particlePool.get_free_count(), modes::particlePoolCapacity - 2 * 255);
+    }
+    EXPECT_EQ(modes::particlePool.get_free_count(), modes::particlePoolCapacity - 255);
+
+    // a second mode can not lease more than what is left
+    modes::PooledParticleSystem otherSystem;
+    EXPECT_FALSE(otherSystem.lease(modes::particlePoolCapacity));
+    EXPECT_EQ(otherSystem.get_capacity(), 0);
+
+    particleSystem.release();
+    EXPECT_EQ(particleSystem.get_number_of_active(), 0);
+    EXPECT_TRUE(otherSystem.lease(modes::particlePoolCapacity));
+  }
+  // the destructors return the particles
+  EXPECT_EQ(modes::particlePool.get_free_count(), modes::particlePoolCapacity);
+}
+
+TEST(test_particle_system, collisions)
+{
+  static TestParticleSystem particleSystem;
+  particleSystem.set_max_particle_count(particleCount);
+  particleSystem.init_particules(spawn_position);
+
+  // same steps as the set occupancy, on the lamp
+  static SetParticleSystem reference;
+  reference.init();
+  for (uint32_t frame = 0; frame < 200; ++frame)
+  {
+    particleSystem.iterate_with_collisions(frame_acceleration(frame), frameDuration_s);
+    reference.iterate_with_collisions(frame_acceleration(frame), frameDuration_s);
+  }
+
+  for (int16_t led = 0; led < LampTy::ledCount; ++led)
+  {
+    const bool isTaken = reference.occupiedSpacesSet.find(led) != reference.occupiedSpacesSet.cend();
+    ASSERT_EQ(particleSystem.is_position_taken(led), isTaken) << "at led " << led;
+  }
+}
+
+TEST(test_particle_system, step_decomposition)
+{
+  for (const auto& acceleration: {utils::vec3d(0.0f, 0.0f, -9.81f),
+                                  utils::vec3d(3.0f, -2.0f, -9.0f),
+                                  utils::vec3d(-12.0f, 7.0f, 4.0f)})
+  {
+    for (float theta = 0.0f; theta < c_TWO_PI; theta += 0.01f)
+    {
+      modes::Particle particle(theta, -100.0f);
+      particle.thetaSpeed_radS = 1.0f;
+      particle.zSpeed_mS = -0.01f;
+      modes::Particle reference = particle;
+
+      particle.apply_acceleration(acceleration, frameDuration_s);
+      apply_acceleration_vector(reference, acceleration, frameDuration_s);
+      // the decomposition only changes the float rounding
+      ASSERT_NEAR(particle.thetaSpeed_radS, reference.thetaSpeed_radS, 1e-4f + fabsf(reference.thetaSpeed_radS) * 1e-4f)
+              << "at " << theta;
+      ASSERT_NEAR(particle.zSpeed_mS, reference.zSpeed_mS, 1e-6f) << "at " << theta;
+      ASSERT_NEAR(particle.theta_rad, reference.theta_rad, 1e-5f) << "at " << theta;
+      ASSERT_NEAR(particle.z_mm, reference.z_mm, 1e-3f) << "at " << theta;
+    }
+  }
+}
+
+TEST(test_particle_system, fixed_step)
+{
+  // a tilted lamp, the particles roll around and down
+  const utils::vec3d acceleration(4.0f, 0.0f, -9.0f);
+  static constexpr uint32_t duration_ms = 300;
+
+  // 80 and 40 frames per second
+  static modes::ParticleSystem fastFrames;
+  static modes::ParticleSystem slowFrames;
+  for (auto* particleSystem: {&fastFrames, &slowFrames})
+  {
+    particleSystem->set_max_particle_count(particleCount);
+    particleSystem->init_particules(spawn_position);
+    particleSystem->set_simulation_budget(UINT32_MAX);
+  }
+
+  uint32_t fastSteps = 0;
+  for (uint32_t frame = 0; frame < duration_ms / 12; ++frame)
+    fastSteps += fastFrames.simulate(acceleration, 0.012f, true);
+  uint32_t slowSteps = 0;
+  for (uint32_t frame = 0; frame < duration_ms / 25; ++frame)
+    slowSteps += slowFrames.simulate(acceleration, 0.025f, true);
+
+  // same steps: same movement
+  EXPECT_EQ(fastSteps, duration_ms * 1000 / modes::ParticleSystem::simulationStep_us);
+  EXPECT_EQ(slowSteps, fastSteps);
+  for (size_t i = 0; i < particleCount; ++i)
+  {
+    ASSERT_EQ(fastFrames.get_particle(i).theta_rad, slowFrames.get_particle(i).theta_rad) << "at " << i;
+    ASSERT_EQ(fastFrames.get_particle(i).z_mm, slowFrames.get_particle(i).z_mm) << "at " << i;
+  }
+
+  // previous update, once per frame: the particles move differently at 40 frames per second
+  fastFrames.init_particules(spawn_position);
+  slowFrames.init_particules(spawn_position);
+  for (uint32_t frame = 0; frame < duration_ms / 12; ++frame)
+    fastFrames.iterate_with_collisions(acceleration, 0.012f);
+  for (uint32_t frame = 0; frame < duration_ms / 25; ++frame)
+    slowFrames.iterate_with_collisions(acceleration, 0.025f);
+  float heightDifference = 0.0f;
+  for (size_t i = 0; i < particleCount; ++i)
+    heightDifference += fabsf(fastFrames.get_particle(i).z_mm - slowFrames.get_particle(i).z_mm);
+  EXPECT_GT(heightDifference, 0.0f);
+}
+
+TEST(test_particle_system, swept_collisions)
+{
+  // a turn of leds, under a particle falling fast
+  static constexpr int16_t wallStart = 200;
+  static constexpr uint16_t wallLength = LampTy::ledPerTurns + 2;
+  static constexpr int16_t fallStart = wallStart + 5 - 3 * static_cast<int16_t>(LampTy::ledPerTurns + 0.5f);
+  static TestParticleSystem particleSystem;
+  particleSystem.set_max_particle_count(wallLength + 1);
+  particleSystem.init_particules([](const size_t index) -> int16_t {
+    return index < wallLength ? wallStart + index : fallStart;
+  });
+  ASSERT_EQ(particleSystem.get_number_of_active(), wallLength + 1);
+
+  // more than a turn per step
+  const modes::ParticleStorage particles = particleSystem.get_storage();
+  particles.zSpeed_mS[wallLength] = -3.0f;
+  ASSERT_GT(3.0f * frameDuration_s * 1000.0f, 2.0f * LampTy::ledStripWidth_mm);
+
+  bool hasBounced = false;
+  for (uint32_t frame = 0; frame < 20; ++frame)
+  {
+    particleSystem.iterate_with_collisions(utils::vec3d(0.0f, 0.0f, 0.0f), frameDuration_s);
+    ASSERT_LT(particles.lampIndex[wallLength], wallStart) << "at frame " << frame;
+    hasBounced |= particles.zSpeed_mS[wallLength] > 0.0f;
+  }
+  EXPECT_TRUE(hasBounced);
+  for (int16_t led = wallStart; led < wallStart + wallLength; ++led)
+    ASSERT_TRUE(particleSystem.is_position_taken(led)) << "at led " << led;
+}
+
+TEST(test_particle_system, simulation_budget)
+{
+  using modes::ParticleSystem;
+  const utils::vec3d acceleration(0.0f, 0.0f, -9.81f);
+  static ParticleSystem particleSystem;
+  particleSystem.set_max_particle_count(particleCount);
+  particleSystem.init_particules(spawn_position);
+
+  // a frame runs the steps it holds, up to the maximum
+  EXPECT_EQ(particleSystem.simulate(acceleration, 0.030f, true), 5);
+  EXPECT_EQ(particleSystem.simulate(acceleration, 0.100f, true), ParticleSystem::maxStepsPerFrame);
+  EXPECT_GT(particleSystem.get_step_duration_us(), 0u);
+  // the remainder is carried to the next frame, the steps over the maximum are dropped
+  EXPECT_EQ(particleSystem.simulate(acceleration, 0.002f, true), 1);
+
+  // no budget left: a step per frame, the simulation slows down
+  particleSystem.set_simulation_budget(0);
+  EXPECT_EQ(particleSystem.simulate(acceleration, 0.024f, true), 1);
+  EXPECT_EQ(particleSystem.simulate(acceleration, 0.0f, true), 0);
+
+  particleSystem.set_simulation_budget(UINT32_MAX);
+  uint8_t calls = 0;
+  EXPECT_EQ(particleSystem.simulate(acceleration, 0.024f, true, true, [&](const float stepDuration_s) {
+    EXPECT_EQ(stepDuration_s, ParticleSystem::simulationStep_s);
+    calls += 1;
+  }),
+            4);
+  EXPECT_EQ(calls, 4);
+}
+
+TEST(test_particle_system, batched_integration)
+{
+  static constexpr uint16_t count = 1024;
+  const auto spawn = [](size_t index) {
+    return static_cast<int16_t>((index * 3) % LampTy::ledCount);
+  };
+
+  static modes::ParticleSystemTy<count> particleSystem;
+  particleSystem.set_max_particle_count(count);
+  particleSystem.init_particules(spawn);
+  for (uint32_t frame = 0; frame < 10; ++frame)
+    particleSystem.iterate_no_collisions(frame_acceleration(frame), frameDuration_s);
+
+  // same movement as the particles updated one by one
+  float maxDistance = 0.0f;
+  for (size_t i = 0; i < count; ++i)
+  {
+    const auto& helixCoordinates = modes::strip_to_helix_unconstraint(spawn(i));
+    modes::Particle reference(utils::vec3d {helixCoordinates.x, helixCoordinates.y, helixCoordinates.z});
+    for (uint32_t frame = 0; frame < 10; ++frame)
+      apply_acceleration_vector(reference, frame_acceleration(frame), frameDuration_s);
+    maxDistance = std::max(maxDistance, fabsf(particleSystem.get_particle(i).z_mm - reference.z_mm));
+  }
+  EXPECT_LT(maxDistance, 0.01f);
+}
+
+TEST(test_particle_system, interaction_densities)
+{
+  static TestParticleSystem particleSystem;
+  particleSystem.set_max_particle_count(particleCount);
+  particleSystem.init_particules([](size_t) {
+    return static_cast<int16_t>(random16(LampTy::ledCount));
+  });
+  // random positions, some on both sides of the angle wrap, some out of the lamp body
+  uint32_t randomState = 3;
+  for (uint16_t i = 0; i < particleCount; ++i)
+  {
+    randomState = randomState * 1664525u + 1013904223u;
+    const float theta = (randomState >> 8) / 16777216.0f * c_TWO_PI - c_PI;
+    randomState = randomState * 1664525u + 1013904223u;
+    const float z = -static_cast<float>(randomState >> 8) / 16777216.0f * (LampTy::lampHeight_mm + 20.0f) + 10.0f;
+    place_particle(particleSystem, i, (i % 8 == 0) ? c_PI - theta * 0.01f : theta, z);
+  }
+
+  Interactions interactions;
+  ASSERT_TRUE(interactions.lease(particleCount));
+  interactions.update_densities(particleSystem);
+  std::vector<float> density, nearDensity;
+  brute_force_densities(particleSystem, density, nearDensity);
+
+  uint16_t interacting = 0;
+  for (uint16_t i = 0; i < particleCount; ++i)
+  {
+    const modes::Particle p = particleSystem.get_particle(i);
+    if (Interactions::cell_of(p.theta_rad, p.z_mm) < 0)
+      continue;
+    interacting += 1;
+    ASSERT_NEAR(interactions.get_density(i), density[i], 1e-4f) << "at slot " << i;
+    ASSERT_NEAR(interactions.get_near_density(i), nearDensity[i], 1e-4f) << "at slot " << i;
+  }
+  EXPECT_EQ(interactions.get_interacting_count(), interacting);
+  EXPECT_LT(interacting, particleCount);
+}
+
+TEST(test_particle_system, interaction_forces)
+{
+  static constexpr float radius = Interactions::radius_mm;
+  static TestParticleSystemTy<4> particleSystem;
+  particleSystem.set_max_particle_count(2);
+  particleSystem.init_particules([](size_t) {
+    return static_cast<int16_t>(LampTy::ledCount / 2);
+  });
+
+  // close particles on both sides of the angle wrap push each other apart, along the lamp circumference
+  modes::ParticleInteractionsTy<PressureOnly> pressureOnly;
+  ASSERT_TRUE(pressureOnly.lease(4));
+  const float halfAngle = 0.1f * radius / LampTy::lampBodyRadius_mm;
+  place_particle(particleSystem, 0, c_PI - halfAngle, -50.0f);
+  place_particle(particleSystem, 1, -c_PI + halfAngle, -50.0f);
+  pressureOnly.apply(particleSystem, frameDuration_s);
+  modes::Particle first = particleSystem.get_particle(0);
+  modes::Particle second = particleSystem.get_particle(1);
+  EXPECT_LT(first.thetaSpeed_radS, 0.0f);
+  EXPECT_GT(second.thetaSpeed_radS, 0.0f);
+  EXPECT_NEAR(first.thetaSpeed_radS + second.thetaSpeed_radS, 0.0f, 1e-5f);
+  EXPECT_NEAR(first.zSpeed_mS, 0.0f, 1e-6f);
+
+  // particles further apart attract each other
+  place_particle(particleSystem, 0, 0.0f, -50.0f);
+  place_particle(particleSystem, 1, 0.0f, -50.0f - 0.8f * radius);
+  pressureOnly.apply(particleSystem, frameDuration_s);
+  first = particleSystem.get_particle(0);
+  second = particleSystem.get_particle(1);
+  EXPECT_LT(first.zSpeed_mS, 0.0f);
+  EXPECT_GT(second.zSpeed_mS, 0.0f);
+  EXPECT_NEAR(first.zSpeed_mS + second.zSpeed_mS, 0.0f, 1e-6f);
+
+  // viscosity reduces the speed difference of neighbors
+  modes::ParticleInteractionsTy<ViscosityOnly> viscosityOnly;
+  ASSERT_TRUE(viscosityOnly.lease(4));
+  place_particle(particleSystem, 0, 0.0f, -50.0f, 0.0f, 0.02f);
+  place_particle(particleSystem, 1, 0.0f, -50.0f - 0.5f * radius, 0.0f, -0.02f);
+  viscosityOnly.apply(particleSystem, frameDuration_s);
+  first = particleSystem.get_particle(0);
+  second = particleSystem.get_particle(1);
+  EXPECT_LT(first.zSpeed_mS - second.zSpeed_mS, 0.04f);
+  EXPECT_GT(first.zSpeed_mS - second.zSpeed_mS, 0.0f);
+
+  // no interaction past the radius
+  place_particle(particleSystem, 0, 0.0f, -50.0f);
+  place_particle(particleSystem, 1, 0.0f, -50.0f - 1.01f * radius);
+  pressureOnly.apply(particleSystem, frameDuration_s);
+  EXPECT_EQ(particleSystem.get_particle(0).zSpeed_mS, 0.0f);
+  EXPECT_EQ(particleSystem.get_particle(1).zSpeed_mS, 0.0f);
+}
+
+} // namespace lampda
@@ -0,0 +1,89 @@
+/**
+ * Test for the sound frames read by the modes
+ */
+#include <cmath>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "src/system/component/sound.h"
+#include "src/system/hal/threads.h"
+#include "src/system/hal/time.h"
+
+#include "simulator/include/hardware_influencer.h"
+#include "simulator/include/wav_source.h"
+
+namespace lampda::component::microphone {
+
+namespace {
+
+/// next main loop iteration: release the frame, wait a bit, and get the latest one
+SoundFrame next_frame()
+{
+  release_sound_frame();
+  hal::delay_ms(2);
+  return get_sound_frame();
+}
+
+} // namespace
+
+TEST(soundFrameTest, staleFrameReadsAsZeros)
+{
+  // a loud sine, streamed as the microphone
+  const std::string path = ::testing::TempDir() + "sound_frame.wav";
+  std::vector<int16_t> samples(utils::fft::SAMPLE_RATE);
+  for (size_t i = 0; i < samples.size(); i++)
+    samples[i] = lround(10000.0 * sin(2.0 * M_PI * 440.0 * i / utils::fft::SAMPLE_RATE));
+  ASSERT_TRUE(simulator::write_wav(path, samples, utils::fft::SAMPLE_RATE));
+  ASSERT_TRUE(simulator::mock_microphone::set_wav_file(path.c_str()));
+
+  // wait for an analyzed capture
+  SoundFrame frame = get_sound_frame();
+  for (uint16_t iteration = 0; iteration < 500 and not frame->isFFTValid; iteration++)
+    frame = next_frame();
+  ASSERT_TRUE(frame.is_readable());
+  ASSERT_TRUE(frame->isFFTValid);
+  const uint32_t sequenceNumber = frame->sequenceNumber;
+  EXPECT_GT(frame->maxAmplitude, 0.0f);
+
+  // readable during the whole iteration
+  EXPECT_EQ(get_sound_frame()->sequenceNumber, sequenceNumber);
+  EXPECT_TRUE(frame.is_readable());
+
+  // the next analysis is fetched: the previous frame belongs to the analysis task again
+  SoundFrame newFrame = next_frame();
+  for (uint16_t iteration = 0; iteration < 500 and newFrame->sequenceNumber == sequenceNumber; iteration++)
+    newFrame = next_frame();
+  ASSERT_NE(newFrame->sequenceNumber, sequenceNumber);
+  EXPECT_TRUE(newFrame.is_readable());
+  EXPECT_FALSE(frame.is_readable());
+
+  const SoundStruct& stale = frame.get();
+  EXPECT_FALSE(stale.isDataValid);
+  EXPECT_FALSE(stale.isFFTValid);
+  EXPECT_EQ(stale.sequenceNumber, 0u);
+  EXPECT_EQ(stale.maxAmplitude, 0.0f);
+  for (size_t i = 0; i < stale.data.size(); i++)
+  {
+    ASSERT_EQ(stale.data[i], 0) << "at " << i;
+    ASSERT_EQ(stale.rectifiedData[i], 0) << "at " << i;
+  }
+  for (const float bin: stale.fft_raw)
+    ASSERT_EQ(bin, 0.0f);
+  for (const float band: stale.fft_log)
+    ASSERT_EQ(band, 0.0f);
+  EXPECT_EQ(frame->sequenceNumber, 0u);
+
+  // a view that was never obtained reads as zeros too
+  EXPECT_FALSE(SoundFrame().is_readable());
+  EXPECT_EQ(&SoundFrame().get(), &stale);
+
+  release_sound_frame();
+  disable();
+  hal::threads::shutdown();
+  simulator::mock_microphone::set_wav_file(nullptr);
+  std::remove(path.c_str());
+}
+
+} // namespace lampda::component::microphone
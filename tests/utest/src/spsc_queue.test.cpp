@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "src/system/utils/spsc_queue.h"
+
+namespace lampda::utils {
+
+namespace {
+
+/// event as pushed from an interrupt
+struct TimedEvent
+{
+  uint32_t time_us = 0;
+  uint8_t type = 0;
+};
+
+} // namespace
+
+TEST(test_spsc_queue, single_thread)
+{
+  SpscQueue<TimedEvent, 4> queue;
+  TimedEvent event;
+
+  // nothing pushed
+  ASSERT_FALSE(queue.has_elements());
+  ASSERT_FALSE(queue.pop(event));
+
+  // first in, first out
+  for (uint8_t i = 0; i < 4; ++i)
+    ASSERT_TRUE(queue.push({100u * i, i}));
+  ASSERT_TRUE(queue.has_elements());
+
+  // full: the new elements are dropped
+  ASSERT_FALSE(queue.push({1000, 9}));
+  EXPECT_EQ(queue.get_dropped_count(), 1u);
+
+  for (uint8_t i = 0; i < 4; ++i)
+  {
+    ASSERT_TRUE(queue.pop(event));
+    EXPECT_EQ(event.type, i);
+    EXPECT_EQ(event.time_us, 100u * i);
+  }
+  ASSERT_FALSE(queue.pop(event));
+  ASSERT_FALSE(queue.has_elements());
+
+  // the indexes wrap around
+  for (uint32_t i = 0; i < 1000; ++i)
+  {
+    ASSERT_TRUE(queue.push({i, static_cast<uint8_t>(i)}));
+    ASSERT_TRUE(queue.pop(event));
+    ASSERT_EQ(event.time_us, i);
+  }
+  EXPECT_EQ(queue.get_dropped_count(), 1u);
+}
+
+TEST(test_spsc_queue, write_in_place)
+{
+  SpscQueue<TimedEvent, 4> queue;
+  TimedEvent event;
+
+  // a written slot is not visible before its commit
+  TimedEvent* slot = queue.write_slot();
+  ASSERT_NE(slot, nullptr);
+  slot->time_us = 42;
+  slot->type = 7;
+  ASSERT_FALSE(queue.has_elements());
+  queue.commit();
+  ASSERT_TRUE(queue.pop(event));
+  EXPECT_EQ(event.time_us, 42u);
+  EXPECT_EQ(event.type, 7);
+
+  // full: no slot, the element is dropped
+  for (uint8_t i = 0; i < 4; ++i)
+    ASSERT_TRUE(queue.push({i, i}));
+  EXPECT_EQ(queue.write_slot(), nullptr);
+  EXPECT_EQ(queue.get_dropped_count(), 1u);
+  ASSERT_TRUE(queue.pop(event));
+  EXPECT_EQ(event.time_us, 0u);
+}
+
+TEST(test_spsc_queue, concurrent_producer_consumer)
+{
+  static constexpr uint32_t eventCount = 20000;
+  SpscQueue<TimedEvent, 16> queue;
+
+  std::thread producer([&queue]() {
+    for (uint32_t i = 1; i <= eventCount; ++i)
+    {
+      // wait for space, not to drop anything
+      while (not queue.push({i, static_cast<uint8_t>(i)}))
+        std::this_thread::yield();
+    }
+  });
+
+  uint32_t lastTime = 0;
+  while (lastTime < eventCount)
+  {
+    TimedEvent event;
+    if (not queue.pop(event))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // in order, none lost, never partially written
+    ASSERT_EQ(event.time_us, lastTime + 1);
+    ASSERT_EQ(event.type, static_cast<uint8_t>(event.time_us));
+    lastTime = event.time_us;
+  }
+  producer.join();
+
+  EXPECT_FALSE(queue.has_elements());
+}
+
+} // namespace lampda::utils
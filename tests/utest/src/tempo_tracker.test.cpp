@@ -0,0 +1,126 @@
+/**
+ * Test for the tempo tracker
+ */
+#include <cmath>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "src/system/utils/fft.h"
+#include "src/system/utils/tempo_tracker.h"
+
+namespace lampda::utils::fft {
+
+namespace {
+
+constexpr uint16_t samples = 512;
+constexpr uint16_t hop = 128;
+constexpr uint16_t bands = 24;
+
+using AnalyzerTy = ShortTimeFftAnalyzer<samples, hop, bands, float, Weighting::A>;
+using TrackerTy = TempoTracker<bands, hop>;
+
+/// drum loop: a kick (low sine and attack click) on every beat, a hihat between the beats, over some noise
+std::vector<int16_t> generate_drum_loop(const float bpm, const float duration_s, const float startOffset_s = 0.0f)
+{
+  std::vector<int16_t> signal(duration_s * SAMPLE_RATE);
+  const float beatSamples = SAMPLE_RATE * 60.0f / bpm;
+  uint32_t randomState = 11;
+  for (size_t i = 0; i < signal.size(); i++)
+  {
+    randomState = randomState * 1664525u + 1013904223u;
+    const float noise = static_cast<int32_t>(randomState >> 16) / 32768.0f - 1.0f;
+
+    const float position = i - startOffset_s * SAMPLE_RATE;
+    const float beatPosition = fmodf(position + 10.0f * beatSamples, beatSamples);
+    const float kickTime = beatPosition / SAMPLE_RATE;
+    const float hihatTime = fmodf(beatPosition + beatSamples / 2.0f, beatSamples) / SAMPLE_RATE;
+
+    float value = 300.0f * noise;
+    value += 8000.0f * expf(-kickTime * 30.0f) * sinf(2.0f * M_PI * 70.0f * kickTime);
+    value += 6000.0f * expf(-kickTime * 150.0f) * noise;
+    value += 1500.0f * expf(-hihatTime * 80.0f) * noise;
+    signal[i] = lround(value);
+  }
+  return signal;
+}
+
+/// run the analysis chain of the microphone on a signal, call back after every spectrum with the sample index
+template<typename CallbackTy> void analyze(const std::vector<int16_t>& signal, TrackerTy& tracker, CallbackTy&& on_hop)
+{
+  AnalyzerTy fftAnalyzer;
+  for (size_t i = 0; i + hop <= signal.size(); i += hop)
+  {
+    if (not fftAnalyzer.push_samples(signal.data() + i, hop))
+      continue;
+    tracker.update(fftAnalyzer.fftLog);
+    on_hop(i + hop);
+  }
+}
+
+} // namespace
+
+TEST(tempoTrackerTest, tempoRange)
+{
+  EXPECT_LE(TrackerTy::lag_to_bpm(TrackerTy::maxLag), TrackerTy::minBpm);
+  EXPECT_GE(TrackerTy::lag_to_bpm(TrackerTy::minLag), TrackerTy::maxBpm);
+}
+
+TEST(tempoTrackerTest, drumLoopTempo)
+{
+  for (const float bpm: {90.0f, 100.0f, 120.0f, 128.0f, 140.0f, 150.0f})
+  {
+    TrackerTy tracker;
+    analyze(generate_drum_loop(bpm, 12.0f), tracker, [](size_t) {});
+
+    EXPECT_NEAR(tracker.get_bpm(), bpm, bpm * 0.02) << "at " << bpm << "bpm";
+    EXPECT_GT(tracker.get_confidence(), 0.5f) << "at " << bpm << "bpm";
+  }
+}
+
+TEST(tempoTrackerTest, beatPhase)
+{
+  for (const float bpm: {100.0f, 128.0f})
+  {
+    const float beatSamples = SAMPLE_RATE * 60.0f / bpm;
+    const float startOffset_s = 0.13f;
+    TrackerTy tracker;
+
+    // phase error at every kick, after the convergence
+    float maxError = 0.0f;
+    uint32_t kickCount = 0;
+    analyze(generate_drum_loop(bpm, 12.0f, startOffset_s), tracker, [&](const size_t sampleIndex) {
+      if (sampleIndex < 6 * SAMPLE_RATE)
+        return;
+      // the spectrum contains the samples up to sampleIndex: expect the beat when the kick is in the last hop
+      const float beatPosition = fmodf(sampleIndex - startOffset_s * SAMPLE_RATE, beatSamples);
+      if (beatPosition >= hop)
+        return;
+      kickCount++;
+
+      const float phase = tracker.get_beat_phase();
+      const float error = std::min(phase, 1.0f - phase);
+      maxError = std::max(maxError, error);
+    });
+
+    EXPECT_GT(kickCount, 0u);
+    // the analysis window delays the onsets by a few hops
+    EXPECT_LT(maxError, 4.0f * hop / beatSamples) << "at " << bpm << "bpm";
+  }
+}
+
+TEST(tempoTrackerTest, noiseHasNoTempo)
+{
+  std::vector<int16_t> signal(12 * SAMPLE_RATE);
+  uint32_t randomState = 3;
+  for (auto& sample: signal)
+  {
+    randomState = randomState * 1664525u + 1013904223u;
+    sample = static_cast<int16_t>(randomState >> 16) / 8;
+  }
+
+  TrackerTy tracker;
+  analyze(signal, tracker, [](size_t) {});
+  EXPECT_LT(tracker.get_confidence(), 0.3f);
+}
+
+} // namespace lampda::utils::fft
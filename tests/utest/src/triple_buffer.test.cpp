@@ -0,0 +1,101 @@
+#include <array>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "src/system/utils/triple_buffer.h"
+
+namespace lampda::utils {
+
+namespace {
+
+/// object that can be detected as partially written
+struct Frame
+{
+  uint32_t version = 0;
+  std::array<uint32_t, 256> values {};
+
+  void fill(const uint32_t newVersion)
+  {
+    version = newVersion;
+    values.fill(newVersion);
+  }
+
+  bool is_consistent() const
+  {
+    for (const auto value: values)
+      if (value != version)
+        return false;
+    return true;
+  }
+};
+
+} // namespace
+
+TEST(test_triple_buffer, single_thread)
+{
+  TripleBuffer<Frame> buffer;
+
+  // nothing published
+  ASSERT_FALSE(buffer.has_new_data());
+  ASSERT_FALSE(buffer.fetch());
+  ASSERT_EQ(buffer.read_buffer().version, 0u);
+
+  buffer.write_buffer().fill(1);
+  buffer.publish();
+  ASSERT_TRUE(buffer.has_new_data());
+  ASSERT_TRUE(buffer.fetch());
+  ASSERT_FALSE(buffer.has_new_data());
+  ASSERT_EQ(buffer.read_buffer().version, 1u);
+
+  // no new data: the read buffer is kept
+  ASSERT_FALSE(buffer.fetch());
+  ASSERT_EQ(buffer.read_buffer().version, 1u);
+
+  // intermediate versions are dropped
+  for (uint32_t version = 2; version <= 5; ++version)
+  {
+    buffer.write_buffer().fill(version);
+    buffer.publish();
+    // the read buffer is never written by the producer
+    ASSERT_EQ(buffer.read_buffer().version, 1u);
+  }
+  ASSERT_TRUE(buffer.fetch());
+  ASSERT_EQ(buffer.read_buffer().version, 5u);
+  ASSERT_TRUE(buffer.read_buffer().is_consistent());
+}
+
+TEST(test_triple_buffer, concurrent_producer_consumer)
+{
+  static constexpr uint32_t versionCount = 200000;
+  TripleBuffer<Frame> buffer;
+
+  std::thread producer([&buffer]() {
+    for (uint32_t version = 1; version <= versionCount; ++version)
+    {
+      buffer.write_buffer().fill(version);
+      buffer.publish();
+    }
+  });
+
+  uint32_t lastVersion = 0;
+  uint32_t fetchCount = 0;
+  while (lastVersion < versionCount)
+  {
+    if (not buffer.fetch())
+      continue;
+    fetchCount++;
+
+    const Frame& frame = buffer.read_buffer();
+    // never partially written, and never older than the previous read
+    ASSERT_TRUE(frame.is_consistent()) << "at version " << frame.version;
+    ASSERT_GT(frame.version, lastVersion);
+    lastVersion = frame.version;
+  }
+  producer.join();
+
+  EXPECT_EQ(lastVersion, versionCount);
+  EXPECT_GT(fetchCount, 0u);
+}
+
+} // namespace lampda::utils
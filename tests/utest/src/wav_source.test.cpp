@@ -0,0 +1,139 @@
+/**
+ * Test for the WAV file microphone source of the simulator
+ */
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "simulator/include/wav_source.h"
+
+namespace simulator {
+
+namespace {
+
+std::string temporary_file(const std::string& name) { return ::testing::TempDir() + name; }
+
+std::vector<int16_t> generate_sine(const double frequency,
+                                   const double amplitude,
+                                   const uint32_t rate,
+                                   const size_t count)
+{
+  std::vector<int16_t> samples(count);
+  for (size_t i = 0; i < count; i++)
+    samples[i] = lround(amplitude * sin(2.0 * M_PI * frequency * i / rate));
+  return samples;
+}
+
+} // namespace
+
+TEST(wavSourceTest, sameRateIsExact)
+{
+  const std::string path = temporary_file("same_rate.wav");
+  const auto samples = generate_sine(440.0, 20000.0, 16000, 4000);
+  ASSERT_TRUE(write_wav(path, samples, 16000));
+
+  WavSource source;
+  ASSERT_TRUE(source.load(path, 16000));
+  ASSERT_EQ(source.samples(), samples);
+
+  // blocks wrap at the end of the file
+  EXPECT_EQ(source.block_count(128), 4000u / 128u);
+  int16_t block[128];
+  source.read_block(source.block_count(128) + 2, block, 128);
+  EXPECT_EQ(block[0], samples[2 * 128]);
+  std::remove(path.c_str());
+}
+
+TEST(wavSourceTest, resampledSine)
+{
+  const std::string path = temporary_file("resampled.wav");
+  const double frequency = 1000.0;
+  const double amplitude = 10000.0;
+  ASSERT_TRUE(write_wav(path, generate_sine(frequency, amplitude, 44100, 44100), 44100));
+
+  WavSource source;
+  ASSERT_TRUE(source.load(path, 16000));
+  EXPECT_NEAR(source.samples().size(), 16000u, 1u);
+
+  // far from the edges of the file, the filter has all its taps
+  double maxError = 0.0;
+  for (size_t i = 100; i < source.samples().size() - 100; i++)
+    maxError = std::max(maxError, fabs(source.samples()[i] - amplitude * sin(2.0 * M_PI * frequency * i / 16000.0)));
+  EXPECT_LT(maxError, amplitude * 0.01);
+
+  // frequencies above the target Nyquist frequency are removed
+  ASSERT_TRUE(write_wav(path, generate_sine(12000.0, amplitude, 44100, 44100), 44100));
+  ASSERT_TRUE(source.load(path, 16000));
+  int16_t maxAliased = 0;
+  for (size_t i = 100; i < source.samples().size() - 100; i++)
+    maxAliased = std::max<int16_t>(maxAliased, abs(source.samples()[i]));
+  EXPECT_LT(maxAliased, amplitude * 0.01);
+  std::remove(path.c_str());
+}
+
+TEST(wavSourceTest, stereo24Bits)
+{
+  // hand written file: 2 channels of 24 bits samples, the channels are averaged
+  const std::vector<int32_t> left = {0, 4194304, -4194304, 8388607};
+  const std::vector<int32_t> right = {0, 0, -4194304, -8388608};
+  std::vector<uint8_t> content;
+  const auto add_u32 = [&content](const uint32_t value) {
+    for (int i = 0; i < 4; i++)
+      content.push_back(value >> (8 * i));
+  };
+  const auto add_u16 = [&content](const uint16_t value) {
+    content.push_back(value);
+    content.push_back(value >> 8);
+  };
+  const uint32_t dataSize = left.size() * 2 * 3;
+  content.insert(content.end(), {'R', 'I', 'F', 'F'});
+  add_u32(36 + dataSize);
+  content.insert(content.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+  add_u32(16);
+  add_u16(1);
+  add_u16(2);
+  add_u32(16000);
+  add_u32(16000 * 6);
+  add_u16(6);
+  add_u16(24);
+  content.insert(content.end(), {'d', 'a', 't', 'a'});
+  add_u32(dataSize);
+  for (size_t i = 0; i < left.size(); i++)
+  {
+    for (const int32_t sample: {left[i], right[i]})
+    {
+      content.push_back(sample);
+      content.push_back(sample >> 8);
+      content.push_back(sample >> 16);
+    }
+  }
+
+  const std::string path = temporary_file("stereo.wav");
+  std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(content.data()), content.size());
+
+  WavSource source;
+  ASSERT_TRUE(source.load(path, 16000));
+  ASSERT_EQ(source.samples().size(), left.size());
+  EXPECT_EQ(source.samples()[0], 0);
+  EXPECT_EQ(source.samples()[1], 8192);
+  EXPECT_EQ(source.samples()[2], -16384);
+  EXPECT_EQ(source.samples()[3], 0);
+  std::remove(path.c_str());
+}
+
+TEST(wavSourceTest, invalidFile)
+{
+  WavSource source;
+  EXPECT_FALSE(source.load(temporary_file("missing.wav"), 16000));
+
+  const std::string path = temporary_file("invalid.wav");
+  std::ofstream(path) << "not a wav file";
+  EXPECT_FALSE(source.load(path, 16000));
+  EXPECT_TRUE(source.samples().empty());
+  std::remove(path.c_str());
+}
+
+} // namespace simulator